@@ -186,7 +186,7 @@ int select_rng(random_generator_t *cur_rng)
  for (int i = 0; i < gscount; i++) {
    int cur_gnum = params->gnumbs[i + (params->gnumbs[0] == 207)];
    params->gfilenum[i] = GVECMAX;
-   if(strncmp("file_input",dh_rng_types[cur_gnum]->name,10) == 0){
+   if(rng_takes_filename(dh_rng_types[cur_gnum])){
      if(cur_fnum >= params->fcount){
        fprintf(stderr,"Error: gennum %s uses file input but no filename has been specified\n",dh_rng_types[cur_gnum]->name);
        return(-1);
@@ -356,9 +356,9 @@ int select_XOR(random_generator_t *cur_rng)
    /*
     * We need a sanity check for file input.  File input is permitted
     * iff we have a file name AND if gnumbs[j] is either file_input or
-    * file_input_raw.
+    * file_input_raw (or shm_input_raw, whose ring is named the same way).
     */
-   if(strncmp("file_input",dh_rng_types[params->gnumbs[j]]->name,10) == 0){
+   if(rng_takes_filename(dh_rng_types[params->gnumbs[j]])){
      one_file++;
      if(fromfile != 1 || one_file > 1){
        fprintf(stderr,"Error: generator %s uses file input but no filename has been specified",dh_rng_types[params->gnumbs[j]]->name);
@@ -39,6 +39,12 @@ int main(int argc, char *argv[])
   */
  parsecl(argc,argv);
 
+ /*
+  * In batch mode (-M) the generator is file_input_raw on each file of
+  * the batch in turn; this points it at the first one.
+  */
+ if(batch_path[0] != 0) batch_setup();
+
  /*
   * This fills the global *dh_rng_types defined in libdieharder with all
   * the rngs known directly to libdieharder including known hardware
@@ -84,12 +90,42 @@ int main(int argc, char *argv[])
     * It is the UI's responsibility to ensure that run_test() is not called
     * without choosing a valid rng first!
     */
+   if(batch_path[0] != 0 && etalon_enabled){
+     fprintf(stderr,"Error:  -M cannot be used with an etalon generator.\n");
+     exit(1);
+   }
+   if(fanout_flag && etalon_enabled){
+     fprintf(stderr,"# Warning:  -A cannot be used with an etalon generator.  Running tests one at a time.\n");
+     fanout_flag = NO;
+   }
+   if(plan_flag && strcmp(gsl_rng_name(generator.rng),"file_input_raw") != 0){
+     fprintf(stderr,"# Warning:  -b only plans file_input_raw capture files.  Ignoring it.\n");
+     plan_flag = NO;
+   }
+   if(plan_flag && etalon_enabled){
+     fprintf(stderr,"# Warning:  -b cannot be used with an etalon generator.  Running tests one at a time.\n");
+     plan_flag = NO;
+   }
    if(all){
      run_all_tests();
    } else {
      run_test();
    }
 
+   /*
+    * With -A the tests above were only lined up; now they all run at
+    * once on one pass over the stream.  With -b they run at once on
+    * their own ranges of the capture file, and with -M on every file of
+    * the batch.
+    */
+   if(batch_path[0] != 0){
+     run_batch();
+   } else if(plan_flag){
+     run_plan();
+   } else if(fanout_flag){
+     run_fanout();
+   }
+
  /*
   * This ends the core loop for a non-CLI interactive UI.  GUIs will
   * typically exit directly from the event loop.  Tool UIs may well fall
@@ -11,6 +11,12 @@
 /* To enable large file support */
 #define _FILE_OFFSET_BITS 64
 
+/*
+ * -b counts the rands of this many psamples of each test to see how
+ * much of a capture file it needs.
+ */
+#define PLAN_CALIBRATE 2
+
 #include <dieharder/libdieharder.h>
 
 /*
@@ -57,10 +63,19 @@ double strategy;
  void set_globals();
  void choose_rng();
  int execute_test(int);
+ unsigned int more_psamples(Dtest *dtest,Test **test);
  void run_all_tests();
+ void fanout_queue(int dtest_num);
+ void run_fanout();
+ void run_plan();
+ void batch_setup();
+ void batch_queue(int dtest_num);
+ void run_batch();
  void run_test();
  void add_ui_rngs();
  void parsecl(int argc, char **argv);
+ void add_gname(input_params_t *params, char* gname);
+ void add_filename(input_params_t *params, char* filename);
  void output(Dtest *dtest,Test **test, random_generator_t *cur_rng);
  void show_test_header(Dtest *dtest,Test **test);
  void show_test_header_debug(Dtest *dtest,Test **test);
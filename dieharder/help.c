@@ -50,12 +50,13 @@ void Usage()
  fprintf(stdout, "\n\
 Usage:\n\
 \n\
-dieharder [-a] [-d dieharder test number] [-f filename] [-B]\n\
+dieharder [-a] [-A] [-b] [-d dieharder test number] [-f filename] [-B]\n\
           [-D output flag [-D output flag] ... ] [-F] [-c separator]\n\
           [-e etalon generator number] [-E etalon generator seed]\n\
           [-i etalon random input filename]\n\
-          [-g generator number or -1] [-h] [-k ks_flag] [-l] \n\
-          [-L overlap] [-m multiply_p] [-n ntuple] \n\
+          [-g generator number or -1] [-h] [-j bits] [-J spill prefix]\n\
+          [-k ks_flag] [-l] \n\
+          [-L overlap] [-m multiply_p] [-M batch] [-n ntuple] \n\
           [-o filename] [-p number of p samples] [-P Xoff]\n\
           [-q] [-s seed strategy] [-S random number seed]\n\
           [-t number of test samples] [-v verbose flag]\n\
@@ -63,6 +64,14 @@ dieharder [-a] [-d dieharder test number] [-f filename] [-B]\n\
           [-x xvalue] [-y yvalue] [-z zvalue]\n");
 fprintf(stdout, "\n\
   -a - runs all the tests with standard/default options to create a report\n\
+  -A - runs the tests (e.g. of -a) all at once, each on its own thread,\n\
+     on one pass over the generator's stream instead of one after another\n\
+     on successive slices of it.  Meant for stdin or capture file input.\n\
+     Not with an etalon generator.  With -Y only final results are shown.\n\
+  -b - like -A, but for a file_input_raw capture file:  each test counts\n\
+     how many rands it will use and gets its own range of the file, so no\n\
+     data is used twice.  If the file is too short every test's psamples\n\
+     are scaled down to fit.  Not with an etalon generator.\n\
   -d test number -  selects specific diehard test.\n\
   -f filename - generators 201 or 202 permit either raw binary or \n\
      formatted ASCII numbers to be read in from a file for testing.\n\
@@ -75,6 +84,9 @@ fprintf(stdout, "\n\
      and then examine the contents of example.input.\n\
      Raw binary input reads 32 bit increments of the specified data stream.\n\
      stdin_input_raw accepts a pipe from a raw binary stream.\n\
+     generator 210 (shm_input_raw) instead reads raw binary straight out\n\
+     of a shared memory ring filled by another process, -f naming the\n\
+     ring, e.g. -g 210 -f /entropy.  See dieharder/shm_producer.c.\n\
   -B binary output (used with -o)\n\
   -D output flag - permits fields to be selected for inclusion in dieharder\n\
      output.  Each flag can be entered as a binary number that turns\n\
@@ -91,6 +103,13 @@ fprintf(stdout, "\n\
      -1 causes all known generators to be printed out to the display.\n\
   -h prints context-sensitive help -- usually Usage (this message) or a\n\
      test synopsis if entered as e.g. dieharder -D 3 -h.\n\
+  -j bits - stream the p-values of each test into a histogram of 2^bits\n\
+     bins (try 18) instead of keeping them all, so memory no longer grows\n\
+     with -p.  The final KS, Kuiper, AD and CvM p-values are computed from\n\
+     the histogram; -v with the kstest flag shows their error bounds.  -p\n\
+     beyond -P Xoff is cut to Xoff, so raise both for very long runs.\n\
+  -J prefix - with -j, also write every exact p-value as a raw double to\n\
+     a file named prefix.run.test.statistic, grown through mmap.\n\
   -k ks_flag - ks_flag\n\
 \n\
      0 is fast but slightly sloppy for psamples > 4999 (default).\n\
@@ -112,6 +131,13 @@ fprintf(stdout, "\n\
      sample modes. \n\
   -m multiply_p - multiply default # of psamples in -a(ll) runs to crank\n\
      up the resolution of failure.\n\
+  -M batch - tests every raw capture file in the directory batch (or named\n\
+     one per line in the file batch, - for stdin) in one process:  each\n\
+     (file,test) pair is a job for a thread per processor, each file is\n\
+     mapped once for all of its tests, and the results are one report of\n\
+     file|test_name|ntup|tsamples|psamples|p-value|assessment|rewinds\n\
+     lines in file order.  Every test reads each file from the start;\n\
+     add -b to give each its own range instead.\n\
   -n ntuple - set ntuple length for tests on short bit strings that permit\n\
      the length to be varied (e.g. rgb bitdist).\n\
   -o filename - output -t count random numbers from current generator to file.\n\
@@ -15,6 +15,7 @@ void output_rng_info(random_generator_t *cur_rng);
 void output_table_line_header();
 void output_table_line(Dtest *dtest,Test **test, unsigned long int seed);
 int output_histogram(double *input,char *pvlabel,int inum,double min,double max,int nbins,char *label);
+void output_histogram_bins(unsigned int *bin,int nbins,double binscale);
 
 void output(Dtest *dtest,Test **test, random_generator_t *cur_rng)
 {
@@ -94,6 +95,22 @@ void output(Dtest *dtest,Test **test, random_generator_t *cur_rng)
    }
  }
 
+ /*
+  * With a shared memory ring, say if the tests have been kept waiting
+  * for rands since the last test:  the results are fine, but it is the
+  * producer and not the tests that sets the pace.
+  */
+ {
+   static unsigned long long last_stalls = 0;
+   unsigned long long nread,cstalls,pstalls;
+   if(shm_input_stats(cur_rng->rng,&nread,&cstalls,&pstalls) == 0 && cstalls != last_stalls){
+     fprintf(stderr,"# The tests waited on the producer %llu times (%llu rands read, producer waited %llu times)\n",
+             cstalls - last_stalls,nread,pstalls);
+     fflush(stderr);
+     last_stalls = cstalls;
+   }
+ }
+
  /*
   * Everything below is the output PER TEST.  It cannot be skipped,
   * although I suppose it can be empty if no non-header output flags are
@@ -221,7 +238,7 @@ void output_rng_info(random_generator_t *cur_rng)
 void output_table_line_header()
 {
 
- unsigned int field = 0;
+ unsigned int i,field = 0;
 
  /*
   * We assemble the table header according to what tflag's value is.
@@ -299,6 +316,20 @@ void output_table_line_header()
    }
    field++;
  }
+
+ if(tflag & TGOF){
+   for(i=0;i<GOF_N;i++){
+     if(field){
+       fprintf(stdout,"%c",table_separator);
+     }
+     if(tflag & TNO_WHITE){
+       fprintf(stdout,"%s",gof_names[i]);
+     } else {
+       fprintf(stdout,"%10s",gof_names[i]);
+     }
+     field++;
+   }
+ }
  
  if(tflag & TASSESSMENT){
    if(field){
@@ -342,7 +373,7 @@ void output_table_line_header()
 void output_table_line(Dtest *dtest,Test **test, unsigned long int seed)
 {
 
- unsigned int i;
+ unsigned int i,j;
  unsigned int field;
 
  /*
@@ -370,7 +401,14 @@ void output_table_line(Dtest *dtest,Test **test, unsigned long int seed)
     * can trivially be turned off.
     */
    if(tflag & THISTOGRAM){
-     output_histogram(test[i]->pvalues,test[i]->pvlabel,test[i]->psamples,0.0,1.0,10,"p-values");
+     if(test[i]->ps != NULL){
+       /* Streaming mode kept only the sketch of the pvalues */
+       unsigned int bin[10];
+       pstream_bins(test[i]->ps,10,bin);
+       output_histogram_bins(bin,10,0.1);
+     } else {
+       output_histogram(test[i]->pvalues,test[i]->pvlabel,test[i]->psamples,0.0,1.0,10,"p-values");
+     }
      if(tflag & TLINE_HEADER){
        output_table_line_header();
      }
@@ -452,6 +490,16 @@ void output_table_line(Dtest *dtest,Test **test, unsigned long int seed)
      field++;
    }
 
+   if(tflag & TGOF){
+     for(j=0;j<GOF_N;j++){
+       if(field != 0){
+         fprintf(stdout,"%c",table_separator);
+       }
+       fprintf(stdout,"%10.8f",test[i]->gof_pvalues[j]);
+       field++;
+     }
+   }
+
    /*
     * Here is where dieharder sets is assessment.  Note that the
     * assessment MUST be correctly interpreted.  Basically, we set things
@@ -544,10 +592,9 @@ void output_table_line(Dtest *dtest,Test **test, unsigned long int seed)
 int output_histogram(double *input,char *pvlabel,int inum,double min,double max,int nbins,char *label)
 {
 
- int i,j,hindex;
- unsigned int *bin,binmax;
+ int i,hindex;
+ unsigned int *bin;
  double binscale;
- unsigned int vscale;
 
  /*
   * This is where we put the binned count(s).  Make and zero it
@@ -566,7 +613,37 @@ int output_histogram(double *input,char *pvlabel,int inum,double min,double max,
   * of e.g. sorting first because we don't quibble about microseconds
   * of run time...
   */
+ for(i=0;i<inum;i++){
+   hindex = (int) (input[i]/binscale);
+   /* printf("ks_pvalue = %f: bin[%d] = ",input[i],hindex); */
+   if(hindex < 0) hindex = 0;
+   if(hindex >= nbins) hindex = nbins-1;
+   bin[hindex]++;
+   /* printf("%d\n",bin[hindex]); */
+ }
+ output_histogram_bins(bin,nbins,binscale);
+ free(bin);
+
+ return(0);
+
+}
+
+/*
+ * Display bin[0..nbins-1], counts in bins of width binscale.  Streaming
+ * mode (see pstream.c) comes straight here with the counts from its
+ * sketch.
+ */
+void output_histogram_bins(unsigned int *bin,int nbins,double binscale)
+{
+
+ int i,j;
+ unsigned int binmax;
+ unsigned int vscale;
+
  binmax = 0;
+ for(i=0;i<nbins;i++){
+   if(bin[i] > binmax) binmax = bin[i];
+ }
 
  /*
   * The only reason anyone might use histogram is so they can see
@@ -579,16 +656,7 @@ int output_histogram(double *input,char *pvlabel,int inum,double min,double max,
  printf("#                         Histogram of test p-values                          #\n");
  printf("#=============================================================================#\n");
  printf("# Bin scale = %f\n",binscale);
- for(i=0;i<inum;i++){
-   hindex = (int) (input[i]/binscale);
-   /* printf("ks_pvalue = %f: bin[%d] = ",input[i],hindex); */
-   if(hindex < 0) hindex = 0;
-   if(hindex >= nbins) hindex = nbins-1;
-   bin[hindex]++;
-   if(bin[hindex] > binmax) binmax = bin[hindex];
-   /* printf("%d\n",bin[hindex]); */
- }
- 
+
  /*
   * OK, at this point bin[] contains a histogram of the data.  All that
   * remains is to make a scaling decision and display it.  We'll
@@ -630,7 +698,5 @@ int output_histogram(double *input,char *pvlabel,int inum,double min,double max,
  printf("#=============================================================================#\n");
  fflush(stdout);
 
- return(0);
-
 }
 
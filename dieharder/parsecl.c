@@ -75,11 +75,17 @@ void parsecl(int argc, char **argv)
     exit(1); /* count this as an error */
  }
 
- while ((c = getopt(argc,argv,"aBc:D:d:e:E:Ff:g:hI:i:k:lL:m:n:o:O:p:P:qS:s:t:Vv:W:X:x:Y:y:Z:z:")) != EOF){
+ while ((c = getopt(argc,argv,"aAbBc:D:d:e:E:Ff:g:hI:i:k:j:J:lL:m:M:n:o:O:p:P:qS:s:t:Vv:W:X:x:Y:y:Z:z:")) != EOF){
    switch (c){
+     case 'A':
+       fanout_flag = YES;
+       break;
      case 'a':
        all = YES;
        break;
+     case 'b':
+       plan_flag = YES;
+       break;
      case 'B':
        binary = 1;
        break;
@@ -101,7 +107,7 @@ void parsecl(int argc, char **argv)
 	  * then try to lookup a string instead and convert to
 	  * the index/number needed.
 	  */
-	 for(i=0;i<TCNT;i++){
+	 for(i=0;i<=TCNT;i++){
 	   if(strncmp(optarg,table_fields[i],TLENGTH) == 0){
              /* printf("Setting table option %s.\n",optarg); */
 	     /*
@@ -116,7 +122,7 @@ void parsecl(int argc, char **argv)
 	     break;
 	   }
 	 }
-	 if(i == TCNT) {
+	 if(i > TCNT) {
 	   fprintf(stderr,"Invalid -T %s option.\n",optarg);
 	   exit(1);
 	 }
@@ -199,6 +205,13 @@ void parsecl(int argc, char **argv)
      case 'i': /* filename input for etalon random generator */
        add_filename(erng_params, optarg);
        break;
+     case 'j':
+       pstream = strtol(optarg,(char **) NULL,10);
+       break;
+     case 'J':
+       strncpy(pstream_spill,optarg,K-1);
+       pstream_spill[K-1] = 0;
+       break;
      case 'k':
        ks_test = strtol(optarg,(char **) NULL,10);
        break;
@@ -215,6 +228,9 @@ void parsecl(int argc, char **argv)
         * more information (the number of p-samples) is available.
         */
        break;
+     case 'M':
+       strncpy(batch_path,optarg,K-1);
+       break;
      case 'n':
        ntuple = strtol(optarg,(char **) NULL,10);
        break;
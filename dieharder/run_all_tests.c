@@ -181,35 +181,15 @@ void run_all_tests()
        break;
 
      /*
-      * Test 203 is rgb_lagged_sums, and needs an ntuple set/loop.
+      * Test 203 is rgb_lagged_sums.  We used to sweep it over lags 0-32
+      * here, but lags 1 and up are all covered in a single pass by
+      * rgb_autocorr (test 210) below, so by default we only run lag 0
+      * (the plain sum).
       */
      case 203:
 
        if(dh_test_types[dtest_num]){
-
-         if(ntuple){
-           /*
-            * If ntuple is set to be nonzero, just use that value in "all".
-            */
-           execute_test(dtest_num);
-         } else {
-           /*
-            * Do all lags from 0 to 32.
-            */
-           ntmin = 0;
-           ntmax = 32;
-           /* printf("Setting ntmin = %d ntmax = %d\n",ntmin,ntmax); */
-           for(ntuple = ntmin;ntuple <= ntmax;ntuple++){
-	     execute_test(dtest_num);
-	   }
-           /*
-            * This RESTORES ntuple = 0, which is the only way we could have
-            * gotten here in the first place!
-            */
-
-           ntuple = 0;
-	   
-	 }
+         execute_test(dtest_num);
        }
        break;
 
@@ -243,6 +223,16 @@ void run_all_tests()
        }
        break;
 
+     /*
+      * Test 210 is rgb_autocorr.
+      */
+     case 210:
+
+       if(dh_test_types[dtest_num]){
+         execute_test(dtest_num);
+       }
+       break;
+
      default:
        printf("Preparing to run test %d.  ntuple = %d\n",dtest_num,ntuple);
        if(dh_test_types[dtest_num]){   /* This is the fallback to normal tests */
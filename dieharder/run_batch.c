@@ -0,0 +1,449 @@
+/*
+ *========================================================================
+ * See copyright in copyright.h and the accompanying file COPYING
+ *========================================================================
+ */
+
+/*
+ *========================================================================
+ * Batch mode (-M path) tests a whole directory (or a list) of raw
+ * capture files in one process.  The tests selected as usual (-a, -d
+ * ...) are lined up once by execute_test(), just as for -A, and then
+ * every (file, test) pair is a job for a pool of worker threads, one per
+ * processor.  Each file is mapped into memory once, when its first test
+ * starts, and every test on it reads its own view of the mapping (the
+ * whole file, as with -A, or with -b its own planned range of it, see
+ * libdieharder/plan.c); the mapping goes once its last test is done.
+ *
+ * The tests keep a little state of their own in places, so no test ever
+ * runs on two files (or at two ntuples) at once:  a free worker takes
+ * the test that isn't running anywhere and is furthest behind, on its
+ * next file.  No test is allowed to get more than BATCH_WINDOW files
+ * ahead of the slowest one, which bounds how many files are mapped at
+ * a time.
+ *
+ * Instead of the usual table, the results are one consolidated report,
+ * one line per file, test and statistic, in file order, with the fields
+ * separated by the -c separator (| by default):
+ *
+ *   file|test_name|ntup|tsamples|psamples|p-value|assessment|rewinds
+ *
+ * where rewinds counts how many times the test ran out of its data and
+ * started over (0 is what you want).  A file that can't be read gets an
+ * ERROR line per test.
+ *========================================================================
+ */
+
+/* opendir(), mmap() and friends are POSIX, not c99 */
+#define _DEFAULT_SOURCE
+#include "dieharder.h"
+#include <pthread.h>
+#include <dirent.h>
+
+#define BATCH_WINDOW 64
+
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+typedef struct {
+  int dtest_num;
+  unsigned int ntuple;          /* The -a loop's ntuple when it was lined up */
+  unsigned int psamples;        /* As create_test() sets them */
+  unsigned long long words;     /* Rands per psample (-b) */
+  unsigned int group;           /* The first spec of the same test */
+  unsigned int busy;            /* (group) The test is running right now */
+  unsigned int next;            /* The next file it runs on */
+} batch_spec_t;
+
+typedef struct {
+  char *name;
+  file_map_t *map;              /* NULL until opened, or if it can't be */
+  unsigned int opened;
+  unsigned int finished;        /* Tests done with it */
+  unsigned int *psamples;       /* -b:  each test's psamples, */
+  unsigned long long *start;    /* and range */
+  unsigned long long *len;
+} batch_file_t;
+
+static batch_spec_t *batch_specs = NULL;
+static unsigned int batch_nspecs = 0;
+static unsigned int batch_maxspecs = 0;
+static batch_file_t *batch_files = NULL;
+static unsigned int batch_nfiles = 0;
+static char **batch_report = NULL;     /* [file*nspecs + spec] */
+static unsigned int batch_printed = 0;  /* Jobs printed so far, in order */
+static unsigned int batch_oldest = 0;   /* First file not yet finished */
+static pthread_mutex_t batch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t batch_free = PTHREAD_COND_INITIALIZER;
+
+static void batch_add_file(const char *name)
+{
+
+ static unsigned int maxfiles = 0;
+
+ if(batch_nfiles == maxfiles){
+   maxfiles = maxfiles ? 2*maxfiles : 256;
+   batch_files = (batch_file_t *)realloc(batch_files,maxfiles*sizeof(batch_file_t));
+ }
+ memset(&batch_files[batch_nfiles],0,sizeof(batch_file_t));
+ batch_files[batch_nfiles].name = strdup(name);
+ batch_nfiles++;
+
+}
+
+static int batch_compare(const void *a,const void *b)
+{
+
+ return strcmp(((const batch_file_t *) a)->name,((const batch_file_t *) b)->name);
+
+}
+
+/*
+ * Fill batch_files[] from batch_path:  every regular file in it (in
+ * name order) if it is a directory, else the file names listed in it
+ * one per line ("-" reads the list from stdin).  Blank lines and lines
+ * starting with # are skipped.
+ */
+static void batch_list()
+{
+
+ struct stat sbuf;
+ DIR *dir;
+ struct dirent *entry;
+ FILE *fp;
+ char name[PATH_MAX];
+ int len;
+ size_t n;
+
+ if(strcmp(batch_path,"-") != 0 && stat(batch_path,&sbuf) == 0 && S_ISDIR(sbuf.st_mode)){
+   dir = opendir(batch_path);
+   if(dir == NULL){
+     fprintf(stderr,"Error:  cannot open directory %s.\n",batch_path);
+     exit(1);
+   }
+   while((entry = readdir(dir)) != NULL){
+     len = snprintf(name,sizeof(name),"%s/%s",batch_path,entry->d_name);
+     if(len < 0 || (size_t) len >= sizeof(name)){
+       fprintf(stderr,"# Warning:  skipping %s in %s, the path is too long.\n",entry->d_name,batch_path);
+       continue;
+     }
+     if(stat(name,&sbuf) == 0 && S_ISREG(sbuf.st_mode)) batch_add_file(name);
+   }
+   closedir(dir);
+   if(batch_nfiles > 1) qsort(batch_files,batch_nfiles,sizeof(batch_file_t),batch_compare);
+ } else {
+   fp = (strcmp(batch_path,"-") == 0) ? stdin : fopen(batch_path,"r");
+   if(fp == NULL){
+     fprintf(stderr,"Error:  cannot open file list %s.\n",batch_path);
+     exit(1);
+   }
+   while(fgets(name,sizeof(name),fp) != NULL){
+     n = strlen(name);
+     while(n > 0 && (name[n-1] == '\n' || name[n-1] == '\r')) name[--n] = 0;
+     if(n == 0 || name[0] == '#') continue;
+     batch_add_file(name);
+   }
+   if(fp != stdin) fclose(fp);
+ }
+
+}
+
+/*
+ * Called right after parsecl():  make the file list, and set the
+ * generator up as file_input_raw on the first file, so the tests see a
+ * generator with exactly the properties of a capture file.
+ */
+void batch_setup()
+{
+
+ batch_list();
+ if(batch_nfiles == 0){
+   fprintf(stderr,"Error:  no files to test in %s.\n",batch_path);
+   exit(1);
+ }
+ generator.params.gvcount = 0;
+ generator.params.fcount = 0;
+ add_gname(&generator.params,"file_input_raw");
+ add_filename(&generator.params,batch_files[0].name);
+ fromfile = 1;
+
+}
+
+void batch_queue(int dtest_num)
+{
+
+ Dtest *dtest = dh_test_types[dtest_num];
+ Test **test;
+ batch_spec_t *spec;
+
+ if(batch_nspecs == batch_maxspecs){
+   batch_maxspecs = batch_maxspecs ? 2*batch_maxspecs : 64;
+   batch_specs = (batch_spec_t *)realloc(batch_specs,batch_maxspecs*sizeof(batch_spec_t));
+ }
+ spec = &batch_specs[batch_nspecs];
+ spec->dtest_num = dtest_num;
+ spec->ntuple = ntuple;
+ spec->busy = 0;
+ spec->next = 0;
+ for(spec->group=0;batch_specs[spec->group].dtest_num != dtest_num;spec->group++);
+ spec->words = 0;
+
+ /*
+  * What the test will look like on every file, and with -b how many
+  * rands it uses (the same on every file, so we only count once).
+  */
+ test = create_test(dtest,tsamples,psamples);
+ spec->psamples = test[0]->psamples;
+ if(plan_flag) spec->words = test_words(dtest,test,&generator,PLAN_CALIBRATE);
+ destroy_test(dtest,test);
+ batch_nspecs++;
+
+}
+
+/*
+ * Map file f and, with -b, plan it.  Called with the lock held.
+ */
+static void batch_open(unsigned int f)
+{
+
+ unsigned int i;
+ unsigned long long avail,start;
+ unsigned long long *words;
+ batch_file_t *file = &batch_files[f];
+
+ file->opened = 1;
+ file->map = file_map_open(file->name);
+ if(file->map == NULL){
+   fprintf(stderr,"# Warning:  cannot map %s, skipping it.\n",file->name);
+   return;
+ }
+ if(!plan_flag) return;
+
+ avail = file_map_len(file->map);
+ file->psamples = (unsigned int *)malloc(batch_nspecs*sizeof(unsigned int));
+ file->start = (unsigned long long *)malloc(batch_nspecs*sizeof(unsigned long long));
+ file->len = (unsigned long long *)malloc(batch_nspecs*sizeof(unsigned long long));
+ words = (unsigned long long *)malloc(batch_nspecs*sizeof(unsigned long long));
+ for(i=0;i<batch_nspecs;i++){
+   file->psamples[i] = batch_specs[i].psamples;
+   words[i] = batch_specs[i].words;
+ }
+ if(plan_ranges(batch_nspecs,words,file->psamples,avail,file->len) == 0.0){
+   fprintf(stderr,"# Warning:  capture too short for %u tests:  %s (%llu rands) can't hold even one psample of each, skipping it.\n",
+           batch_nspecs,file->name,avail);
+   file_map_close(file->map);
+   file->map = NULL;
+ } else {
+   start = 0;
+   for(i=0;i<batch_nspecs;i++){
+     file->start[i] = start;
+     start += file->len[i];
+   }
+ }
+ nullfree(words);
+
+}
+
+/*
+ * Print every finished job we can in order, and move batch_oldest on.
+ * Called with the lock held.
+ */
+static void batch_flush()
+{
+
+ unsigned int total = batch_nfiles*batch_nspecs;
+
+ while(batch_printed < total && batch_report[batch_printed] != NULL){
+   fputs(batch_report[batch_printed],stdout);
+   nullfree(batch_report[batch_printed]);
+   batch_printed++;
+ }
+ fflush(stdout);
+ while(batch_oldest < batch_nfiles && batch_files[batch_oldest].finished == batch_nspecs){
+   batch_oldest++;
+ }
+
+}
+
+/*
+ * The report lines for one finished job, in a freshly allocated string.
+ */
+static char *batch_lines(batch_file_t *file,Dtest *dtest,Test **test,unsigned int rewinds)
+{
+
+ unsigned int k;
+ size_t size,used;
+ char *buf,*assess;
+ char s = table_separator;
+
+ size = (size_t)dtest->nkps*(strlen(file->name) + strlen(dtest->sname) + 128);
+ buf = (char *)malloc(size);
+ used = 0;
+ for(k=0;k<dtest->nkps;k++){
+   if(test == NULL){
+     used += snprintf(buf + used,size - used,"%s%c%s%c0%c0%c0%cnan%cERROR%c0\n",
+                      file->name,s,dtest->sname,s,s,s,s,s,s);
+     continue;
+   }
+   if(test[k]->ks_pvalue < Xfail || test[k]->ks_pvalue > 1.0 - Xfail){
+     assess = "FAILED";
+   } else if(test[k]->ks_pvalue < Xweak || test[k]->ks_pvalue > 1.0 - Xweak){
+     assess = "WEAK";
+   } else {
+     assess = "PASSED";
+   }
+   used += snprintf(buf + used,size - used,"%s%c%s%c%u%c%u%c%u%c%.8f%c%s%c%u\n",
+                    file->name,s,dtest->sname,s,test[k]->ntuple,s,test[k]->tsamples,s,
+                    test[k]->psamples,s,test[k]->ks_pvalue,s,assess,s,rewinds);
+ }
+ return buf;
+
+}
+
+static void *batch_worker(void *arg)
+{
+
+ unsigned int i,k,t,f,need_more_p,rewinds;
+ batch_spec_t *spec;
+ batch_file_t *file;
+ Dtest *dtest;
+ Test **test;
+ random_generator_t rng;
+ gsl_rng *view;
+ char *lines;
+
+ pthread_mutex_lock(&batch_lock);
+ for(;;){
+
+   /*
+    * The idle test furthest behind, if it isn't too far ahead of the
+    * slowest.  If there is none but some test still has files to do,
+    * wait for a test to come free.
+    */
+   t = batch_nspecs;
+   for(i=0;i<batch_nspecs;i++){
+     spec = &batch_specs[i];
+     if(batch_specs[spec->group].busy || spec->next >= batch_nfiles) continue;
+     if(spec->next >= batch_oldest + BATCH_WINDOW) continue;
+     if(t == batch_nspecs || spec->next < batch_specs[t].next) t = i;
+   }
+   if(t == batch_nspecs){
+     for(i=0;i<batch_nspecs;i++){
+       if(batch_specs[i].next < batch_nfiles) break;
+     }
+     if(i == batch_nspecs) break;
+     pthread_cond_wait(&batch_free,&batch_lock);
+     continue;
+   }
+   spec = &batch_specs[t];
+   f = spec->next++;
+   batch_specs[spec->group].busy = 1;
+   file = &batch_files[f];
+   dtest = dh_test_types[spec->dtest_num];
+   if(!file->opened) batch_open(f);
+
+   test = NULL;
+   view = NULL;
+   if(file->map != NULL){
+     /* create_test() keeps a count and reads the globals */
+     test = create_test(dtest,tsamples,psamples);
+     for(k=0;k<dtest->nkps;k++){
+       test[k]->ntuple_cl = spec->ntuple;
+       if(plan_flag) test[k]->psamples = file->psamples[t];
+     }
+     if(plan_flag){
+       view = file_map_rng(file->map,file->start[t],file->len[t]);
+     } else {
+       view = file_map_rng(file->map,0,file_map_len(file->map));
+     }
+     /* No view, no test:  the report gets ERROR lines for it */
+     if(view == NULL){
+       fprintf(stderr,"# Warning:  cannot read %s for %s, skipping it.\n",file->name,dtest->sname);
+       destroy_test(dtest,test);
+       test = NULL;
+     }
+   }
+   pthread_mutex_unlock(&batch_lock);
+
+   rewinds = 0;
+   if(test != NULL){
+     rng = generator;
+     rng.rng = view;
+     reset_bit_buffers(&rng.read_buffer);
+     test[0]->rng = &rng;
+     need_more_p = YES;
+     while(need_more_p){
+       std_test(dtest,test,NULL);
+       need_more_p = more_psamples(dtest,test);
+     }
+     rewinds = file_range_rewinds(view);
+     file_range_free(view);
+   }
+   lines = batch_lines(file,dtest,test,rewinds);
+   if(test != NULL) destroy_test(dtest,test);
+
+   pthread_mutex_lock(&batch_lock);
+   batch_report[f*batch_nspecs + t] = lines;
+   batch_specs[spec->group].busy = 0;
+   file->finished++;
+   if(file->finished == batch_nspecs){
+     file_map_close(file->map);
+     file->map = NULL;
+     nullfree(file->psamples);
+     nullfree(file->start);
+     nullfree(file->len);
+   }
+   batch_flush();
+   pthread_cond_broadcast(&batch_free);
+ }
+ pthread_mutex_unlock(&batch_lock);
+ return NULL;
+
+}
+
+void run_batch()
+{
+
+ unsigned int i,nthreads,ngroups;
+ long ncpu;
+ pthread_t *thread;
+ char s = table_separator;
+
+ if(batch_nspecs == 0) return;
+
+ /* There's no use in more threads than different tests */
+ ngroups = 0;
+ for(i=0;i<batch_nspecs;i++){
+   if(batch_specs[i].group == i) ngroups++;
+ }
+ ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+ nthreads = (ncpu > 0) ? (unsigned int) ncpu : 1;
+ if(nthreads > ngroups) nthreads = ngroups;
+
+ batch_report = (char **)calloc((size_t)batch_nfiles*batch_nspecs,sizeof(char *));
+ if(!quiet){
+   fprintf(stdout,"# dieharder batch:  %u files x %u tests on %u threads\n",
+           batch_nfiles,batch_nspecs,nthreads);
+ }
+ fprintf(stdout,"file%ctest_name%cntup%ctsamples%cpsamples%cp-value%cassessment%crewinds\n",
+         s,s,s,s,s,s,s);
+ fflush(stdout);
+
+ thread = (pthread_t *)malloc(nthreads*sizeof(pthread_t));
+ for(i=0;i<nthreads;i++){
+   if(pthread_create(&thread[i],NULL,batch_worker,NULL) != 0){
+     fprintf(stderr,"Error:  cannot start a batch thread.\n");
+     exit(1);
+   }
+ }
+ for(i=0;i<nthreads;i++) pthread_join(thread[i],NULL);
+ nullfree(thread);
+
+ for(i=0;i<batch_nfiles;i++) nullfree(batch_files[i].name);
+ nullfree(batch_files);
+ nullfree(batch_report);
+ nullfree(batch_specs);
+ batch_nfiles = batch_nspecs = batch_maxspecs = 0;
+
+}
@@ -0,0 +1,301 @@
+/*
+ *========================================================================
+ * See copyright in copyright.h and the accompanying file COPYING
+ *========================================================================
+ */
+
+/*
+ *========================================================================
+ * -A runs the selected tests (usually -a) all at once on ONE pass over
+ * the generator's stream, instead of one after another on successive
+ * slices of it.  execute_test() just creates each test and lines it up
+ * here; run_fanout() then starts one thread per distinct test, each
+ * reading the whole stream from the beginning through its own consumer
+ * of a fanout_t (see libdieharder/fanout.c), and prints the results in
+ * the usual order as they come in.
+ *
+ * The instances of one test (e.g. rgb_bitdist at each ntuple in -a) run
+ * one after another on the same thread, both because the tests keep a
+ * little state of their own and so that they read successive slices of
+ * the stream just as they would without -A.  In TTD/RA (-Y) mode only
+ * the final result of each test is shown.
+ *
+ * -b runs the tests the same way on a file_input_raw capture file, but
+ * instead of sharing the stream each test gets a range of the file all
+ * its own (see run_plan() below and libdieharder/plan.c).
+ *========================================================================
+ */
+
+#include "dieharder.h"
+#include <pthread.h>
+
+typedef struct {
+  int dtest_num;
+  Test **test;
+  unsigned int group;
+  gsl_rng *range;               /* Its range of the file (-b), else NULL */
+  random_generator_t rng;       /* ...and its view of the generator on it */
+} fanout_job_t;
+
+typedef struct {
+  int dtest_num;
+  fanout_t *f;
+  unsigned int id;              /* Its consumer number in f */
+  random_generator_t rng;       /* Its own view of the generator */
+  pthread_t thread;
+  int joined;
+} fanout_group_t;
+
+static fanout_job_t *fanout_jobs = NULL;
+static unsigned int fanout_njobs = 0;
+static unsigned int fanout_maxjobs = 0;
+static fanout_group_t *fanout_groups = NULL;
+
+void fanout_queue(int dtest_num)
+{
+
+ if(fanout_njobs == fanout_maxjobs){
+   fanout_maxjobs = fanout_maxjobs ? 2*fanout_maxjobs : 64;
+   fanout_jobs = (fanout_job_t *)realloc(fanout_jobs,fanout_maxjobs*sizeof(fanout_job_t));
+ }
+ fanout_jobs[fanout_njobs].dtest_num = dtest_num;
+ /* This is where the ntuple of an -a loop is picked up */
+ fanout_jobs[fanout_njobs].test = create_test(dh_test_types[dtest_num],tsamples,psamples);
+ fanout_jobs[fanout_njobs].range = NULL;
+ fanout_njobs++;
+
+}
+
+static void *fanout_run_group(void *arg)
+{
+
+ unsigned int j;
+ unsigned int need_more_p;
+ fanout_group_t *g = (fanout_group_t *) arg;
+ Dtest *dtest = dh_test_types[g->dtest_num];
+ Test **test;
+
+ for(j=0;j<fanout_njobs;j++){
+   if(fanout_jobs[j].group != g->id) continue;
+   test = fanout_jobs[j].test;
+   test[0]->rng = (fanout_jobs[j].range != NULL) ? &fanout_jobs[j].rng : &g->rng;
+   need_more_p = YES;
+   while(need_more_p){
+     std_test(dtest,test,NULL);
+     need_more_p = more_psamples(dtest,test);
+   }
+ }
+ if(g->f != NULL) fanout_done(g->f,g->id);
+ return NULL;
+
+}
+
+/*
+ * Count the rands each of a group's tests uses (-b).
+ */
+static void *fanout_count_group(void *arg)
+{
+
+ unsigned int j;
+ fanout_group_t *g = (fanout_group_t *) arg;
+
+ for(j=0;j<fanout_njobs;j++){
+   if(fanout_jobs[j].group != g->id) continue;
+   test_words(dh_test_types[g->dtest_num],fanout_jobs[j].test,&generator,PLAN_CALIBRATE);
+ }
+ return NULL;
+
+}
+
+/*
+ * One group (thread) per distinct test.  Returns the number of groups.
+ */
+static unsigned int fanout_group_jobs()
+{
+
+ unsigned int i,j,ngroups;
+
+ fanout_groups = (fanout_group_t *)malloc(fanout_njobs*sizeof(fanout_group_t));
+ ngroups = 0;
+ for(j=0;j<fanout_njobs;j++){
+   for(i=0;i<ngroups;i++){
+     if(fanout_groups[i].dtest_num == fanout_jobs[j].dtest_num) break;
+   }
+   if(i == ngroups){
+     fanout_groups[i].dtest_num = fanout_jobs[j].dtest_num;
+     fanout_groups[i].f = NULL;
+     fanout_groups[i].id = i;
+     fanout_groups[i].joined = 0;
+     fanout_groups[i].rng = generator;
+     ngroups++;
+   }
+   fanout_jobs[j].group = i;
+ }
+ return ngroups;
+
+}
+
+static void fanout_start_groups(unsigned int ngroups,void *(*run)(void *))
+{
+
+ unsigned int i;
+
+ for(i=0;i<ngroups;i++){
+   fanout_groups[i].joined = 0;
+   if(pthread_create(&fanout_groups[i].thread,NULL,run,&fanout_groups[i]) != 0){
+     fprintf(stderr,"Error:  cannot start a test thread.\n");
+     exit(1);
+   }
+ }
+
+}
+
+/*
+ * Results go out in the order the tests were lined up in, each as soon
+ * as its thread is through.
+ */
+static void fanout_finish()
+{
+
+ unsigned int j,n;
+ fanout_group_t *g;
+ Dtest *dtest;
+
+ for(j=0;j<fanout_njobs;j++){
+   g = &fanout_groups[fanout_jobs[j].group];
+   dtest = dh_test_types[fanout_jobs[j].dtest_num];
+   if(!g->joined){
+     pthread_join(g->thread,NULL);
+     g->joined = 1;
+   }
+   n = file_range_rewinds(fanout_jobs[j].range);
+   if(n != 0){
+     fprintf(stderr,"# %s ran past the end of its range of the file and reread it %u times\n",
+             dtest->sname,n);
+     fflush(stderr);
+   }
+   output(dtest,fanout_jobs[j].test,&generator);
+   destroy_test(dtest,fanout_jobs[j].test);
+   file_range_free(fanout_jobs[j].range);
+ }
+ nullfree(fanout_groups);
+ nullfree(fanout_jobs);
+ fanout_njobs = fanout_maxjobs = 0;
+
+}
+
+void run_fanout()
+{
+
+ unsigned int i,ngroups;
+ fanout_t *f;
+ fanout_group_t *g;
+
+ if(fanout_njobs == 0) return;
+
+ ngroups = fanout_group_jobs();
+ f = fanout_alloc(generator.rng,ngroups);
+ for(i=0;i<ngroups;i++){
+   g = &fanout_groups[i];
+   g->f = f;
+   g->rng.rng = fanout_consumer(f,i);
+   reset_bit_buffers(&g->rng.read_buffer);
+ }
+ if(fanout_start(f) != 0){
+   fprintf(stderr,"Error:  cannot start the -A reader thread.\n");
+   exit(1);
+ }
+ fanout_start_groups(ngroups,fanout_run_group);
+ fanout_finish();
+ fanout_free(f);
+
+}
+
+/*
+ * -b:  first every test is run for a couple of psamples on a counting
+ * stand-in for the file to see how many rands a psample uses (all of
+ * the tests at once, one thread per test as above).  Then the tests are
+ * given back to back ranges of what is left of the file, each as long
+ * as its psamples need plus a margin, and whatever is left over is
+ * shared out in proportion.  If the file is too short, every test's
+ * psamples are cut by the same factor until it isn't, with a warning;
+ * if it can't even hold one psample of each test, we give up.  Finally
+ * the tests run at once, each reading only its own range, with pread()
+ * so they don't share a file pointer.  Extra psamples added in -Y modes
+ * aren't planned for; a test that runs past its range rereads it, and
+ * says so.
+ */
+void run_plan()
+{
+
+ unsigned int i,j,k,ngroups;
+ unsigned long long avail,start;
+ unsigned long long *words,*len;
+ unsigned int *p;
+ double scale;
+ file_input_state_t *state;
+ Dtest *dtest;
+ Test **test;
+
+ if(fanout_njobs == 0) return;
+
+ state = (file_input_state_t *) generator.rng->state;
+ if(state->flen == 0){
+   fprintf(stderr,"# Warning:  -b needs a regular file.  Running the tests with -A instead.\n");
+   run_fanout();
+   return;
+ }
+ avail = (unsigned long long)(state->flen - state->rptr);
+
+ ngroups = fanout_group_jobs();
+ fanout_start_groups(ngroups,fanout_count_group);
+ for(i=0;i<ngroups;i++) pthread_join(fanout_groups[i].thread,NULL);
+
+ words = (unsigned long long *)malloc(fanout_njobs*sizeof(unsigned long long));
+ len = (unsigned long long *)malloc(fanout_njobs*sizeof(unsigned long long));
+ p = (unsigned int *)malloc(fanout_njobs*sizeof(unsigned int));
+ for(j=0;j<fanout_njobs;j++){
+   words[j] = fanout_jobs[j].test[0]->words;
+   p[j] = fanout_jobs[j].test[0]->psamples;
+ }
+ scale = plan_ranges(fanout_njobs,words,p,avail,len);
+ if(scale == 0.0){
+   fprintf(stderr,"Error:  capture too short for %u tests:  %s (%llu rands) can't hold even one psample of each.\n",
+           fanout_njobs,state->filename,avail);
+   exit(1);
+ }
+ if(scale < 1.0){
+   fprintf(stderr,"# Warning:  %s holds only %llu rands.  Scaling psamples by %.4f to fit.\n",
+           state->filename,avail,scale);
+ }
+
+ /*
+  * Back to back ranges, starting wherever the file is now.
+  */
+ start = (unsigned long long) state->rptr;
+ for(j=0;j<fanout_njobs;j++){
+   dtest = dh_test_types[fanout_jobs[j].dtest_num];
+   test = fanout_jobs[j].test;
+   for(k=0;k<dtest->nkps;k++) test[k]->psamples = p[j];
+   fanout_jobs[j].range = file_range_alloc(state->filename,start,len[j]);
+   if(fanout_jobs[j].range == NULL){
+     fprintf(stderr,"Error:  cannot read %s.\n",state->filename);
+     exit(1);
+   }
+   fanout_jobs[j].rng = generator;
+   fanout_jobs[j].rng.rng = fanout_jobs[j].range;
+   reset_bit_buffers(&fanout_jobs[j].rng.read_buffer);
+   MYDEBUG(D_STD_TEST){
+     printf("# run_plan(): %s (ntuple %u) %u psamples x %llu rands -> rands %llu to %llu\n",
+            dtest->sname,test[0]->ntuple_cl,p[j],words[j],start,start + len[j] - 1);
+   }
+   start += len[j];
+ }
+ nullfree(words);
+ nullfree(len);
+ nullfree(p);
+
+ fanout_start_groups(ngroups,fanout_run_group);
+ fanout_finish();
+
+}
@@ -38,12 +38,66 @@ void run_test()
 }
 
 
-int execute_test(int dtest_num)
+/*
+ * Decide, by -Y Xtrategy, whether test needs more psamples after a
+ * call to std_test().
+ */
+unsigned int more_psamples(Dtest *dtest,Test **test)
 {
 
  int i;
  unsigned int need_more_p;
  double smallest_p;
+
+ smallest_p = 0.5;
+ for(i = 0; i < dtest->nkps ; i++){
+   if(0.5 - fabs(test[i]->ks_pvalue - 0.5) < smallest_p) {
+     smallest_p = 0.5 - fabs(test[i]->ks_pvalue - 0.5);
+   }
+ }
+ need_more_p = YES;
+ switch(Xtrategy){
+   /*
+    * This just runs std_test a single time, period, for good or ill.
+    */
+   default:
+   case 0:
+     need_more_p = NO;
+     break;
+   /*
+    *             Resolve Ambiguity (RA) mode
+    *
+    * If any test has a p that is less than Xfail, we are done.
+    * If the entire test has pvalues that are bigger than Xweak,
+    * we are done (we really need this to happen e.g. 3x consecutively
+    * or exceed a much larger threshold, but that is more work to code
+    * and I want to be certain of the algorithm first).  If the test
+    * has accumulated Xoff psamples, we are done.
+    */
+   case 1:
+     if(smallest_p < Xfail) need_more_p = NO;
+     if(smallest_p >= Xweak) need_more_p = NO;
+     if(test[0]->psamples >= Xoff) need_more_p = NO;
+     break;
+   /*
+    *             Test To Destruction (TTD) mode
+    *
+    * If any test has a p that is less than Xfail, we are done.
+    * If the test has accumulated Xoff psamples, we are done.
+    */
+   case 2:
+     if(smallest_p < Xfail) need_more_p = NO;
+     if(test[0]->psamples >= Xoff) need_more_p = NO;
+     break;
+ }
+ return need_more_p;
+
+}
+
+int execute_test(int dtest_num)
+{
+
+ unsigned int need_more_p;
  /*
   * Declare the results struct.
   */
@@ -52,6 +106,20 @@ int execute_test(int dtest_num)
  /* The results struct for the test of the reference rng. */
  Test **ref_test;
 
+ /*
+  * In a batch (-M) we only line the test up here, to be run on every
+  * file by run_batch().  Likewise in a fan-out (-A) or planned (-b) run
+  * run_fanout() or run_plan() runs it later, alongside all the others.
+  */
+ if(batch_path[0] != 0){
+   batch_queue(dtest_num);
+   return(0);
+ }
+ if(fanout_flag || plan_flag){
+   fanout_queue(dtest_num);
+   return(0);
+ }
+
  /*
   * Here we have to look at strategy FIRST.  If strategy is not zero,
   * we have to reseed either randomly or from the value of nonzero Seed.
@@ -107,46 +175,7 @@ int execute_test(int dtest_num)
  while(need_more_p){
    std_test(dh_test_types[dtest_num],dieharder_test, ref_test);
    output(dh_test_types[dtest_num],dieharder_test, &generator);
-   smallest_p = 0.5;
-   for(i = 0; i < dh_test_types[dtest_num]->nkps ; i++){
-     if(0.5 - fabs(dieharder_test[i]->ks_pvalue - 0.5) < smallest_p) {
-	   smallest_p = 0.5 - fabs(dieharder_test[i]->ks_pvalue - 0.5);
-	 }
-   }
-   switch(Xtrategy){
-     /*
-      * This just runs std_test a single time, period, for good or ill.
-      */
-     default:
-     case 0:
-       need_more_p = NO;
-       break;
-     /*
-      *             Resolve Ambiguity (RA) mode
-      *
-      * If any test has a p that is less than Xfail, we are done.
-      * If the entire test has pvalues that are bigger than Xweak,
-      * we are done (we really need this to happen e.g. 3x consecutively
-      * or exceed a much larger threshold, but that is more work to code
-      * and I want to be certain of the algorithm first).  If the test
-      * has accumulated Xoff psamples, we are done.
-      */
-     case 1:
-       if(smallest_p < Xfail) need_more_p = NO;
-       if(smallest_p >= Xweak) need_more_p = NO;
-       if(dieharder_test[0]->psamples >= Xoff) need_more_p = NO;
-       break;
-     /*
-      *             Test To Destruction (TTD) mode
-      *
-      * If any test has a p that is less than Xfail, we are done.
-      * If the test has accumulated Xoff psamples, we are done.
-      */
-     case 2:
-       if(smallest_p < Xfail) need_more_p = NO;
-       if(dieharder_test[0]->psamples >= Xoff) need_more_p = NO;
-       break;
-   }
+   need_more_p = more_psamples(dh_test_types[dtest_num],dieharder_test);
  }
 
  destroy_test(dh_test_types[dtest_num],dieharder_test);
@@ -12,6 +12,7 @@ void set_globals()
   * by a flag with the same first letter.  In order:
   */
  all = NO;              /* Default is to NOT do all the tests */
+ batch_path[0] = (char)0; /* No batch of files */
  binary = NO;           /* Do output a random stream in binary (with -o) */
  dtest_num = -1;        /* -1 means no test selected */
  dtest_name[0] = (char)0; /* empty test name is also default */
@@ -27,12 +28,16 @@ void set_globals()
  etalon_generator.params.is_etalon = 1; /*mark etalon random generator*/
  etalon_enabled = NO;   /* Etalon comparison is disabled by default*/
  etalon_xor = NO;       /* XOR with etalon is disabled */
+ fanout_flag = NO;      /* Tests run one after another on the stream */
  help_flag = NO;        /* No help requested */
  iterations = -1;	/* For timing loop, set iterations to be timed */
  list = NO;             /* List all generators */
  ntuple = 0;            /* n-tuple size for n-tuple tests (0 means all) */
  overlap = 1;           /* Default is to use overlapping samples in tests that support a choice */
+ plan_flag = NO;        /* Tests read a capture file front to back */
  psamples = 0;          /* This value precipitates use of test defaults */
+ pstream = 0;           /* Keep every pvalue, no streaming sketch */
+ pstream_spill[0] = (char)0; /* and no spill files */
  strategy = 0;          /* Means use seed (random or otherwise) from beginning of run */
  Seed = 0;              /* user selected seed.  != 0 surpresses reseeding per sample.*/
  tsamples = 0;          /* This value precipitates use of test defaults */
@@ -0,0 +1,198 @@
+/*
+ *========================================================================
+ * See copyright in copyright.h and the accompanying file COPYING
+ *========================================================================
+ */
+
+/*
+ *========================================================================
+ * A reference producer for shm_input_raw:  it creates a shared memory
+ * ring (see include/dieharder/shm_ring.h) and fills it from stdin, or
+ * with a built in xorshift generator for timing, e.g.
+ *
+ *   shm_producer /entropy < /dev/urandom &
+ *   dieharder -g shm_input_raw -f /entropy -a
+ *
+ * It is meant to be read, and copied into an entropy source's own code,
+ * as much as used:  the rands go straight into the mapped ring (fread()
+ * fills the pages the tests will read) and the only synchronization is
+ * the head/tail protocol in shm_ring.h.  When its input runs out it sets
+ * eof and waits for the reader to drain the ring; if the reader goes
+ * away it stops.  Either way it removes the ring and reports how often
+ * each side had to wait for the other.
+ *========================================================================
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <dieharder/shm_ring.h>
+
+/* Write at most this many words before letting the reader know */
+#define SHM_CHUNK 65536
+
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int sig)
+{
+
+ stop = 1;
+
+}
+
+static void usage()
+{
+
+ fprintf(stderr,"Usage: shm_producer [-w log2 words] [-n words] [-r seed] /name\n\
+  -w  the ring holds 2^w 32 bit words (default 20, i.e. 4 MB)\n\
+  -n  stop after this many words (default: at the end of the input)\n\
+  -r  generate xorshift rands from this seed instead of reading stdin\n");
+ exit(1);
+
+}
+
+/*
+ * Has the reader been and gone?  Until one attaches we wait for it.
+ */
+static int gone(int32_t pid)
+{
+
+ return pid != 0 && kill((pid_t) pid,0) != 0 && errno == ESRCH;
+
+}
+
+int main(int argc,char **argv)
+{
+
+ int c,fd,gen = 0;
+ unsigned int lgsize = 20,i;
+ unsigned long long nwords = 0,seed = 0,x;
+ uint64_t size,head,tail,n,room;
+ uint32_t seq,*word;
+ size_t bytes;
+ char *name;
+ shm_ring_t *r;
+
+ while((c = getopt(argc,argv,"w:n:r:")) != -1){
+   switch(c){
+     case 'w':
+       lgsize = strtoul(optarg,NULL,10);
+       break;
+     case 'n':
+       nwords = strtoull(optarg,NULL,10);
+       break;
+     case 'r':
+       gen = 1;
+       seed = strtoull(optarg,NULL,10);
+       break;
+     default:
+       usage();
+   }
+ }
+ if(optind != argc - 1 || lgsize < 4 || lgsize > 30) usage();
+ name = argv[optind];
+ size = (uint64_t)1 << lgsize;
+ bytes = SHM_RING_HEADER + size*sizeof(uint32_t);
+
+ fd = shm_open(name,O_RDWR | O_CREAT | O_EXCL,0600);
+ if(fd < 0){
+   fprintf(stderr,"shm_producer: cannot create %s: %s (if it is left over, remove /dev/shm%s)\n",
+           name,strerror(errno),name);
+   exit(1);
+ }
+ if(ftruncate(fd,(off_t) bytes) != 0){
+   fprintf(stderr,"shm_producer: cannot size %s: %s\n",name,strerror(errno));
+   shm_unlink(name);
+   exit(1);
+ }
+ r = (shm_ring_t *) mmap(NULL,bytes,PROT_READ | PROT_WRITE,MAP_SHARED,fd,0);
+ close(fd);
+ if((void *) r == MAP_FAILED){
+   fprintf(stderr,"shm_producer: cannot map %s: %s\n",name,strerror(errno));
+   shm_unlink(name);
+   exit(1);
+ }
+ word = (uint32_t *)((char *) r + SHM_RING_HEADER);
+
+ /* ftruncate() zeroed everything, so only these need setting */
+ r->size = size;
+ r->producer_pid = (int32_t) getpid();
+ __atomic_store_n(&r->magic,SHM_RING_MAGIC,__ATOMIC_RELEASE);
+
+ signal(SIGINT,on_signal);
+ signal(SIGTERM,on_signal);
+ signal(SIGPIPE,on_signal);
+
+ x = seed ? seed : 0x9e3779b97f4a7c15ULL;
+ head = 0;
+ while(!stop && (nwords == 0 || head < nwords)){
+
+   /*
+    * Wait for room, unless the reader has gone.
+    */
+   tail = __atomic_load_n(&r->tail,__ATOMIC_ACQUIRE);
+   if(head - tail == size){
+     r->producer_stalls++;
+     while(!stop){
+       seq = __atomic_load_n(&r->tail_seq,__ATOMIC_SEQ_CST);
+       __atomic_store_n(&r->producer_waiting,1,__ATOMIC_SEQ_CST);
+       tail = __atomic_load_n(&r->tail,__ATOMIC_SEQ_CST);
+       if(head - tail < size || gone(r->consumer_pid)) break;
+       shm_ring_wait(&r->tail_seq,seq);
+     }
+     __atomic_store_n(&r->producer_waiting,0,__ATOMIC_SEQ_CST);
+     if(head - tail == size) break;
+   }
+
+   /*
+    * Fill as much as we can in one go, without wrapping.
+    */
+   room = size - (head - tail);
+   n = size - (head & (size - 1));
+   if(n > room) n = room;
+   if(n > SHM_CHUNK) n = SHM_CHUNK;
+   if(nwords != 0 && n > nwords - head) n = nwords - head;
+   if(gen){
+     for(i=0;i<n;i++){
+       x ^= x << 13;
+       x ^= x >> 7;
+       x ^= x << 17;
+       word[(head + i) & (size - 1)] = (uint32_t)(x >> 32);
+     }
+   } else {
+     n = fread(&word[head & (size - 1)],sizeof(uint32_t),n,stdin);
+     if(n == 0) break;
+   }
+
+   __atomic_store_n(&r->head,head + n,__ATOMIC_SEQ_CST);
+   head += n;
+   if(__atomic_load_n(&r->consumer_waiting,__ATOMIC_SEQ_CST)) shm_ring_wake(&r->head_seq);
+
+ }
+
+ /*
+  * That's all.  Let the reader finish what is in the ring.
+  */
+ __atomic_store_n(&r->eof,1,__ATOMIC_SEQ_CST);
+ shm_ring_wake(&r->head_seq);
+ while(!stop && !gone(r->consumer_pid)){
+   seq = __atomic_load_n(&r->tail_seq,__ATOMIC_SEQ_CST);
+   __atomic_store_n(&r->producer_waiting,1,__ATOMIC_SEQ_CST);
+   if(__atomic_load_n(&r->tail,__ATOMIC_SEQ_CST) == head) break;
+   shm_ring_wait(&r->tail_seq,seq);
+ }
+
+ shm_unlink(name);
+ fprintf(stderr,"shm_producer: %llu rands written, %llu read.  The producer waited %llu times, the reader %llu times.\n",
+         (unsigned long long) head,(unsigned long long) __atomic_load_n(&r->tail,__ATOMIC_SEQ_CST),
+         (unsigned long long) r->producer_stalls,(unsigned long long) r->consumer_stalls);
+ munmap(r,bytes);
+ return 0;
+
+}
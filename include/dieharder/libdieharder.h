@@ -109,9 +109,25 @@ typedef struct read_buffer_params read_buffer_params_t;
  /* This new function takes two pointers two arrays of length n and m respectively
   * and returns ks_pvalue according to two-sample Kolmogorov - Smirnov test.
   */
- double two_sample_kstest(double *value, double *ref_value, int n, int m);
- double kstest(double *pvalue,int count);
- double kstest_kuiper(double *pvalue,int count);
+ double two_sample_kstest(double *value, double *ref_value, int n, int m, double *scratch);
+ double two_sample_kstest_sorted(const double *value, const double *ref_value, int m, int n, double *work);
+ double kstest(double *pvalue,int count,double *scratch);
+ double kstest_kuiper(double *pvalue,int count,double *scratch);
+ double kstest_sorted(double *pvalue,int count);
+ double kstest_kuiper_sorted(double *pvalue,int count);
+ void pvalue_merge(double *pvalue,unsigned int nsorted,unsigned int count,double *scratch);
+ double kstest_dmax_pvalue(int count,double dmax);
+ double kstest_kuiper_v_pvalue(int count,double v);
+ double ad_pvalue(int n,double a2);
+ double cvm_pvalue(int n,double w2);
+ void gof_sorted(double *pvalue,int count,double *gof);
+ pstream_t *pstream_alloc(unsigned int nbins,const char *spill);
+ void pstream_free(pstream_t *ps);
+ void pstream_clear(pstream_t *ps);
+ void pstream_add(pstream_t *ps,const double *p,unsigned int n);
+ int pstream_merge(pstream_t *ps,const pstream_t *from);
+ void pstream_bins(const pstream_t *ps,unsigned int nb,unsigned int *bin);
+ void pstream_gof(const pstream_t *ps,double *gof);
  double q_ks(double x);
  double q_ks_kuiper(double x,int count);
 
@@ -133,6 +149,30 @@ typedef struct read_buffer_params read_buffer_params_t;
  void get_ntuple_cyclic(unsigned int *input,unsigned int ilen,
     unsigned int *output,unsigned int jlen,unsigned int ntuple,unsigned int offset);
  unsigned int get_uint_rand(random_generator_t *generator);
+ void get_rand_uint_block(unsigned int *data,unsigned int n,random_generator_t *cur_rng);
+ void get_rand_bits_block(unsigned int *values,unsigned int n,unsigned int nbits,random_generator_t *cur_rng);
+ unsigned int get_rand_bounded(unsigned int range,random_generator_t *cur_rng);
+ void get_rand_bounded_block(unsigned int *out,unsigned int n,unsigned int range,random_generator_t *cur_rng);
+ void get_rand_uniform_block(double *x,unsigned int n,int pos,random_generator_t *cur_rng);
+ void rng_discard(gsl_rng *rng,unsigned long long n);
+ int file_input_raw_discard(void *vstate,unsigned long long n);
+ unsigned long long popcount_buf(const unsigned int *w,unsigned int n);
+ void popcount_blocks(const unsigned int *w,unsigned int n,unsigned int blen,unsigned int *counts);
+ void popcount_bytes(const unsigned char *bytes,unsigned char *counts,
+                     unsigned int n,const unsigned char *map);
+ void unpack_bits_u32(const unsigned int *w,unsigned int first,unsigned int k,
+                      unsigned int n,unsigned int *out);
+ void unpack_bits_u16(const unsigned int *w,unsigned int first,unsigned int k,
+                      unsigned int n,unsigned short *out);
+ void unpack_bits_overlap_u32(const unsigned int *w,unsigned int first,unsigned int k,
+                              unsigned int n,unsigned int *out);
+ void unpack_bits_overlap_u16(const unsigned int *w,unsigned int first,unsigned int k,
+                              unsigned int n,unsigned short *out);
+ void unpack_bits_lsb_u32(const unsigned int *w,unsigned int first,unsigned int k,
+                          unsigned int n,unsigned int *out);
+ void count_1s_letters(const unsigned char *bytes,unsigned char *letters,unsigned int n);
+ void count_1s_words(const unsigned char *letters,unsigned int stride,
+                     unsigned int n,unsigned short *words);
  void get_rand_bits(void *result,unsigned int rsize,unsigned int nbits, random_generator_t *cur_rng);
  void mybitadd(char *dst, int doffset, char *src, int soffset, int slen);
  void get_rand_pattern(void *result,unsigned int rsize,int *pattern, random_generator_t* cur_rng);
@@ -154,11 +194,13 @@ typedef struct read_buffer_params read_buffer_params_t;
   *========================================================================
   */
  unsigned int all;              /* Flag to do all tests on selected generator */
+ char batch_path[K];            /* Directory or list of capture files to test (-M) */
  unsigned int binary;           /* Flag to output rands in binary (with -o -f) */
  unsigned int bits;             /* bitstring size (in bits) */
  unsigned int diehard;          /* Diehard test number */
  unsigned int etalon_enabled;   /* flag is 1 if comparison with etalon generator is enabled*/
  unsigned int etalon_xor;       /* flag is 1 if xor with etalon is used*/
+ unsigned int fanout_flag;      /* Run the tests at once on one shared stream (-A) */
  /*
   * We will still need generator above, if only to select the XOR
   * generator.  I need to make its number something that will pretty much
@@ -188,7 +230,10 @@ typedef struct read_buffer_params read_buffer_params_t;
  char output_filename[K];       /*filename for generator output*/
  unsigned int output_format;    /* equals 0 (binary), 1 (unsigned int), 2 (decimal) output */
  unsigned int overlap;          /* 1 use overlapping samples, 0 don't (for tests with the option) */
+ unsigned int plan_flag;        /* Give each test its own range of a capture file (-b) */
  unsigned int psamples;         /* Number of test runs in final KS test */
+ unsigned int pstream;          /* log2 of the pvalue sketch bins, 0 keeps every pvalue */
+ char pstream_spill[K];         /* If set, streamed pvalues are also spilled to files named from it */
  unsigned int quiet;            /* quiet flag -- surpresses full output report */
  unsigned int rgb;              /* rgb test number */
  unsigned int sts;              /* sts test number */
@@ -292,6 +337,10 @@ typedef struct read_buffer_params read_buffer_params_t;
    int brindex;                       /* pointer to line containing LAST return */
    int iclear;                        /* pointer to region being backfilled */
    int bitindex;                      /* pointer to the last (most significant) returned bit */
+   unsigned long long bulk_acc;       /* Bits not yet returned by get_rand_uint_block() */
+   unsigned int bulk_nbits;           /* Number of them, right justified in bulk_acc */
+   unsigned int bit_buffer;           /* Bits not yet returned by get_rand_bits_uint() */
+   unsigned int bits_left;            /* Number of them, right justified in bit_buffer */
  };
 
  /*struct of complex generator*/
@@ -332,4 +381,81 @@ typedef struct {
   double c[RGB_MINIMUM_DISTANCE_MAXDIM];
 } dTuple;
 
+/*
+ * multihist_t is a histogram of small integers spread over several
+ * interleaved integer banks, see multihist.c.
+ */
+#define MULTIHIST_BANKS 4
+typedef struct {
+  unsigned int nbins;
+  unsigned int *bank;           /* MULTIHIST_BANKS banks of nbins counts */
+} multihist_t;
+
+multihist_t *multihist_alloc(unsigned int nbins);
+void multihist_free(multihist_t *h);
+void multihist_clear(multihist_t *h);
+void multihist_add_u32(multihist_t *h,const unsigned int *v,unsigned int n);
+void multihist_add_u16(multihist_t *h,const unsigned short *v,unsigned int n);
+void multihist_merge(multihist_t *h,unsigned int *counts);
+void multihist_drain_u32(multihist_t *h,const unsigned int *v,unsigned int n,unsigned int *counts);
+
+/*
+ * fanout_t hands one stream of rands to several consumers, each on its
+ * own thread, see fanout.c.
+ */
+typedef struct fanout fanout_t;
+fanout_t *fanout_alloc(gsl_rng *source,unsigned int nconsumers);
+gsl_rng *fanout_consumer(fanout_t *f,unsigned int i);
+int fanout_start(fanout_t *f);
+void fanout_done(fanout_t *f,unsigned int i);
+void fanout_free(fanout_t *f);
+
+/*
+ * Planning the use of capture files (-b, -M), see plan.c.
+ */
+unsigned long long test_words(Dtest *dtest,Test **test,random_generator_t *like,
+                              unsigned int npsamples);
+gsl_rng *file_range_alloc(const char *filename,unsigned long long start,
+                          unsigned long long len);
+double plan_ranges(unsigned int n,const unsigned long long *words,unsigned int *psamples,
+                   unsigned long long avail,unsigned long long *len);
+typedef struct file_map file_map_t;
+file_map_t *file_map_open(const char *filename);
+unsigned long long file_map_len(file_map_t *m);
+gsl_rng *file_map_rng(file_map_t *m,unsigned long long start,unsigned long long len);
+void file_map_close(file_map_t *m);
+unsigned int file_range_rewinds(gsl_rng *rng);
+void file_range_free(gsl_rng *rng);
+
+/*
+ * The shared memory ring input (shm_input_raw), see rng_shm_input_raw.c
+ * and shm_ring.h.  Like file_input* it is named by -f.
+ */
+gsl_rng *shm_input_alloc(const gsl_rng_type *T,char *name);
+int shm_input_stats(gsl_rng *rng,unsigned long long *nread,unsigned long long *cstalls,
+                    unsigned long long *pstalls);
+int rng_takes_filename(const gsl_rng_type *T);
+
+/*
+ * Running tests on the caller's own rands (embedding), see mem_input.c.
+ */
+typedef unsigned int (*mem_input_fill_t)(void *arg,unsigned int *block,unsigned int n);
+gsl_rng *mem_input_alloc(const unsigned int *words,unsigned long long n);
+gsl_rng *mem_input_fill_alloc(mem_input_fill_t fill,void *arg);
+unsigned int mem_input_overruns(gsl_rng *rng);
+unsigned int mem_input_read(gsl_rng *rng,unsigned int *data,unsigned int n);
+unsigned int run_test_on_rng(Dtest *dtest,Test **test,gsl_rng *rng);
+unsigned int run_test_on_buffer(Dtest *dtest,Test **test,const unsigned int *words,
+                                unsigned long long n);
+unsigned int run_test_on_fill(Dtest *dtest,Test **test,mem_input_fill_t fill,void *arg);
+
+/*
+ * LSD radix sorts, see radix_sort.c.
+ */
+void radix_sort_uint(unsigned int *a,unsigned int n,unsigned int *scratch);
+void radix_sort_double(double *a,unsigned int n,double *scratch);
+void radix_sort_double_index(double *a,unsigned int *index,unsigned int n,
+                             double *scratch,unsigned int *iscratch);
+void radix_sort_dtuple(dTuple *points,unsigned int n);
+
 gsl_rng *wrap_gsl_rng_alloc (input_params_t *params, unsigned int curr_gnum);
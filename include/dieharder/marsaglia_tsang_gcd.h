@@ -33,6 +33,9 @@ static Dtest marsaglia_tsang_gcd_dtest __attribute__((unused)) = {
 # on both of these binned distributions yield two p-values per test,\n\
 # and 100 (default) p-values of each are accumulated and subjected to\n\
 # final KS tests and displayed in a histogram.\n\
+#\n\
+# -n 64 makes u and v 64 bit uints (two successive rands each) and uses\n\
+# a separate simulated k table for them (mean k is about 38).\n\
 #==================================================================\n",
   100,
   10000000,
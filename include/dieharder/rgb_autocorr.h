@@ -0,0 +1,44 @@
+/*
+ * rgb_autocorr test header.
+ */
+
+/*
+ * function prototype
+ */
+int rgb_autocorr(Test **test,int irun, random_generator_t *cur_rng);
+
+static Dtest rgb_autocorr_dtest __attribute__((unused)) = {
+  "RGB Autocorrelation Test",
+  "rgb_autocorr",
+  "\
+#==================================================================\n\
+#                  RGB Autocorrelation Test\n\
+# This test looks for lagged correlations the way rgb_lagged_sums\n\
+# does, but for all lags at once.  A single sequence of tsamples\n\
+# uniform deviates u_i is drawn and its autocorrelation\n\
+#\n\
+#   r_k = sum_i (u_i - 1/2)(u_{i+k} - 1/2)\n\
+#\n\
+# is computed for every lag k = 1..ntuple with one zero-padded real\n\
+# FFT, so testing thousands of lags costs about as much as testing\n\
+# one.  For an iid stream r_k has mean 0 and variance (tsamples-k)/144\n\
+# and distinct lags are uncorrelated, so z_k = 12 r_k/sqrt(tsamples-k)\n\
+# is (very nearly) a standard normal.\n\
+#\n\
+# Two p-values are returned per run.  The first is the chisq of\n\
+# sum z_k^2 over all ntuple lags (ntuple degrees of freedom), which\n\
+# picks up weak correlation spread over many lags.  The second is\n\
+# for the single most extreme lag, corrected for the number of lags\n\
+# looked at, which picks up a strong correlation at one lag.  The\n\
+# p-value for each individual lag is printed in verbose mode\n\
+# (D_RGB_AUTOCORR).\n\
+#\n\
+# ntuple defaults to 1024 lags and is limited to tsamples/2.\n\
+#==================================================================\n",
+  100,
+  1000000,
+  2,
+  rgb_autocorr,
+  0
+};
+
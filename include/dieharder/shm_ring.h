@@ -0,0 +1,90 @@
+/*
+ * See copyright in copyright.h and the accompanying file COPYING
+ */
+
+/*
+ *========================================================================
+ * The POSIX shared memory ring that shm_input_raw reads (see
+ * libdieharder/rng_shm_input_raw.c), shared with whatever produces the
+ * rands (e.g. dieharder/shm_producer.c).  The shared memory object
+ * (shm_open() name, e.g. /entropy) is SHM_RING_HEADER bytes of
+ * shm_ring_t followed by size 32 bit words, size a power of 2.
+ *
+ * head counts the words ever written and tail the words ever read;
+ * neither ever goes down.  Words tail..head-1 are waiting to be read,
+ * word i being ring[i & (size-1)].  The producer only writes head and
+ * the consumer only writes tail, each with release ordering after the
+ * words it covers, so there are no locks.  A side that finds the ring
+ * empty (consumer) or full (producer) counts a stall, raises its
+ * waiting flag, looks again, and sleeps on the other side's sequence
+ * number (a futex on Linux, short naps elsewhere); a side that moves
+ * its index bumps its sequence number and wakes the other if its flag
+ * is up.  The stall counts are the backpressure accounting:  consumer
+ * stalls mean the tests were waiting for rands.
+ *
+ * One producer and one consumer.  Each puts its pid in the header, so
+ * the other can tell if it has gone away.  The producer sets magic last
+ * of all, and eof once it has written its last word.
+ *========================================================================
+ */
+
+#include <stdint.h>
+#include <time.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+#define SHM_RING_MAGIC 0x44485231u     /* "DHR1" */
+#define SHM_RING_HEADER 4096
+
+typedef struct {
+  /* Set up by the producer */
+  uint32_t magic;
+  uint32_t eof;                 /* No more words will be written */
+  uint64_t size;                /* Words in the ring, a power of 2 */
+  int32_t producer_pid;
+  int32_t consumer_pid;         /* 0 until a consumer attaches */
+  char pad0[40];
+  /* Written by the producer */
+  uint64_t head;
+  uint32_t head_seq;
+  uint32_t producer_waiting;
+  uint64_t producer_stalls;     /* Times the ring was full */
+  char pad1[40];
+  /* Written by the consumer */
+  uint64_t tail;
+  uint32_t tail_seq;
+  uint32_t consumer_waiting;
+  uint64_t consumer_stalls;     /* Times the ring was empty */
+  char pad2[40];
+} shm_ring_t;
+
+/*
+ * Sleep until *seq isn't seen any more, or for a little while.
+ */
+static inline void shm_ring_wait(uint32_t *seq,uint32_t seen)
+{
+
+#ifdef __linux__
+ struct timespec ts = {0,100000000};
+ syscall(SYS_futex,seq,FUTEX_WAIT,seen,&ts,NULL,0);
+#else
+ struct timespec ts = {0,100000};
+ if(__atomic_load_n(seq,__ATOMIC_ACQUIRE) == seen) nanosleep(&ts,NULL);
+#endif
+
+}
+
+/*
+ * Bump *seq and wake whoever sleeps on it.
+ */
+static inline void shm_ring_wake(uint32_t *seq)
+{
+
+ __atomic_add_fetch(seq,1,__ATOMIC_SEQ_CST);
+#ifdef __linux__
+ syscall(SYS_futex,seq,FUTEX_WAKE,1,NULL,NULL,0);
+#endif
+
+}
@@ -12,6 +12,36 @@
  * can be passed to e.g report() or table() and they'll know exactly
  * what to do with it.
  */
+/*
+ * The goodness of fit statistics std_test() computes for every test's
+ * pvalues (see gof.c).  ks_pvalue is one of them, chosen by ks_test,
+ * unless the two sample (etalon) test is in use.
+ */
+enum {
+  GOF_KS,
+  GOF_KUIPER,
+  GOF_AD,
+  GOF_CVM,
+  GOF_N
+};
+
+/*
+ * In streaming mode (-j) a test's pvalues are kept only as a histogram
+ * of nbins equal bins on [0,1), which is what the final statistics are
+ * computed from (see pstream.c).  The test itself fills PSTREAM_CHUNK
+ * pvalues at a time.
+ */
+#define PSTREAM_CHUNK 4096
+typedef struct {
+  unsigned int nbins;   /* Number of bins on [0,1) */
+  unsigned int *count;  /* count[k] = number of pvalues in bin k */
+  unsigned int n;       /* Total number of pvalues */
+  int spill_fd;         /* Exact pvalues are also written here (-1 if not) */
+  double *spill;        /* ...through this mapping of it */
+  size_t spill_n;       /* Number of pvalues written */
+  size_t spill_cap;     /* Number of pvalues mapped */
+} pstream_t;
+
 typedef struct {
   unsigned int nkps;           /* Number of test statistics created per run */
   unsigned int tsamples;       /* Number of samples per test (if applicable) */
@@ -24,6 +54,15 @@ typedef struct {
   double y;            /* Extra variable passed on command line */
   double z;            /* Extra variable passed on command line */
   double *st_values;   /* Vector of length psamples to hold underlying statistics values*/
+  unsigned int nsorted; /* pvalues[0..nsorted) are known to be in order */
+  double *st_sorted;   /* st_values in order, for the two sample KS test */
+  unsigned int st_nsorted; /* st_values[0..st_nsorted) are in st_sorted */
+  double *ks_work;     /* Workspace for the two sample KS test */
+  double gof_pvalues[GOF_N]; /* KS, Kuiper, Anderson-Darling, Cramer-von Mises */
+  pstream_t *ps;       /* Sketch of the pvalues in streaming mode, else NULL */
+  unsigned int ntuple_cl; /* ntuple asked for (-n or an -a loop) at creation */
+  random_generator_t *rng; /* Generator to test, NULL for the global generator */
+  unsigned long long words; /* Rands one psample uses, once counted (see plan.c) */
 } Test;
 
 
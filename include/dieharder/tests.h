@@ -6,6 +6,7 @@
  *========================================================================
  */
 #include <dieharder/rgb_timing.h>
+#include <dieharder/rgb_autocorr.h>
 #include <dieharder/rgb_persist.h>
 #include <dieharder/rgb_bitdist.h>
 #include <dieharder/rgb_kstest_test.h>
@@ -86,6 +87,7 @@
    DAB_FILLTREE,
    DAB_FILLTREE2,
    DAB_MONOBIT2,
+   RGB_AUTOCORR,
    N_RGB_TESTS
  } Rgb_Tests;
 
@@ -61,5 +61,6 @@
    D_ADD_MY_TYPES,
    D_STD_TEST,
    D_RNGS,
+   D_RGB_AUTOCORR,
    N_DEBUG
  } Debug;
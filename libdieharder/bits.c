@@ -402,65 +402,19 @@ void fill_uint_buffer(unsigned int *data,unsigned int buflength, random_generato
   * fewer than 32 bits, making this a bit of a pain in the ass.
   * We need buffers like this for several tests, though, so it
   * is worth it to create a routine to do this once and for all.
+  *
+  * It used to make each uint out of two rands, the first shifted
+  * left by 32 - rmax_bits and the bottom bits of the second, which
+  * took two calls per uint (even for a 32 bit generator) and threw
+  * most of the second one away.  get_rand_uint_block() packs every
+  * rmax_bits-wide rand in back to back instead, so every bit the
+  * generator makes gets tested and there are 32/rmax_bits calls per
+  * uint.
   */
-
- unsigned int bufbits,bdelta;
- unsigned int i,tmp1,tmp2,mask;
-
- /*
-  * Number of bits we must generate.
-  */
- bufbits = buflength*sizeof(unsigned int)*CHAR_BIT;
- bdelta = sizeof(unsigned int)*CHAR_BIT - cur_rng->rmax_bits;
- mask = 0;
- for(i=0;i<bdelta;i++) {
-  mask = mask<<1;
-  mask++;
- }
  if(verbose == D_BITS || verbose == D_ALL){
-   printf("rmax_bits = %d  bdelta = %d\n",cur_rng->rmax_bits,bdelta);
- }
-
- for(i=0;i<buflength;i++){
-
-   /* put rmax_bits into tmp1 */
-   tmp1 = gsl_rng_get(cur_rng->rng);
-   /* Cruft
-   printf("tmp1 = %10u = ",tmp1);
-   dumpbits(&tmp1,32);
-   */
-
-   /* Shift it over to the left */
-   tmp1 = tmp1 << bdelta;
-   /*
-   printf("tmp1 = %10u = ",tmp1);
-   dumpbits(&tmp1,32);
-   */
-
-   /* put rmax_bits into tmp2 */
-   tmp2 = gsl_rng_get(cur_rng->rng);
-   /*
-   printf("tmp2 = %10u = ",tmp2);
-   printf("mask = %10u = ",mask);
-   dumpbits(&mask,32);
-   */
-
-   /* mask the second rand */
-   tmp2 = tmp2&mask;
-   /*
-   printf("tmp2 = %10u = ",tmp2);
-   dumpbits(&tmp2,32);
-   */
-
-   /* Fill in the rest of the uint */
-   tmp1 = tmp1 + tmp2;
-   /* Cruft
-   printf("tmp1 = %10u = ",tmp1);
-   dumpbits(&tmp1,32);
-   */
-
-   data[i] = tmp1;
+   printf("rmax_bits = %d\n",cur_rng->rmax_bits);
  }
+ get_rand_uint_block(data,buflength,cur_rng);
 
 }
 
@@ -902,16 +856,19 @@ void get_ntuple_cyclic(unsigned int *input,unsigned int ilen,
 unsigned int get_uint_rand(random_generator_t *cur_rng)
 {
 
- static unsigned int bl,bu,tmp;
+ /*
+  * Everything that has to last from call to call is in the read
+  * buffer, so several threads can each read their own generator (see
+  * fanout.c).
+  */
+ unsigned int bl,tmp;
+ const unsigned int bu = sizeof(unsigned int)*CHAR_BIT;   /* e.g. 32 */
  read_buffer_params_t *rb = &cur_rng->read_buffer;
 
  /*
-  * First call -- initialize/fill bits_rand from current rng.  bl and bu
-  * should be static so they are preserved for later calls.
+  * First call -- initialize/fill bits_rand from current rng.
   */
  if(rb->bleft == -1){
-   /* e.g. 32 */
-   bu = sizeof(unsigned int)*CHAR_BIT;
    /* e.g. 32 - 31 = 1 for a generator that returns 31 bits */
    bl = bu - cur_rng->rmax_bits;
    /* For the first call, we start with bits_rand[1] all or partially filled */
@@ -1011,6 +968,189 @@ unsigned int get_uint_rand(random_generator_t *cur_rng)
 
 }
 
+/*
+ * get_rand_uint_block() fills data[] with the next n 32-bit uints from
+ * the stream.  This is what the tests that chew through millions of
+ * words should use instead of calling get_rand_bits_uint(32,...) or
+ * gsl_rng_get() once per word:  the loop is tight, there is no per-word
+ * bookkeeping, and the caller gets a whole block it can run a batched
+ * kernel over.
+ *
+ * For a full 32 bit generator the block is exactly the sequence of
+ * gsl_rng_get() returns, so a test that switches over sees the same
+ * numbers it always did.  For generators with rmax_bits < 32 the
+ * rmax_bits-wide returns are packed back to back, most significant bit
+ * first (the same order get_rand_bits_uint() delivers them) and no
+ * bits are dropped.  Leftover bits are kept with the generator in
+ * read_buffer and carried into the next call.
+ */
+void get_rand_uint_block(unsigned int *data,unsigned int n,random_generator_t *cur_rng)
+{
+
+ unsigned int i;
+ unsigned int rmax_bits = cur_rng->rmax_bits;
+ unsigned long long acc;
+ unsigned int nbits;
+ read_buffer_params_t *rb = &cur_rng->read_buffer;
+
+ if(rmax_bits == 32 && rb->bulk_nbits == 0){
+   /* Rands already in memory (mem_input.c) are just copied */
+   if(mem_input_read(cur_rng->rng,data,n) == n) return;
+   for(i=0;i<n;i++){
+     data[i] = gsl_rng_get(cur_rng->rng);
+   }
+   return;
+ }
+
+ acc = rb->bulk_acc;
+ nbits = rb->bulk_nbits;
+ for(i=0;i<n;i++){
+   while(nbits < 32){
+     acc = (acc << rmax_bits) | (gsl_rng_get(cur_rng->rng) & cur_rng->rmax_mask);
+     nbits += rmax_bits;
+   }
+   nbits -= 32;
+   data[i] = (unsigned int)(acc >> nbits);
+   acc &= (1ull << nbits) - 1;
+ }
+ rb->bulk_acc = acc;
+ rb->bulk_nbits = nbits;
+
+}
+
+/*
+ * get_rand_bounded() returns a uniformly distributed integer in
+ * [0,range), range > 0, the way gsl_rng_uniform_int() would but without
+ * its division (and indirect call) per draw.  This is Lemire's
+ * multiply-shift method:  for a 32 bit uniform x the high word of
+ * x*range is floor(x*range/2^32), which is in [0,range) and very nearly
+ * uniform.  It is made exactly uniform by rejecting the (2^32 mod
+ * range) values of x for which the low word of x*range is below
+ * 2^32 mod range, and as that can only happen when the low word is
+ * below range, the division that computes 2^32 mod range is almost
+ * never done.
+ *
+ * The x's are whole uints from get_rand_uint_block(), so any
+ * rmax_bits will do.
+ */
+unsigned int get_rand_bounded(unsigned int range,random_generator_t *cur_rng)
+{
+
+ unsigned int x,l,t;
+ unsigned long long m;
+
+ get_rand_uint_block(&x,1,cur_rng);
+ m = (unsigned long long) x*range;
+ l = (unsigned int) m;
+ if(l < range){
+   t = (0u - range) % range;
+   while(l < t){
+     get_rand_uint_block(&x,1,cur_rng);
+     m = (unsigned long long) x*range;
+     l = (unsigned int) m;
+   }
+ }
+ return (unsigned int)(m >> 32);
+
+}
+
+/*
+ * get_rand_bounded_block() fills out[] with n draws of
+ * get_rand_bounded(range,cur_rng), exactly as n calls would make them.
+ * The threshold is computed once, and the words are fetched a block at
+ * a time -- only as many as are still needed, so a rejection costs one
+ * more word later and nothing is fetched that isn't used.  The inner
+ * loop is a multiply and a compare.
+ */
+#define BOUNDED_CHUNK 1024
+void get_rand_bounded_block(unsigned int *out,unsigned int n,unsigned int range,random_generator_t *cur_rng)
+{
+
+ unsigned int i,j,m;
+ unsigned int w[BOUNDED_CHUNK];
+ unsigned int t = (0u - range) % range;
+ unsigned long long p;
+
+ i = 0;
+ while(i < n){
+   m = n - i;
+   if(m > BOUNDED_CHUNK) m = BOUNDED_CHUNK;
+   get_rand_uint_block(w,m,cur_rng);
+   for(j=0;j<m;j++){
+     p = (unsigned long long) w[j]*range;
+     if((unsigned int) p >= t) out[i++] = (unsigned int)(p >> 32);
+   }
+ }
+
+}
+
+/*
+ * get_rand_uniform_block() fills x[] with the next n uniform deviates
+ * for the tests that want doubles.  Calling gsl_rng_uniform() once per
+ * value costs an indirect call and a division per double, and the
+ * loop around it can't vectorize.  Here we pull the raw rands a chunk
+ * at a time and convert the whole chunk in one tight loop, exactly as
+ * GSL's integer generators define their doubles:
+ *
+ *   x = (rand - rmin)/(rmax - rmin + 1)      in [0,1)
+ *
+ * (for a full 32 bit generator, rand/2^32).  With pos != 0 we get
+ * (0,1) instead, by drawing a replacement for each zero the way
+ * gsl_rng_uniform_pos() does.  Note that this deliberately works from
+ * the integer stream, so generators whose own get_double() divides by
+ * something else (UINT_MAX, say) or returns more than 32 bits get
+ * their ints tested here, like everywhere else.
+ */
+#define UNIFORM_CHUNK 1024
+void get_rand_uniform_block(double *x,unsigned int n,int pos,random_generator_t *cur_rng)
+{
+
+ unsigned int i,j,m;
+ unsigned int w[UNIFORM_CHUNK];
+ unsigned long int rmin = gsl_rng_min(cur_rng->rng);
+ double range = (double) (gsl_rng_max(cur_rng->rng) - rmin) + 1.0;
+ double scale = 1.0/range;
+ int e,pow2 = (frexp(range,&e) == 0.5);
+
+ for(i=0;i<n;i+=m){
+   m = n - i;
+   if(m > UNIFORM_CHUNK) m = UNIFORM_CHUNK;
+   for(j=0;j<m;j++){
+     w[j] = gsl_rng_get(cur_rng->rng) - rmin;
+   }
+   if(pos){
+     /*
+      * Zeros are rare (one in 2^32), so just patch them up in place
+      * before converting.  The order of the stream is the same as
+      * gsl_rng_uniform_pos() would have consumed it.
+      */
+     for(j=0;j<m;){
+       if(w[j] == 0){
+         memmove(&w[j],&w[j+1],(m-j-1)*sizeof(unsigned int));
+         w[m-1] = gsl_rng_get(cur_rng->rng) - rmin;
+       } else {
+         j++;
+       }
+     }
+   }
+   /*
+    * Multiplying by 1/range gives bit-identical results (and is a lot
+    * cheaper) when range is a power of two, as it is for any full 32 bit
+    * generator.  Otherwise divide, as GSL does.
+    */
+   if(pow2){
+     for(j=0;j<m;j++){
+       x[i+j] = (double) w[j]*scale;
+     }
+   } else {
+     for(j=0;j<m;j++){
+       x[i+j] = (double) w[j]/range;
+     }
+   }
+ }
+
+}
+
 /*
  * With get_uint(rand() in hand, we can FINALLY create a routine that
  * can give us neither more nor less than the "next N bits" from the
@@ -1183,6 +1323,106 @@ void get_rand_bits(void *result,unsigned int rsize,unsigned int nbits,random_gen
 
 }
 
+/*
+ * get_rand_bits_block() fills values[] with the next n nbits-wide
+ * returns of get_rand_bits(&values[i],sizeof(unsigned int),nbits,cur_rng),
+ * exactly as n calls would have made them and leaving read_buffer as
+ * they would have left it, for nbits <= 32.
+ *
+ * get_rand_bits() reads its circular buffer backwards, so the stream
+ * it delivers is the words from get_uint_rand() in order, each read
+ * from its least significant bit up, and it keeps the buffer topped up
+ * so that it always holds the BRBUF (or BRBUF-1, on a word boundary)
+ * words starting with the one the next bit comes from.  Here we copy
+ * those words out in stream order, fetch however many more the n calls
+ * would have fetched, unpack all the values at once (see unpack_bits.c)
+ * and put the last BRBUF words back where get_rand_bits() would have
+ * put them.
+ */
+#define RAND_BITS_BLOCK_WORDS 64
+void get_rand_bits_block(unsigned int *values,unsigned int n,unsigned int nbits,random_generator_t *cur_rng)
+{
+
+ int i;
+ unsigned int c,m,nvalid,nwords,first,end,slot0,p;
+ unsigned int words[BRBUF + RAND_BITS_BLOCK_WORDS + 2];
+ read_buffer_params_t *rb = &cur_rng->read_buffer;
+
+ if(n == 0) return;
+ if(nbits == 0 || nbits > sizeof(unsigned int)*CHAR_BIT){
+   for(m=0;m<n;m++){
+     get_rand_bits(&values[m],sizeof(unsigned int),nbits,cur_rng);
+   }
+   return;
+ }
+
+ if(rb->brindex == -1){
+   /*
+    * First call, fill the buffer BACKWARDS just as get_rand_bits() does.
+    */
+   for(i=BRBUF-1;i>=0;i--) {
+     rb->bits_randbuf[i] = get_uint_rand(cur_rng);
+   }
+   rb->brindex = BRBUF;
+   rb->iclear = rb->brindex-1;
+   rb->bitindex = 0;
+ }
+
+ while(n > 0){
+   c = n;
+   if(c > RAND_BITS_BLOCK_WORDS*32/nbits) c = RAND_BITS_BLOCK_WORDS*32/nbits;
+
+   /*
+    * slot0 is the buffer line holding the next bit, first its position
+    * counting up from the least significant bit, nvalid the number of
+    * unread lines.
+    */
+   if(rb->brindex == BRBUF){
+     slot0 = BRBUF - 1;
+     first = 0;
+     nvalid = BRBUF;
+   } else if(rb->bitindex != 0){
+     slot0 = rb->brindex;
+     first = 32 - rb->bitindex;
+     nvalid = BRBUF;
+   } else {
+     slot0 = (rb->brindex + BRBUF - 1)%BRBUF;
+     first = 0;
+     nvalid = BRBUF - 1;
+   }
+   for(m=0;m<nvalid;m++){
+     words[m] = rb->bits_randbuf[(slot0 + BRBUF - m)%BRBUF];
+   }
+
+   /*
+    * After reading through bit end the buffer runs BRBUF-1 lines past
+    * the line that bit is in.
+    */
+   end = first + c*nbits;
+   nwords = BRBUF - 1 + (end + 31)/32;
+   for(m=nvalid;m<nwords;m++){
+     words[m] = get_uint_rand(cur_rng);
+   }
+   unpack_bits_lsb_u32(words,first,nbits,c,values);
+   MYDEBUG(D_BITS) {
+     printf("get_rand_bits_block: %u values of %u bits from %u words\n",c,nbits,nwords);
+   }
+
+   for(m=nwords-BRBUF;m<nwords;m++){
+     rb->bits_randbuf[(slot0 + BRBUF - m%BRBUF)%BRBUF] = words[m];
+   }
+   p = (rb->brindex*32 + rb->bitindex)%(32*BRBUF);
+   p = (p + 32*BRBUF - (c*nbits)%(32*BRBUF))%(32*BRBUF);
+   rb->brindex = p/32;
+   rb->bitindex = p%32;
+   rb->iclear = rb->brindex;
+
+   values += c;
+   n -= c;
+ }
+
+}
+
 /*
  * OK, I CLEARLY need this.  What it will do is take a source and
  * destination address and BIT level offsets therein and copy
@@ -1427,5 +1667,9 @@ void reset_bit_buffers(read_buffer_params_t *rb)
   rb->brindex = -1;
   rb->iclear = -1;
   rb->bitindex = -1;
+  rb->bulk_acc = 0;
+  rb->bulk_nbits = 0;
+  rb->bit_buffer = 0;
+  rb->bits_left = 0;
 
 }
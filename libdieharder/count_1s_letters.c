@@ -0,0 +1,77 @@
+/*
+ * See copyright in copyright.h and the accompanying file COPYING
+ */
+
+/*
+ *========================================================================
+ * Kernels shared by diehard_count_1s_stream and diehard_count_1s_byte.
+ *
+ * Both tests turn bytes into "letters" 0-4 according to the number of
+ * 1 bits in the byte (0,1,2 -> 0, 3 -> 1, 4 -> 2, 5 -> 3, 6,7,8 -> 4,
+ * which is exactly what their b5s/b5b tables encode) and then build
+ * five letter base 5 words out of successive letters.  Doing that one
+ * byte at a time through a table and LSHIFT5() is a long chain of
+ * dependent operations per byte.  Here it is split into two passes over
+ * whole blocks:
+ *
+ *   count_1s_letters() classifies a block of bytes.  This is just
+ *   popcount_bytes() with the popcount (0-8) mapped to its letter,
+ *   which the SIMD paths there do with one more byte shuffle.
+ *
+ *   count_1s_words() forms the base 5 words with multiply-adds over the
+ *   letter block, in a plain loop the compiler can vectorize.
+ *
+ * The caller then just counts the words (in a multihist).  All of the
+ * run time CPU dispatch is in popcount.c.
+ *========================================================================
+ */
+
+#include <dieharder/libdieharder.h>
+
+/*
+ * The letter for each number of 1's in a byte (the b5s[] map, folded).
+ */
+static const unsigned char ones_letter[9] = {
+ 0, 0, 0, 1, 2, 3, 4, 4, 4};
+
+/*
+ * letters[i] = letter for bytes[i], i = 0..n-1.
+ */
+void count_1s_letters(const unsigned char *bytes,unsigned char *letters,unsigned int n)
+{
+
+ popcount_bytes(bytes,letters,n,ones_letter);
+
+}
+
+/*
+ * words[t] = the base 5 number spelled by letters[t*stride] ...
+ * letters[t*stride+4], most significant letter first (what five
+ * LSHIFT5()'s in a row produce), t = 0..n-1.  stride 1 gives the
+ * overlapping words of a letter stream, stride 5 non-overlapping ones.
+ * letters[] must hold (n-1)*stride + 5 entries.
+ */
+void count_1s_words(const unsigned char *letters,unsigned int stride,
+                    unsigned int n,unsigned short *words)
+{
+
+ unsigned int t;
+ const unsigned char *l;
+
+ /*
+  * The stride 1 loop is kept separate and free of the stride multiply
+  * so the compiler can vectorize it.
+  */
+ if(stride == 1){
+   for(t=0;t<n;t++){
+     words[t] = letters[t]*625 + letters[t+1]*125 + letters[t+2]*25 +
+                letters[t+3]*5 + letters[t+4];
+   }
+   return;
+ }
+ for(t=0;t<n;t++){
+   l = &letters[t*stride];
+   words[t] = l[0]*625 + l[1]*125 + l[2]*25 + l[3]*5 + l[4];
+ }
+
+}
@@ -30,13 +30,20 @@
 #define SAMP_TOTAL (3*SAMP_PER_WORD)
 #define TABLE_SIZE (256 * SAMP_TOTAL)
 
+/* Number of samples whose table indices are batched per histogram call */
+#define SAMP_BLOCK 1024
+
 int dab_bytedistrib(Test **test,int irun, random_generator_t *cur_rng) {
  Vtest vtest;
- unsigned int t,i,j;
+ unsigned int t,i,j,nidx;
  unsigned int counts[TABLE_SIZE];
+ unsigned int *idx;
+ multihist_t *hist;
 
- /* Zero the counters */
- memset(counts, 0, sizeof(unsigned int) * TABLE_SIZE);
+ /* The counters, and a block's worth of table indices to feed them */
+ hist = multihist_alloc(TABLE_SIZE);
+ idx = (unsigned int *) malloc(sizeof(unsigned int) * SAMP_TOTAL * SAMP_BLOCK);
+ nidx = 0;
 
  test[0]->ntuple = 0;  // Not used currently
 
@@ -66,14 +73,22 @@ int dab_bytedistrib(Test **test,int irun, random_generator_t *cur_rng) {
        currentShift += shiftAmount;
 
        /*
-        * Increment the appropriate count, faking a 3d array using a 1d array.
+        * Queue the appropriate count, faking a 3d array using a 1d array.
         * This should probably be changed, so that v is the final index and
         * not j, for clarity.
         */
-       counts[v * SAMP_TOTAL + i * SAMP_PER_WORD + j]++;
+       idx[nidx++] = v * SAMP_TOTAL + i * SAMP_PER_WORD + j;
      }
    }
+   if (nidx == SAMP_TOTAL * SAMP_BLOCK) {
+     multihist_add_u32(hist, idx, nidx);
+     nidx = 0;
+   }
  }
+ multihist_add_u32(hist, idx, nidx);
+ multihist_merge(hist, counts);
+ multihist_free(hist);
+ free(idx);
 
  Vtest_create(&vtest, TABLE_SIZE);
  vtest.ndof = 255 * SAMP_TOTAL;
@@ -43,6 +43,33 @@ void iDCT2(const double input[], double output[], size_t len);
 void fDCT2_fft(const unsigned int input[], double output[], size_t len);
 double evalMostExtreme(double *pvalue, unsigned int num);
 
+/*
+ * A planned DCT-II.  Everything that depends only on len (twiddles,
+ * bit reversal table, FFT workspace) is computed once in
+ * dct2_plan_alloc() and reused for every vector transformed, so
+ * dct2_batch() never touches malloc.  See dct2_batch() for the method.
+ */
+typedef struct {
+  unsigned int len;      /* N, the DCT length (a power of 2, >= 8) */
+  unsigned int half;     /* M = N/2, the complex FFT length */
+  unsigned int *bitrev;  /* M entry bit reversal permutation */
+  double *fft_tw;        /* M/2 complex twiddles exp(-2 pi i j/M) */
+  double *post_tw;       /* M complex twiddles exp(-2 pi i k/N) */
+  double *dct_tw;        /* N complex twiddles exp(-i pi k/(2N)) */
+  double *work;          /* M complex FFT workspace */
+} dct2_plan;
+
+dct2_plan *dct2_plan_alloc(unsigned int len);
+void dct2_plan_free(dct2_plan *plan);
+void dct2_batch(dct2_plan *plan, const unsigned int input[], double output[], unsigned int nvec);
+
+/*
+ * Number of rng words we try to pull and transform per dct2_batch()
+ * call.  Big enough to amortize the call, small enough that the input
+ * and output blocks stay in cache.
+ */
+#define DCT_BATCH_WORDS 16384
+
 /*
  * Discrete Cosine Transform (frequency or energy compaction) test.
  * So, it is easy to say that we want to do a DCT of the data as a test. But,
@@ -82,7 +109,7 @@ int dab_dct(Test **test,int irun, random_generator_t *cur_rng)
  unsigned int *input;
  double *pvalues = NULL;
  unsigned int i, j;
- unsigned int len = (ntuple == 0) ? 256 : ntuple;
+ unsigned int len = (test[0]->ntuple_cl == 0) ? 256 : test[0]->ntuple_cl;
  int rotAmount = 0;
  unsigned int v = 1<<(cur_rng->rmax_bits-1);
  double mean = (double) len * (v - 0.5);
@@ -104,12 +131,28 @@ int dab_dct(Test **test,int irun, random_generator_t *cur_rng)
  Xtest ptest;
  double sd = sqrt((1.0/6.0) * len) * v;
 
- dct = (double *) malloc(sizeof(double) * len);
- input = (unsigned int *) malloc(sizeof(unsigned int) * len);
+ /*
+  * The plan holds the FFT workspace, so each call builds its own and
+  * the test can run on several threads at once.  That is O(len) work,
+  * next to O(tsamples*len*log(len)) for the transforms.  len <= 4
+  * (or a len that isn't a power of 2, for which there is no plan) is
+  * handled by the direct fDCT2().
+  */
+ dct2_plan *plan = NULL;
+ unsigned int nbatch, b, k;
+
+ if (len > 4) plan = dct2_plan_alloc(len);
+ nbatch = DCT_BATCH_WORDS / len;
+ if (nbatch < 1) nbatch = 1;
+ if (nbatch > test[0]->tsamples) nbatch = test[0]->tsamples;
+
+ dct = (double *) malloc(sizeof(double) * len * nbatch);
+ input = (unsigned int *) malloc(sizeof(unsigned int) * len * nbatch);
  positionCounts = (double *) malloc(sizeof(double) * len);
 
+ /* The second half is kstest()'s sort scratch. */
  if (useFallbackMethod) {
-   pvalues = (double *) malloc(sizeof(double) * len * test[0]->tsamples);
+   pvalues = (double *) malloc(sizeof(double) * 2 * len * test[0]->tsamples);
  }
 
  /* Zero out the counts initially. */
@@ -123,48 +166,63 @@ int dab_dct(Test **test,int irun, random_generator_t *cur_rng)
 
  /* Main loop runs tsamples times. During each iteration, a vector
   * of length ntuple will be read from the generator, so a total of
-  * (tsamples * ntuple) words will be read from the RNG.
+  * (tsamples * ntuple) words will be read from the RNG.  We read and
+  * transform nbatch vectors at a time.
   */
- for (j=0; j<test[0]->tsamples; j++) {
-   unsigned int pos = 0;
-   double max = 0;
-
-   /* Change the rotation amount after each quarter of the samples
-    * have been used.
-    */
-   if (j != 0 && (j % (test[0]->tsamples / 4) == 0)) {
-     rotAmount += cur_rng->rmax_bits/4;
-   }
+ for (j=0; j<test[0]->tsamples; j+=b) {
 
-   /* Read (and rotate) the actual rng words. */
-   for (i=0; i<len; i++) {
-     input[i] = gsl_rng_get(cur_rng->rng);
-     input[i] = RotL(input[i], rotAmount, cur_rng->rmax_mask, cur_rng->rmax_bits);
-   }
+   b = test[0]->tsamples - j;
+   if (b > nbatch) b = nbatch;
 
-   /* Perform the DCT */
-   fDCT2_fft(input, dct, len);
+   /* Read (and rotate) the actual rng words for the whole batch. */
+   for (k=0; k<b; k++) {
 
-   /* Adjust the first value (the DC coefficient). */
-   dct[0] -= mean;
-   dct[0] /= sqrt(2);  // Experimental + guess; seems to be correct.
+     /* Change the rotation amount after each quarter of the samples
+      * have been used.
+      */
+     if (j+k != 0 && ((j+k) % (test[0]->tsamples / 4) == 0)) {
+       rotAmount += cur_rng->rmax_bits/4;
+     }
 
-   if (!useFallbackMethod) {
-     /* Primary method: find the position of the largest value. */
      for (i=0; i<len; i++) {
-       if (fabs(dct[i]) > max) {
-         pos = i;
-         max = fabs(dct[i]);
-       }
+       input[k*len+i] = gsl_rng_get(cur_rng->rng);
+       input[k*len+i] = RotL(input[k*len+i], rotAmount, cur_rng->rmax_mask, cur_rng->rmax_bits);
      }
-     /* And record it. */
-     positionCounts[pos]++;
+   }
+
+   /* Perform the DCTs */
+   if (plan != NULL && plan->len == len) {
+     dct2_batch(plan, input, dct, b);
    } else {
-     /* Fallback method: convert all values to pvalues. */
-     for (i=0; i<len; i++) {
-       ptest.x = dct[i] / sd;
-       Xtest_eval(&ptest);
-       pvalues[j*len + i] = ptest.pvalue;
+     for (k=0; k<b; k++) fDCT2(&input[k*len], &dct[k*len], len);
+   }
+
+   for (k=0; k<b; k++) {
+     double *d = &dct[k*len];
+     unsigned int pos = 0;
+     double max = 0;
+
+     /* Adjust the first value (the DC coefficient). */
+     d[0] -= mean;
+     d[0] /= sqrt(2);  // Experimental + guess; seems to be correct.
+
+     if (!useFallbackMethod) {
+       /* Primary method: find the position of the largest value. */
+       for (i=0; i<len; i++) {
+         if (fabs(d[i]) > max) {
+           pos = i;
+           max = fabs(d[i]);
+         }
+       }
+       /* And record it. */
+       positionCounts[pos]++;
+     } else {
+       /* Fallback method: convert all values to pvalues. */
+       for (i=0; i<len; i++) {
+         ptest.x = d[i] / sd;
+         Xtest_eval(&ptest);
+         pvalues[(j+k)*len + i] = ptest.pvalue;
+       }
      }
    }
  }
@@ -183,13 +241,15 @@ int dab_dct(Test **test,int irun, random_generator_t *cur_rng)
  } else {
    /* Fallback method: perform a ks test for uniformity of the
     * continuous p-values. */
-   test[0]->pvalues[irun] = kstest(pvalues, len * test[0]->tsamples);
+   test[0]->pvalues[irun] = kstest(pvalues, len * test[0]->tsamples,
+                                   pvalues + len * test[0]->tsamples);
  }
 
  nullfree(positionCounts);
  nullfree(pvalues);  /* Conditional; only used in fallback */
  nullfree(input);
  nullfree(dct);
+ dct2_plan_free(plan);
 
  return(0);
 }
@@ -236,9 +296,146 @@ void fDCT2_fft(const unsigned int input[], double output[], size_t len) {
 }
 
 /*
- * Old, now only used if working on a very short vector.
- * Simple (direct) implementation of the DCT, type II.
- * O(n^2) run time -- TODO  replace with faster implementation.
+ * Build a DCT-II plan for len (a power of 2, >= 8).  Returns NULL if
+ * len is unusable.
+ */
+dct2_plan *dct2_plan_alloc(unsigned int len) {
+ dct2_plan *plan;
+ unsigned int i, j, m, lg;
+
+ if (len < 8 || (len & (len - 1)) != 0) return NULL;
+
+ plan = (dct2_plan *) malloc(sizeof(dct2_plan));
+ plan->len = len;
+ plan->half = m = len / 2;
+ plan->bitrev = (unsigned int *) malloc(sizeof(unsigned int) * m);
+ plan->fft_tw = (double *) malloc(sizeof(double) * m);
+ plan->post_tw = (double *) malloc(sizeof(double) * 2 * m);
+ plan->dct_tw = (double *) malloc(sizeof(double) * 2 * len);
+ plan->work = (double *) malloc(sizeof(double) * 2 * m);
+
+ for (lg = 0; (1u << lg) < m; lg++);
+ for (i = 0; i < m; i++) {
+   unsigned int r = 0;
+   for (j = 0; j < lg; j++) r |= ((i >> j) & 1) << (lg - 1 - j);
+   plan->bitrev[i] = r;
+ }
+ for (i = 0; i < m/2; i++) {
+   plan->fft_tw[2*i]   =  cos(2.0 * M_PI * i / m);
+   plan->fft_tw[2*i+1] = -sin(2.0 * M_PI * i / m);
+ }
+ for (i = 0; i < m; i++) {
+   plan->post_tw[2*i]   =  cos(2.0 * M_PI * i / len);
+   plan->post_tw[2*i+1] = -sin(2.0 * M_PI * i / len);
+ }
+ for (i = 0; i < len; i++) {
+   plan->dct_tw[2*i]   =  cos(M_PI * i / (2.0 * len));
+   plan->dct_tw[2*i+1] = -sin(M_PI * i / (2.0 * len));
+ }
+
+ return plan;
+}
+
+void dct2_plan_free(dct2_plan *plan) {
+ if (plan == NULL) return;
+ free(plan->bitrev);
+ free(plan->fft_tw);
+ free(plan->post_tw);
+ free(plan->dct_tw);
+ free(plan->work);
+ free(plan);
+}
+
+/*
+ * Transform nvec consecutive vectors of plan->len words from input[]
+ * into output[], with the same (unnormalized) scaling as fDCT2():
+ *
+ *   X[k] = sum_j x[j] cos(pi/N (j + 1/2) k)
+ *
+ * This is Makhoul's method.  Reorder x into v (evens ascending, odds
+ * descending); then X[k] = Re(exp(-i pi k/2N) V[k]) where V is the
+ * length N DFT of v.  Since v is real, V comes from a length N/2 complex
+ * FFT of z[m] = v[2m] + i v[2m+1] and one post-twiddle pass, so the
+ * whole thing costs one half-length complex FFT per vector instead of
+ * the length 4N real FFT used by fDCT2_fft().
+ */
+void dct2_batch(dct2_plan *plan, const unsigned int input[], double output[], unsigned int nvec) {
+ unsigned int n, m, len, half, span, blk, i, k, t;
+ double *z = plan->work;
+ double ur, ui, wr, wi, tr, ti;
+ double er, ei, or_, oi, vr, vi;
+ const unsigned int *x;
+ double *X;
+
+ len = plan->len;
+ half = plan->half;
+
+ for (n = 0; n < nvec; n++) {
+   x = &input[n*len];
+   X = &output[n*len];
+
+   /*
+    * Load z in bit reversed order.  v[2m] = x[4m] and v[2m+1] = x[4m+2]
+    * for the first half of v; v[N-1-i] = x[2i+1] for the second half.
+    */
+   for (m = 0; m < half; m++) {
+     unsigned int i0 = 2*m, i1 = 2*m + 1;
+     double a = (i0 < half) ? x[2*i0] : x[2*(len-1-i0)+1];
+     double b = (i1 < half) ? x[2*i1] : x[2*(len-1-i1)+1];
+     z[2*plan->bitrev[m]]   = a;
+     z[2*plan->bitrev[m]+1] = b;
+   }
+
+   /* Iterative radix 2 decimation in time FFT of length half. */
+   for (span = 1; span < half; span *= 2) {
+     t = half / (2*span);   /* twiddle stride */
+     for (blk = 0; blk < half; blk += 2*span) {
+       for (i = 0; i < span; i++) {
+         wr = plan->fft_tw[2*i*t];
+         wi = plan->fft_tw[2*i*t+1];
+         ur = z[2*(blk+i)];
+         ui = z[2*(blk+i)+1];
+         tr = wr*z[2*(blk+i+span)] - wi*z[2*(blk+i+span)+1];
+         ti = wr*z[2*(blk+i+span)+1] + wi*z[2*(blk+i+span)];
+         z[2*(blk+i)] = ur + tr;
+         z[2*(blk+i)+1] = ui + ti;
+         z[2*(blk+i+span)] = ur - tr;
+         z[2*(blk+i+span)+1] = ui - ti;
+       }
+     }
+   }
+
+   /*
+    * Split Z into the DFTs of the even (E) and odd (O) samples of v,
+    * recombine them into V[k] and V[k+half], and apply the DCT twiddle.
+    */
+   for (k = 0; k < half; k++) {
+     unsigned int kc = (k == 0) ? 0 : half - k;
+     double zr = z[2*k], zi = z[2*k+1];
+     double cr = z[2*kc], ci = -z[2*kc+1];
+     er = 0.5*(zr + cr);
+     ei = 0.5*(zi + ci);
+     /* (Z[k] - conj(Z[half-k]))/(2i) */
+     or_ = 0.5*(zi - ci);
+     oi = -0.5*(zr - cr);
+     wr = plan->post_tw[2*k];
+     wi = plan->post_tw[2*k+1];
+     tr = wr*or_ - wi*oi;
+     ti = wr*oi + wi*or_;
+     vr = er + tr;
+     vi = ei + ti;
+     X[k] = plan->dct_tw[2*k]*vr - plan->dct_tw[2*k+1]*vi;
+     vr = er - tr;
+     vi = ei - ti;
+     X[k+half] = plan->dct_tw[2*(k+half)]*vr - plan->dct_tw[2*(k+half)+1]*vi;
+   }
+ }
+}
+
+/*
+ * Simple (direct) implementation of the DCT, type II, O(n^2).  This is
+ * only the fallback for lengths dct2_batch() has no plan for:  len <= 4
+ * or not a power of 2.
  * Note:  the GSL library has lots of FFTs, DWT, and DHT, but not DCT!
  * DCT can be efficiently implemented using FFT, though.
  */
@@ -310,15 +507,19 @@ double evalMostExtreme(double *pvalue, unsigned int num) {
 
 int main_dab_dct() {
  unsigned int input[] = { 4, 5, 6, 5, 4, 3, 2, 1, 1, 2, 3, 4, 5, 6, 7, 8 };
- double output1[16], output2[16], output3[16];
+ double output1[16], output2[16], output3[16], output4[16];
+ dct2_plan *plan;
  int i;
 
  fDCT2(input, output1, 16);
  iDCT2(output1, output2, 16);
  fDCT2_fft(input, output3, 16);
+ plan = dct2_plan_alloc(16);
+ dct2_batch(plan, input, output4, 1);
+ dct2_plan_free(plan);
 
  for (i = 0; i < 16; i++) {
-   printf("%d: %d %f %f %f\n", i, input[i], output1[i], output3[i], output2[i]);
+   printf("%d: %d %f %f %f %f\n", i, input[i], output1[i], output3[i], output4[i], output2[i]);
  }
 
  return 0;
@@ -35,18 +35,17 @@ static double targetData[] = {
 };
 
 inline int insert(double x, double *array, unsigned int startVal);
+int filltree_lanes(unsigned int ntrees, int size, unsigned int target,
+                   double *counts, double *positionCounts,
+                   random_generator_t *cur_rng);
 
 int dab_filltree(Test **test,int irun, random_generator_t *cur_rng) {
- int size = (ntuple == 0) ? 32 : ntuple;
+ int size = (test[0]->ntuple_cl == 0) ? 32 : test[0]->ntuple_cl;
  unsigned int target = sizeof(targetData)/sizeof(double);
- int startVal = (size / 2) - 1;
- double *array = (double *) malloc(sizeof(double) * size);
  double *counts, *expected;
- int i, j;
- double x;
+ int i;
  unsigned int start = 0;
  unsigned int end = 0;
- unsigned int rotAmount = 0;
  double *positionCounts;
 
  counts = (double *) malloc(sizeof(double) * target);
@@ -69,25 +68,17 @@ int dab_filltree(Test **test,int irun, random_generator_t *cur_rng) {
  start++;
 
 
- for (j = 0; j < test[0]->tsamples; j++) {
-   int ret;
-   memset(array, 0, sizeof(double) * size);
-   i = 0;
-   do {
-     unsigned int v = gsl_rng_get(cur_rng->rng);
-
-     x = ((double) RotL(v, rotAmount, cur_rng->rmax_mask, cur_rng->rmax_bits)) / cur_rng->rmax_mask;
-     i++;
-     if (i > size * 2) {
-       test[0]->pvalues[irun] = 0;
-       return(0);
-     }
-     ret = insert(x, array, startVal);
-   } while (ret == -1);
-   positionCounts[ret/2]++;
-
-   counts[i-1]++;
-   if (j % (test[0]->tsamples/CYCLES) == 0) rotAmount++;
+ /*
+  * A generator stuck on words that can't fill a tree (e.g. all zeros)
+  * fails outright, as it always has.
+  */
+ if (filltree_lanes(test[0]->tsamples, size, target, counts, positionCounts, cur_rng) != 0) {
+   test[0]->pvalues[irun] = 0;
+   test[1]->pvalues[irun] = 0;
+   nullfree(positionCounts);
+   nullfree(expected);
+   nullfree(counts);
+   return(0);
  }
 
  test[0]->st_values[irun] = test[0]->pvalues[irun] = chisq_pearson(counts + start, expected + start, end - start);
@@ -99,11 +90,158 @@ int dab_filltree(Test **test,int irun, random_generator_t *cur_rng) {
  nullfree(positionCounts);
  nullfree(expected);
  nullfree(counts);
- nullfree(array);
 
  return(0);
 }
 
+/*
+ * The straightforward way to run this test is one tree at a time, with
+ * insert() walking a dependent chain of compare-and-branch steps per
+ * word.  Those branches are unpredictable by construction (the data is
+ * random!) and each step waits on the load of the previous one, so the
+ * CPU mostly sits and waits.
+ *
+ * Instead we fill FILLTREE_LANES independent trees in lockstep.  Each
+ * lane has its own slice of FILLTREE_SLICE consecutive words of the rng
+ * stream and hands its tree the next word of it every round, and all
+ * lanes then descend their trees one level at a time using conditional
+ * moves only, so the loads for the different lanes overlap.  When a
+ * lane's insert fails we record its count and position exactly as the
+ * serial code did and start that lane on the next tree.
+ *
+ * A word that rotates to x == 0 "fits" without filling anything, so a
+ * tree is given at most 2*size words, as in the serial code; a tree
+ * that needs more means the generator is stuck, and we give up and
+ * return -1.  A lane only starts a tree when 2*size words are left in
+ * its slice (otherwise it drops the rest and reads a fresh slice), so
+ * no lane ever reads past the end of its slice and every tree is still
+ * built from consecutive words of the stream, just as in the serial
+ * code, whatever FILLTREE_LANES is.  Tree j is rotated by the same
+ * amount the serial loop would have used for it.
+ */
+#define FILLTREE_LANES 8
+#define FILLTREE_SLICE 4096
+
+int filltree_lanes(unsigned int ntrees, int size, unsigned int target,
+                   double *counts, double *positionCounts,
+                   random_generator_t *cur_rng)
+{
+ double *trees;
+ double *tree[FILLTREE_LANES];
+ unsigned int tree_j[FILLTREE_LANES], nwords[FILLTREE_LANES];
+ unsigned int rot[FILLTREE_LANES];
+ unsigned int idx[FILLTREE_LANES], placed[FILLTREE_LANES];
+ double x[FILLTREE_LANES];
+ unsigned int *slices;
+ unsigned int *slice[FILLTREE_LANES], pos[FILLTREE_LANES];
+ unsigned int slice_len;
+ unsigned int startVal = (size / 2) - 1;
+ unsigned int d, quarter, next_j, active, lane, k, stuck;
+
+ /*
+  * rotAmount is bumped after tree j whenever j % quarter == 0, so tree
+  * j is rotated by ceil(j/quarter).
+  */
+ quarter = ntrees / CYCLES;
+ if (quarter == 0) quarter = 1;
+
+ slice_len = FILLTREE_SLICE;
+ if (slice_len < 4 * (unsigned int) size) slice_len = 4 * size;
+
+ trees = (double *) malloc(sizeof(double) * size * FILLTREE_LANES);
+ memset(trees, 0, sizeof(double) * size * FILLTREE_LANES);
+ slices = (unsigned int *) malloc(sizeof(unsigned int) * slice_len * FILLTREE_LANES);
+
+ next_j = 0;
+ active = 0;
+ stuck = 0;
+ for (lane = 0; lane < FILLTREE_LANES; lane++) {
+   tree[lane] = &trees[lane * size];
+   slice[lane] = &slices[lane * slice_len];
+   pos[lane] = slice_len;     /* Empty; read on its first tree */
+   idx[lane] = startVal;
+   placed[lane] = 1;
+   tree_j[lane] = ntrees;     /* idle */
+ }
+
+ while (1) {
+
+   /*
+    * Start idle lanes on the next trees, each with room for a whole
+    * tree in its slice.
+    */
+   for (lane = 0; lane < FILLTREE_LANES; lane++) {
+     if (tree_j[lane] < ntrees || next_j >= ntrees || stuck) continue;
+     if (slice_len - pos[lane] < 2 * (unsigned int) size) {
+       for (k = 0; k < slice_len; k++) slice[lane][k] = gsl_rng_get(cur_rng->rng);
+       pos[lane] = 0;
+     }
+     tree_j[lane] = next_j++;
+     rot[lane] = (tree_j[lane] + quarter - 1) / quarter;
+     nwords[lane] = 0;
+     active++;
+   }
+   if (active == 0) break;
+
+   /*
+    * Deal each busy lane the next word of its slice, or retire it if
+    * its tree has had all 2*size words it gets.
+    */
+   for (lane = 0; lane < FILLTREE_LANES; lane++) {
+     unsigned int v;
+     if (tree_j[lane] >= ntrees) continue;
+     if (nwords[lane] >= 2 * (unsigned int) size || pos[lane] >= slice_len) {
+       stuck = 1;
+       memset(tree[lane], 0, sizeof(double) * size);
+       tree_j[lane] = ntrees;
+       idx[lane] = startVal;
+       placed[lane] = 1;
+       active--;
+       continue;
+     }
+     v = slice[lane][pos[lane]++];
+     x[lane] = ((double) RotL(v, rot[lane], cur_rng->rmax_mask, cur_rng->rmax_bits)) / cur_rng->rmax_mask;
+     idx[lane] = startVal;
+     placed[lane] = 0;
+     nwords[lane]++;
+   }
+
+   /*
+    * Descend all the trees one level at a time.  This is insert(),
+    * unrolled across lanes and made branch free:  an empty node takes
+    * x, and a lane that has placed its word stops moving.  Idle lanes
+    * are parked with placed set so they never move or store.
+    */
+   for (d = (startVal + 1) / 2; d > 0; d /= 2) {
+     for (lane = 0; lane < FILLTREE_LANES; lane++) {
+       double a = tree[lane][idx[lane]];
+       unsigned int empty = (a == 0) & !placed[lane];
+       unsigned int step = (a < x[lane]) ? idx[lane] + d : idx[lane] - d;
+       tree[lane][idx[lane]] = empty ? x[lane] : a;
+       placed[lane] |= empty;
+       idx[lane] = placed[lane] ? idx[lane] : step;
+     }
+   }
+
+   /* Retire lanes whose word didn't fit; they start over above. */
+   for (lane = 0; lane < FILLTREE_LANES; lane++) {
+     if (tree_j[lane] >= ntrees || placed[lane]) continue;
+     positionCounts[idx[lane]/2]++;
+     if (nwords[lane] - 1 < target) counts[nwords[lane]-1]++;
+     memset(tree[lane], 0, sizeof(double) * size);
+     tree_j[lane] = ntrees;
+     idx[lane] = startVal;
+     placed[lane] = 1;
+     active--;
+   }
+ }
+
+ nullfree(slices);
+ nullfree(trees);
+ return stuck ? -1 : 0;
+
+}
+
 
 inline int insert(double x, double *array, unsigned int startVal) {
  uint d = (startVal + 1) / 2;
@@ -93,19 +93,18 @@ static double targetData[128] = {  // size=128, generated from 6e9 samples
 };
 
 inline int insertBit(uint x, uchar *array, uint *i, uint *d);
+void filltree2_lanes(uint ntrees, int size, uint target,
+                     double *counts, double *positionCounts,
+                     random_generator_t *cur_rng);
 
 int dab_filltree2(Test **test, int irun, random_generator_t *cur_rng) {
- int size = (ntuple == 0) ? 128 : ntuple;
+ int size = (test[0]->ntuple_cl == 0) ? 128 : test[0]->ntuple_cl;
  uint target = sizeof(targetData)/sizeof(double);
- int startVal = (size / 2) - 1;
- uchar *array = (uchar *) malloc(sizeof(*array) * size);
  double *counts, *expected;
- int i, j;
- uint x;
+ int i;
  uint start = 0;
  uint end = 0;
  double *positionCounts;
- uint bitCount;
 
  test[0]->ntuple = 0;
  test[1]->ntuple = 1;
@@ -128,34 +127,7 @@ int dab_filltree2(Test **test, int irun, random_generator_t *cur_rng) {
  start++;
 
 
- x = gsl_rng_get(cur_rng->rng);
- bitCount = cur_rng->rmax_bits;
- for (j = 0; j < test[0]->tsamples; j++) {
-   int ret;
-   memset(array, 0, sizeof(*array) * size);
-   i = 0;
-   do {  /* While new markers can be aded to this tree.... */
-     uint index = startVal;
-     uint d = (startVal + 1) / 2;
-     if (i > size * 2) {
-       test[0]->pvalues[irun] = 0;
-       return(0);
-     }
-     do {  /* While this path has not yet found a blank node to mark.... */
-       ret = insertBit(x & 0x01, array, &index, &d);  /* Keep going */
-       x >>= 1;
-       if (--bitCount == 0) {
-         x = gsl_rng_get(cur_rng->rng);
-         bitCount = cur_rng->rmax_bits;
-       }
-     } while (ret == -2);  /* End of path. */
-
-     i++;
-   } while (ret == -1);  /* Couldn't insert marker; end of this tree. */
-   positionCounts[ret/2]++;
-
-   counts[i-1]++;
- }
+ filltree2_lanes(test[0]->tsamples, size, target, counts, positionCounts, cur_rng);
 
  /* First p-value is calculated based on the targetData array. */
  test[0]->st_values[irun] = test[0]->pvalues[irun] = chisq_pearson(counts + start, expected + start, end - start);
@@ -168,11 +140,127 @@ int dab_filltree2(Test **test, int irun, random_generator_t *cur_rng) {
  nullfree(positionCounts);
  nullfree(expected);
  nullfree(counts);
- nullfree(array);
 
  return(0);
 }
 
+/*
+ * Lockstep version of the tree walk, in the same spirit as the one in
+ * dab_filltree.c.  Walking one tree with insertBit() is a chain of
+ * unpredictable branches, each waiting on the previous load.  Here
+ * FILLTREE2_LANES independent trees take one step (one bit) each per
+ * round.  Each lane has its own slice of consecutive words of the rng
+ * stream and keeps its own current word and bit count, so each tree
+ * sees its bits LSB first exactly as before.  The step itself is
+ * insertBit() done with conditional moves; only new words and finished
+ * trees (once every few hundred steps) take a branch.
+ *
+ * A tree can't take more than (size-1) markers of at most depth bits
+ * each, and a lane only starts a tree when its slice holds that many
+ * bits (otherwise it drops the rest and reads a fresh slice), so every
+ * tree is still built from consecutive bits of the stream, whatever
+ * FILLTREE2_LANES is.
+ */
+#define FILLTREE2_LANES 8
+#define FILLTREE2_SLICE 4096
+
+void filltree2_lanes(uint ntrees, int size, uint target,
+                     double *counts, double *positionCounts,
+                     random_generator_t *cur_rng)
+{
+ uchar *trees;
+ uchar *tree[FILLTREE2_LANES];
+ uint tree_j[FILLTREE2_LANES], markers[FILLTREE2_LANES];
+ uint x[FILLTREE2_LANES], bitCount[FILLTREE2_LANES];
+ uint idx[FILLTREE2_LANES], dl[FILLTREE2_LANES];
+ uint *slices;
+ uint *slice[FILLTREE2_LANES], pos[FILLTREE2_LANES];
+ uint slice_len, need, depth, k;
+ uint startVal = (size / 2) - 1;
+ uint d0 = (startVal + 1) / 2;
+ uint next_j, active, lane;
+
+ /* The most words one tree can use, with the lane's current word */
+ for (depth = 0, k = d0; k > 0; k /= 2) depth++;
+ need = ((size - 1) * depth + cur_rng->rmax_bits - 1) / cur_rng->rmax_bits + 1;
+ slice_len = FILLTREE2_SLICE;
+ if (slice_len < 4 * need) slice_len = 4 * need;
+
+ trees = (uchar *) malloc(sizeof(uchar) * size * FILLTREE2_LANES);
+ memset(trees, 0, sizeof(uchar) * size * FILLTREE2_LANES);
+ slices = (uint *) malloc(sizeof(uint) * slice_len * FILLTREE2_LANES);
+
+ next_j = 0;
+ active = 0;
+ for (lane = 0; lane < FILLTREE2_LANES; lane++) {
+   tree[lane] = &trees[lane * size];
+   slice[lane] = &slices[lane * slice_len];
+   pos[lane] = slice_len;     /* Empty; read on its first tree */
+   idx[lane] = startVal;
+   dl[lane] = d0;
+   markers[lane] = 0;
+   bitCount[lane] = 0;
+   x[lane] = 0;
+   tree_j[lane] = ntrees;     /* idle */
+ }
+
+ while (1) {
+
+   /*
+    * Start idle lanes on the next trees, each with room for a whole
+    * tree in its slice.
+    */
+   for (lane = 0; lane < FILLTREE2_LANES; lane++) {
+     if (tree_j[lane] < ntrees || next_j >= ntrees) continue;
+     if (slice_len - pos[lane] < need) {
+       for (k = 0; k < slice_len; k++) slice[lane][k] = gsl_rng_get(cur_rng->rng);
+       pos[lane] = 0;
+       bitCount[lane] = 0;
+     }
+     tree_j[lane] = next_j++;
+     active++;
+   }
+   if (active == 0) break;
+
+   for (lane = 0; lane < FILLTREE2_LANES; lane++) {
+     uint i, d, m, b, fail;
+     if (tree_j[lane] >= ntrees) continue;
+
+     if (bitCount[lane] == 0) {
+       x[lane] = slice[lane][pos[lane]++];
+       bitCount[lane] = cur_rng->rmax_bits;
+     }
+
+     /* One insertBit() step, branch free. */
+     b = x[lane] & 0x01;
+     x[lane] >>= 1;
+     bitCount[lane]--;
+     i = b ? idx[lane] + dl[lane] : idx[lane] - dl[lane];
+     d = dl[lane] / 2;
+     m = tree[lane][i];
+     tree[lane][i] = 1;
+     markers[lane] += (m == 0);
+     fail = (m != 0) & (d == 0);
+     idx[lane] = ((m == 0) | (d == 0)) ? startVal : i;
+     dl[lane] = ((m == 0) | (d == 0)) ? d0 : d;
+
+     if (fail) {
+       /* The failed path counts as one more, just as in the serial code. */
+       positionCounts[i/2]++;
+       if (markers[lane] < target) counts[markers[lane]]++;
+       memset(tree[lane], 0, sizeof(uchar) * size);
+       markers[lane] = 0;
+       tree_j[lane] = ntrees;
+       active--;
+     }
+   }
+ }
+
+ nullfree(slices);
+ nullfree(trees);
+
+}
+
 /* 
  * Insert a bit into the tree, represented by an array.
  * A value of one is marked; zero is unmarked.
@@ -20,16 +20,19 @@
 #include <dieharder/libdieharder.h>
 #define BLOCK_MAX (16)
 
+/* Words are generated in chunks of at least 2^MONOBIT2_SHIFT. */
+#define MONOBIT2_SHIFT (12)
+
 /* The evalMostExtreme function is in dab_dct.c */
 extern double evalMostExtreme(double *pvalue, uint num);
 
 int dab_monobit2(Test **test, int irun, random_generator_t *cur_rng)
 {
- uint i, j;
+ uint i, j, k, nw, nb, chunk;
  uint blens = cur_rng->rmax_bits;
- uint ntup = ntuple;
+ uint ntup = test[0]->ntuple_cl;
  double *counts;
- uint *tempCount;
+ uint *rand_int, *blockCount;
  double pvalues[BLOCK_MAX];
 
  /* First, find out the maximum block size to use.
@@ -49,35 +52,31 @@ int dab_monobit2(Test **test, int irun, random_generator_t *cur_rng)
  counts = (double *) malloc(sizeof(*counts) * blens * (2<<ntup));  // 1 << (ntup+1)
  memset(counts, 0, sizeof(*counts) * blens * (2<<ntup));
 
- tempCount = (uint *) malloc(sizeof(*tempCount) * ntup);
- memset(tempCount, 0, sizeof(*tempCount) * ntup);
-
- for(i=0;i<test[0]->tsamples;i++) {
-   uint n = gsl_rng_get(cur_rng->rng);
-   uint t = 1;
-
-   // Begin: count bits
-   n -= (n >> 1) & 0x55555555;
-   n = (n & 0x33333333) + ((n >> 2) & 0x33333333);
-   n = (n + (n >> 4)) & 0x0f0f0f0f;
-
-   if (0) {
-     n = (n * 0x01010101) >> 24;
-  } else {
-     n = n + (n >> 8);
-     n = (n + (n >> 16)) & 0x3f;
-  }
-  // End: count bits
-
-  for (j = 0; j < ntup; j++) {
-    tempCount[j] += n;  // Update block count
-
-    if ((t & i) && !(t & (i-1))) {  // If this is the start of a new block
-      counts[blens * ((2<<j)-1) + tempCount[j]]++;  // Save the count
-      tempCount[j] = 0;  // Reset the counter
-    }
-    t <<=1;
-  }
+ /* Count the ones a chunk of words at a time.  A chunk is a whole
+  * number of the largest blocks, so only the tail of the very last
+  * chunk can leave a partial block (which is dropped, leaving exactly
+  * tsamples/(2<<j) blocks of size 2<<j).  popcount_blocks() counts the
+  * 2 word blocks; each larger size is the sum of pairs of the previous
+  * size, done in place.
+  */
+ chunk = (ntup > MONOBIT2_SHIFT) ? (1u << ntup) : (1u << MONOBIT2_SHIFT);
+ rand_int = (uint *) malloc(sizeof(*rand_int) * chunk);
+ blockCount = (uint *) malloc(sizeof(*blockCount) * chunk);
+
+ for (i = 0; i < test[0]->tsamples; i += nw) {
+   nw = test[0]->tsamples - i;
+   if (nw > chunk) nw = chunk;
+   for (k = 0; k < nw; k++) rand_int[k] = gsl_rng_get(cur_rng->rng);
+
+   popcount_blocks(rand_int, nw, 2, blockCount);
+   nb = nw / 2;
+   for (j = 0; j < ntup; j++) {
+     if (j > 0) {
+       nb /= 2;
+       for (k = 0; k < nb; k++) blockCount[k] = blockCount[2*k] + blockCount[2*k+1];
+     }
+     for (k = 0; k < nb; k++) counts[blens * ((2<<j)-1) + blockCount[k]]++;
+   }
  }
 
  /* Calculate the p-value for each block size. */
@@ -94,7 +93,8 @@ int dab_monobit2(Test **test, int irun, random_generator_t *cur_rng)
  test[0]->pvalues[irun] = evalMostExtreme(pvalues, ntup);
 
  nullfree(counts);
- nullfree(tempCount);
+ nullfree(rand_int);
+ nullfree(blockCount);
 
  return(0);
 }
@@ -64,12 +64,13 @@ int diehard_2dsphere(Test **test, int irun, random_generator_t *cur_rng)
   * the straightforward N^2 algorithm, but we'll see.
   */
  dTuple *points;
+ double *coords;
  double dist,mindist;
 
  /*
   * for display only.
   */
- test[0]->ntuple = ntuple;
+ test[0]->ntuple = test[0]->ntuple_cl;
 
  /*
   * Generate d-tuples of tsamples random coordinates in the range 0-10000
@@ -85,16 +86,18 @@ int diehard_2dsphere(Test **test, int irun, random_generator_t *cur_rng)
  if(verbose == D_DIEHARD_2DSPHERE || verbose == D_ALL){
      printf("Generating a list of %u points in %d dimensions\n",test[0]->tsamples,test[0]->ntuple);
  }
+ /*
+  * Generate the d-dimensional points in the unit d-cube (with
+  * periodic boundary conditions), all of the coordinates in one block.
+  */
+ coords = (double *)malloc(2*test[0]->tsamples*sizeof(double));
+ get_rand_uniform_block(coords,2*test[0]->tsamples,1,cur_rng);
  for(t=0;t<test[0]->tsamples;t++){
-   /*
-    * Generate a new d-dimensional point in the unit d-cube (with
-    * periodic boundary conditions).
-    */
    if(verbose == D_DIEHARD_2DSPHERE || verbose == D_ALL){
        printf("points[%u]: (",t);
    }
    for(d=0;d<2;d++) {
-     points[t].c[d] = gsl_rng_uniform_pos(cur_rng->rng)*10000;
+     points[t].c[d] = coords[2*t + d]*10000;
      if(verbose == D_DIEHARD_2DSPHERE || verbose == D_ALL){
        printf("%6.4f",points[t].c[d]);
        if(d == 1){
@@ -106,14 +109,13 @@ int diehard_2dsphere(Test **test, int irun, random_generator_t *cur_rng)
    }
  }
 
+ nullfree(coords);
+
  /*
-  * Now we sort the points using gsl_heapsort and a comparator
-  * on the first coordinate only.  Don't know how to get rid
-  * of the gcc prototype warning.  Probably need a cast of some
-  * sort.
+  * Now we sort the points on the first coordinate only (a radix
+  * sort, see radix_sort.c).
   */
- gsl_heapsort(points,test[0]->tsamples,sizeof(dTuple),
-                    (gsl_comparison_fn_t) compare_points);
+ radix_sort_dtuple(points,test[0]->tsamples);
 
  if(verbose == D_DIEHARD_2DSPHERE || verbose == D_ALL){
    printf("List of points sorted by first coordinate:\n");
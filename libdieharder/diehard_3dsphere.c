@@ -34,6 +34,7 @@ int diehard_3dsphere(Test **test, int irun, random_generator_t *cur_rng)
 
  int j,k;
  C3_3D *c3;
+ double *coords;
  double r1,r2,r3,rmin,r3min;
  double xdelta,ydelta,zdelta;
 
@@ -54,12 +55,15 @@ int diehard_3dsphere(Test **test, int irun, random_generator_t *cur_rng)
   */
  c3 = (C3_3D *)malloc(POINTS_3D*sizeof(C3_3D));
 
+ coords = (double *)malloc(POINTS_3D*DIM_3D*sizeof(double));
+ get_rand_uniform_block(coords,POINTS_3D*DIM_3D,1,cur_rng);
+
  rmin = 2000.0;
  for(j=0;j<POINTS_3D;j++){
    /*
     * Generate a new point in the cube.
     */
-   for(k=0;k<DIM_3D;k++) c3[j].x[k] = 1000.0*gsl_rng_uniform_pos(cur_rng->rng);
+   for(k=0;k<DIM_3D;k++) c3[j].x[k] = 1000.0*coords[j*DIM_3D + k];
    if(verbose == D_DIEHARD_3DSPHERE || verbose == D_ALL){
      printf("%d: (%8.2f,%8.2f,%8.2f)\n",j,c3[j].x[0],c3[j].x[1],c3[j].x[2]);
    }
@@ -97,6 +101,7 @@ int diehard_3dsphere(Test **test, int irun, random_generator_t *cur_rng)
  }
 
  nullfree(c3);
+ nullfree(coords);
 
  return(0);
 
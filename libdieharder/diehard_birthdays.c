@@ -53,6 +53,7 @@ int diehard_birthdays(Test **test, int irun, random_generator_t *cur_rng)
  uint i,k,t,m,mnext;
  uint *js;
  uint rand_uint[NMS];
+ uint scratch[NMS];   /* for radix_sort_uint(), reused by every sort */
  
  double binfreq;
 
@@ -126,17 +127,17 @@ int diehard_birthdays(Test **test, int irun, random_generator_t *cur_rng)
     * per bitstring, so that our samples are >>independent<<, and average
     * over any particular bit position used as a starting point with
     * cyclic/periodic bit wrap.
+    *
+    * This tests PRECISELY nbits guaranteed sequential bits from the
+    * generator, with no gaps.  We could actually test 32.  They are
+    * the same bits nms calls to get_rand_bits() would return, just
+    * unpacked all at once.
+    *
+    * Note -- removed all reference to overlap.
     */
-   memset(rand_uint,0,nms*sizeof(uint));
-   for(m = 0;m<nms;m++){
-     /*
-      * This tests PRECISELY nbits guaranteed sequential bits from the
-      * generator, with no gaps.  We could actually test 32.
-      *
-      * Note -- removed all reference to overlap.
-      */
-     get_rand_bits(&rand_uint[m],sizeof(uint),nbits,cur_rng);
-     MYDEBUG(D_DIEHARD_BDAY){
+   get_rand_bits_block(rand_uint,nms,nbits,cur_rng);
+   MYDEBUG(D_DIEHARD_BDAY){
+     for(m = 0;m<nms;m++){
        printf("  %d-bit int = ",nbits);
        /* Should count dump from the right, sorry */
        dumpbits(&rand_uint[m],32);
@@ -153,7 +154,7 @@ int diehard_birthdays(Test **test, int irun, random_generator_t *cur_rng)
        printf("Before sort %u:  %u\n",m,rand_uint[m]);
      }
    }
-   gsl_sort_uint(rand_uint,1,nms);
+   radix_sort_uint(rand_uint,nms,scratch);
    MYDEBUG(D_DIEHARD_BDAY){
      for(m=0;m<nms;m++){
        printf("After sort %u:  %u\n",m,rand_uint[m]);
@@ -168,7 +169,7 @@ int diehard_birthdays(Test **test, int irun, random_generator_t *cur_rng)
    for(m=1;m<nms;m++){
      intervals[m] = rand_uint[m] - rand_uint[m-1];
    }
-   gsl_sort_uint(intervals,1,nms);
+   radix_sort_uint(intervals,nms,scratch);
    MYDEBUG(D_DIEHARD_BDAY){
      for(m=0;m<nms;m++){
        printf("Sorted Intervals %u:  %u\n",m,intervals[m]);
@@ -41,14 +41,19 @@
  */
 #include "static_get_bits.c"
 
+/*
+ * Number of 20 bit words unpacked at a time.
+ */
+#define BS_BLOCK 1024
+
 int diehard_bitstream(Test **test, int irun, random_generator_t *cur_rng)
 {
 
- uint i,j,t,boffset,coffset;
+ uint i,j,t,nw;
  Xtest ptest;
  char *w;
- uint *bitstream,w20,wscratch,newbyte;
- unsigned char *cbitstream = 0;
+ uint *bitstream,w20[BS_BLOCK];
+ unsigned char *cbitstream;
  uint overlap = 1;  /* Leftovers/Cruft */
 
  /*
@@ -81,9 +86,7 @@ int diehard_bitstream(Test **test, int irun, random_generator_t *cur_rng)
  if(overlap){
    ptest.sigma = 428.0;
    bitstream = (uint *)malloc(BS_OVERLAP*sizeof(uint));
-   for(i = 0; i < BS_OVERLAP; i++){
-     bitstream[i] = get_rand_bits_uint(32,0xffffffff,cur_rng, 0);
-   }
+   get_rand_bits_uint_block(bitstream,BS_OVERLAP,32,cur_rng);
    MYDEBUG(D_DIEHARD_BITSTREAM) {
      printf("# diehard_bitstream: Filled bitstream with %u rands for overlapping\n",BS_OVERLAP);
      printf("# diehard_bitstream: samples.  Target is mean 141909, sigma = 428.\n");
@@ -91,10 +94,7 @@ int diehard_bitstream(Test **test, int irun, random_generator_t *cur_rng)
  } else {
    ptest.sigma = 290.0;
    bitstream = (uint *)malloc(BS_NO_OVERLAP*sizeof(uint));
-   for(i = 0; i < BS_NO_OVERLAP; i++){
-     bitstream[i] = get_rand_bits_uint(32,0xffffffff,cur_rng, 0);
-   }
-   cbitstream = (unsigned char *)bitstream;   /* To allow us to access it by bytes */
+   get_rand_bits_uint_block(bitstream,BS_NO_OVERLAP,32,cur_rng);
    MYDEBUG(D_DIEHARD_BITSTREAM) {
      printf("# diehard_bitstream: Filled bitstream with %u rands for non-overlapping\n",BS_NO_OVERLAP);
      printf("# diehard_bitstream: samples.  Target is mean 141909, sigma = 290.\n");
@@ -117,126 +117,43 @@ int diehard_bitstream(Test **test, int irun, random_generator_t *cur_rng)
    printf("# diehard_bitstream: w[] (counter vector) is allocated and zeroed\n");
  }
 
- i = 0;
- wscratch = bitstream[i++];     /* Get initial uint into wscratch */
- for(t=0;t<test[0]->tsamples;t++){
-
+ /*
+  * The 20 bit words are unpacked from bitstream a block at a time (see
+  * unpack_bits.c).  The window starts 8 bits into the stream, as it
+  * always has, so the words are the ones the test has always seen.
+  *
+  * For overlapping samples we have to slide the 20-bit window along one
+  * bit at a time to be able to use Marsaglia's sigma of 428:  word t is
+  * bits t+8 to t+27 of the stream, most significant bit first.
+  *
+  * Non-overlapping samples were always taken 2.5 bytes at a time from
+  * bitstream viewed as a string of bytes (in memory order, which on a
+  * little endian machine is not the order of the bits in a uint).  We
+  * reorder each uint's bytes the same way first, which makes word t
+  * bits 20t+8 to 20t+27 of that string.
+  */
+ if(!overlap){
+   for(i=0;i<BS_NO_OVERLAP;i++){
+     cbitstream = (unsigned char *)&bitstream[i];
+     bitstream[i] = ((uint)cbitstream[0] << 24) | ((uint)cbitstream[1] << 16) |
+                    ((uint)cbitstream[2] << 8) | (uint)cbitstream[3];
+   }
+ }
+ for(t=0;t<test[0]->tsamples;t+=nw){
+   nw = test[0]->tsamples - t;
+   if(nw > BS_BLOCK) nw = BS_BLOCK;
    if(overlap){
-
-     /*
-      * We have to slide an overlapping 20-bit window along one bit at a
-      * time to be able to use Marsaglia's sigma of 428.  We do this by
-      * taking two scratch uints and pulling a left, right trick to get
-      * the desired window for 8 returns, then shifting left a byte for
-      * four bytes, advancing to the next full uint in bitstream[] on
-      * the boundary.  Yuk, but what can one do?
-      */
-     coffset = (t%32)/8;     /* next byte to shift in from bitstream, 0,1,2 or 3 */
-     boffset = t%8;          /* bit offset of w20 in wscratch */
-     i = t/32 + 1;           /* bitstream index of uint from which we draw next byte */
-     /* printf("t = %u, coffset = %u\n",t,coffset); */
-     if(boffset == 0) {      /* Get a new byte */
-       wscratch = wscratch << 8;  /* make room for next byte */
-       /*
-       printf("# diehard_bitstream: left shift 8 wscratch = ");
-       dumpuintbits(&wscratch, 1);
-       printf("\n");
-       */
-       newbyte = bitstream[i] << (8*coffset);
-       /*
-       printf("# diehard_bitstream: left shift %u newbyte = ",8*coffset);
-       dumpuintbits(&newbyte, 1);
-       printf("\n");
-       */
-       newbyte = newbyte >> 24;
-       /*
-       printf("# diehard_bitstream: newbyte = ");
-       dumpuintbits(&newbyte, 1);
-       printf("\n");
-       */
-       wscratch += newbyte;
-     }
-     /*
-     MYDEBUG(D_DIEHARD_BITSTREAM) {
-       printf("# diehard_bitstream: wscratch = ");
-       dumpuintbits(&wscratch, 1);
-       printf("\n");
-     }
-     */
-     w20 = ((wscratch << boffset) >> 12);
-     MYDEBUG(D_DIEHARD_BITSTREAM) {
-       printf("# diehard_bitstream: w20 = ");
-       dumpuintbits(&w20, 1);
-       printf("\n");
-     }
-     w[w20]++;
-
+     unpack_bits_overlap_u32(bitstream,t + 8,20,nw,w20);
    } else {
-
-     /*
-      * For non-overlapping samples, easiest way is to just get 2.5 bytes
-      * at a time and keep track of a byte index into bitstream,
-      * cbitstream.  Then things are actually pretty straightforward.
-      */
+     unpack_bits_u32(bitstream,20*t + 8,20,nw,w20);
+   }
+   for(j=0;j<nw;j++){
      MYDEBUG(D_DIEHARD_BITSTREAM) {
-       printf("# diehard_bitstream: Non-overlapping t = %u, i = %u\n",t,i);
-     }
-     if(t%2 == 0){
-       w20 = 0;  /* Start with window clear, of course... */
-       for(j=0;j<2;j++){          /* Get two bytes */
-         w20 = w20 << 8;          /* Does nothing on first call */
-         w20 += cbitstream[i];  /* Shift in each byte */
-         MYDEBUG(D_DIEHARD_BITSTREAM) {
-           printf("# diehard_bitstream: i = %u  cb = %u w20 = ",i,cbitstream[i]);
-           dumpuintbits(&w20, 1);
-           printf("\n");
-         }
-	 i++;
-       }
-       wscratch = (uint) (cbitstream[i] >> 4);    /* Get first 4 bits of next byte */
-       MYDEBUG(D_DIEHARD_BITSTREAM) {
-         printf("# diehard_bitstream: wscratch = ");
-         dumpuintbits(&wscratch, 1);
-         printf("\n");
-       }
-       w20 = (w20 << 4) + wscratch;               /* Gets evens */
-       MYDEBUG(D_DIEHARD_BITSTREAM) {
-         printf("# diehard_bitstream: w20 = ");
-         dumpuintbits(&w20, 1);
-         printf("\n");
-       }
-     } else {
-       wscratch = (uint) cbitstream[i];
-       MYDEBUG(D_DIEHARD_BITSTREAM) {
-         printf("# diehard_bitstream: i = %u  wscratch = ",i);
-         dumpuintbits(&wscratch, 1);
-         printf("\n");
-       }
-       w20 = wscratch & 0x0000000F ; /* Get last 4 bits of next byte */
-       MYDEBUG(D_DIEHARD_BITSTREAM) {
-         printf("# diehard_bitstream: i = %u  w20 = ",i);
-         dumpuintbits(&w20, 1);
-         printf("\n");
-       }
-       i++;
-       for(j=0;j<2;j++){          /* Get two more bytes */
-         w20 = w20 << 8;
-         w20 += cbitstream[i];  /* Shift in each byte */
-         MYDEBUG(D_DIEHARD_BITSTREAM) {
-           printf("# diehard_bitstream: i = %u  w20 = ",i);
-           dumpuintbits(&w20, 1);
-           printf("\n");
-         }
-	 i++;
-       }
-       MYDEBUG(D_DIEHARD_BITSTREAM) {
-         printf("# diehard_bitstream: w20 = ");
-         dumpuintbits(&w20, 1);
-         printf("\n");
-       }
+       printf("# diehard_bitstream: t = %u  w20 = ",t + j);
+       dumpuintbits(&w20[j], 1);
+       printf("\n");
      }
-     w[w20]++;
-
+     w[w20[j]]++;
    }
  }
 
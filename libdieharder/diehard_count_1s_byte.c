@@ -75,11 +75,6 @@
 
 #include <dieharder/libdieharder.h>
 
-/*
- * Include inline uint generator
- */
-#include "static_get_bits.c"
-
 /*
  * This table was generated using the following code fragment.
  {
@@ -155,12 +150,22 @@ const double pb[]={
  */
 #define LSHIFT5(old,new) (old*5 + new)
 
+/*
+ * Number of samples done per block.
+ */
+#define COUNT_1S_SAMPLES 4096
+
 int diehard_count_1s_byte(Test **test, int irun, random_generator_t *cur_rng)
 {
 
- uint i,j,k,index5=0,index4,letter,t;
+ uint i,j,k,letter,t,ns;
  uint boffset;
+ uint count4[625],count5[3125];
+ uint *words;
+ unsigned char *bytes,*letters;
+ unsigned short *index;
  Vtest vtest4,vtest5;
+ multihist_t *hist;
  Xtest ptest;
 
  /*
@@ -255,45 +260,56 @@ int diehard_count_1s_byte(Test **test, int irun, random_generator_t *cur_rng)
  }
 
  /*
-  * Here is the test.  We cycle boffset through test[0]->tsamples
+  * Here is the test.  Each sample takes five rands and one byte from
+  * each, at a bit offset boffset = t%32 that cycles with the sample
+  * number t (wrapping around the rand, just as get_bit_ntuple does),
+  * and spells one five letter word with them.  We do this a block of
+  * samples at a time:  pull the block's rands, pick out the bytes,
+  * classify them all with count_1s_letters(), form the (non-overlapping)
+  * words with count_1s_words() and count them in a multihist.
   */
- boffset = 0;
- for(t=0;t<test[0]->tsamples;t++){
+ words = (uint *)malloc(5*COUNT_1S_SAMPLES*sizeof(uint));
+ bytes = (unsigned char *)malloc(5*COUNT_1S_SAMPLES*sizeof(unsigned char));
+ letters = (unsigned char *)malloc(5*COUNT_1S_SAMPLES*sizeof(unsigned char));
+ index = (unsigned short *)malloc(COUNT_1S_SAMPLES*sizeof(unsigned short));
+ hist = multihist_alloc(3125);
 
-   boffset = t%32;  /* Remember that get_bit_ntuple periodic wraps the uint */
-   /*
-    * Get the next five bytes and make an index5 out of them, no
-    * overlap.
-    */
-   for(k=0;k<5;k++){
-     i = get_rand_bits_uint(32, 0xFFFFFFFF, cur_rng, 0);
-     if(verbose == D_DIEHARD_COUNT_1S_STREAM || verbose == D_ALL){
-       dumpbits(&i,32);
-     }
-     /*
-      * get next byte from the last rand we generated.
-      * Bauer fix - 
-      *   Cruft: j = get_bit_ntuple_from_uint(i,8,0x000000FF,boffset);
-      */
-     j = get_bit_ntuple_from_whole_uint(i,8,0x000000FF,boffset);
-     index5 = LSHIFT5(index5,b5b[j]);
-     if(verbose == D_DIEHARD_COUNT_1S_STREAM || verbose == D_ALL){
-       printf("b5b[%u] = %u, index5 = %u\n",j,b5b[j],index5);
-       dumpbits(&j,8);
+ for(t=0;t<test[0]->tsamples;t+=ns){
+   ns = test[0]->tsamples - t;
+   if(ns > COUNT_1S_SAMPLES) ns = COUNT_1S_SAMPLES;
+   get_rand_uint_block(words,5*ns,cur_rng);
+   for(i=0;i<ns;i++){
+     boffset = (t + i)%32;
+     for(k=0;k<5;k++){
+       j = words[5*i+k];
+       if(boffset != 0) j = (j >> boffset) | (j << (32 - boffset));
+       bytes[5*i+k] = j & 0xFF;
      }
    }
-   /*
-    * We use modulus to throw away the sixth digit in the left-shifted
-    * base 5 index value, keeping the value of the 5-digit base 5 number
-    * in the range 0 to 5^5-1 or 0 to 3124 decimal.  We repeat for the
-    * four digit index.  At this point we increment the counts for index4
-    * and index5.  Tres simple, no?
-    */
-   index5 = index5%3125;
-   index4 = index5%625;
-   vtest4.x[index4]++;
-   vtest5.x[index5]++;
+   count_1s_letters(bytes,letters,5*ns);
+   count_1s_words(letters,5,ns,index);
+   multihist_add_u16(hist,index,ns);
+   MYDEBUG(D_DIEHARD_COUNT_1S_BYTE){
+     printf("# block of %u samples, first index5 = %u, last index5 = %u\n",ns,index[0],index[ns-1]);
+   }
  }
+
+ /*
+  * The four letter words are just the last four letters of the five
+  * letter ones, so count4 is count5 folded mod 625.
+  */
+ multihist_merge(hist,count5);
+ multihist_free(hist);
+ memset(count4,0,625*sizeof(uint));
+ for(i=0;i<3125;i++) count4[i%625] += count5[i];
+ for(i=0;i<625;i++) vtest4.x[i] = count4[i];
+ for(i=0;i<3125;i++) vtest5.x[i] = count5[i];
+
+ nullfree(index);
+ nullfree(letters);
+ nullfree(bytes);
+ nullfree(words);
+
  /*
   * OK, all that is left now is to figure out the statistic.
   */
@@ -67,11 +67,6 @@
 
 #include <dieharder/libdieharder.h>
 
-/*
- * Include inline uint generator
- */
-#include "static_get_bits.c"
-
 /*
  * This table was generated using the following code fragment.
  {
@@ -145,14 +140,22 @@ const double ps[]={
 
 #define LSHIFT5(old,new) (old*5 + new)
 
+/*
+ * Number of rands pulled per block.
+ */
+#define COUNT_1S_RANDS 4096
+
 int diehard_count_1s_stream(Test **test, int irun, random_generator_t *cur_rng)
 {
 
- uint i,j,k,index5=0,index4,letter,t;
- uint boffset;
+ uint i,j,k,letter,t,nb,nw;
+ uint count4[625],count5[3125];
+ uint *words;
+ unsigned char *bytes,*letters;
+ unsigned short *index;
  Vtest vtest4,vtest5;
+ multihist_t *hist;
  Xtest ptest;
- uint overlap = 1; /* leftovers/cruft */
 
  /*
   * Count a Stream of 1's is a very complex way of generating a statistic.
@@ -255,138 +258,68 @@ int diehard_count_1s_stream(Test **test, int irun, random_generator_t *cur_rng)
  }
 
  /*
-  * Preload index with the four bytes of the first rand if overlapping
-  * only.
+  * The bytes of each rand are taken low byte first, and every byte from
+  * the fifth one on completes one overlapping 5 letter word (the first
+  * rand just preloads the first four letters).  Rather than shifting
+  * one byte at a time into index5, we pull rands a block at a time,
+  * unpack their bytes, classify the whole block into letters and form
+  * all of the block's words at once with count_1s_letters() and
+  * count_1s_words(), then count the words in a multihist.  The
+  * last four letters of each block are carried into the next one, so
+  * the words are exactly the ones the byte-at-a-time loop built.
+  * (The non-overlapping variant that used to live here was never
+  * turned on; overlap was hardwired to 1.)
   */
- if(overlap){
-   i = get_rand_bits_uint(32, 0xFFFFFFFF, cur_rng, 0);
-   MYDEBUG(D_DIEHARD_COUNT_1S_STREAM){
-     dumpbits(&i,32);
-   }
-   /* 1st byte */
-   /*
-    * Bauer fix.  I don't think he likes my getting ntuples sequentially
-    * from the stream in diehard tests, which is fair enough...;-)
-    * In the raw bit distribution tests, however, it is essential.
-    * j = get_bit_ntuple_from_uint(i,8,0x000000FF,0);
-    */
-   j = get_bit_ntuple_from_whole_uint(i,8,0x000000FF,0);
-   index5 = b5s[j];
-   if(verbose == D_DIEHARD_COUNT_1S_STREAM || verbose == D_ALL){
-     printf("b5s[%u] = %u, index5 = %u\n",j,b5s[j],index5);
-     dumpbits(&j,8);
-   }
-   /* 2nd byte */
-   /* Cruft:  See above.  j = get_bit_ntuple_from_uint(i,8,0x000000FF,8); */
-   j = get_bit_ntuple_from_whole_uint(i,8,0x000000FF,8);
-   index5 = LSHIFT5(index5,b5s[j]);
-   if(verbose == D_DIEHARD_COUNT_1S_STREAM || verbose == D_ALL){
-     printf("b5s[%u] = %u, index5 = %u\n",j,b5s[j],index5);
-     dumpbits(&j,8);
-   }
-   /* 3rd byte */
-   /* Cruft:  See above. j = get_bit_ntuple_from_uint(i,8,0x000000FF,16); */
-   j = get_bit_ntuple_from_whole_uint(i,8,0x000000FF,16);
-   index5 = LSHIFT5(index5,b5s[j]);
-   if(verbose == D_DIEHARD_COUNT_1S_STREAM || verbose == D_ALL){
-     printf("b5s[%u] = %u, index5 = %u\n",j,b5s[j],index5);
-     dumpbits(&j,8);
-   }
-   /* 4th byte */
-   /* Cruft:  See above. j = get_bit_ntuple_from_uint(i,8,0x000000FF,24); */
-   j = get_bit_ntuple_from_whole_uint(i,8,0x000000FF,24);
-   index5 = LSHIFT5(index5,b5s[j]);
-   if(verbose == D_DIEHARD_COUNT_1S_STREAM || verbose == D_ALL){
-     printf("b5s[%u] = %u, index5 = %u\n",j,b5s[j],index5);
-     dumpbits(&j,8);
-   }
- }
+ words = (uint *)malloc(COUNT_1S_RANDS*sizeof(uint));
+ bytes = (unsigned char *)malloc(4*COUNT_1S_RANDS*sizeof(unsigned char));
+ letters = (unsigned char *)malloc((4*COUNT_1S_RANDS + 4)*sizeof(unsigned char));
+ index = (unsigned short *)malloc(4*COUNT_1S_RANDS*sizeof(unsigned short));
+ hist = multihist_alloc(3125);
 
- boffset = 0;
- for(t=0;t<test[0]->tsamples;t++){
+ get_rand_uint_block(words,1,cur_rng);
+ MYDEBUG(D_DIEHARD_COUNT_1S_STREAM){
+   dumpbits(&words[0],32);
+ }
+ for(k=0;k<4;k++){
+   bytes[k] = (words[0] >> (8*k)) & 0xFF;
+ }
+ count_1s_letters(bytes,letters,4);
 
-   /*
-    * OK, we now have to do a simple modulus decision as to whether or not
-    * a new random uint is required AND to track the byte offset.  We also
-    * have to determine whether or not to use overlapping bytes.  I
-    * actually think that we may need to turn index5 into a subroutine
-    * where each successive call returns the next morphed index5,
-    * overlapping or not.
-    */
-   if(overlap){
-     /*
-      * Use overlapping bytes to generate the next index5 according to
-      * the diehard prescription (designed to work with a very small
-      * input file of rands).
-      */
-     if(boffset%32 == 0){
-       /*
-        * We need a new rand to get our next byte.
-        */
-       boffset = 0;
-       i = get_rand_bits_uint(32, 0xFFFFFFFF, cur_rng, 0);
-       if(verbose == D_DIEHARD_COUNT_1S_STREAM || verbose == D_ALL){
-         dumpbits(&i,32);
-       }
-     }
-     /*
-      * get next byte from the last rand we generated.
-      */
-     /* Cruft:  See above.  j = get_bit_ntuple_from_uint(i,8,0x000000FF,boffset); */
-     j = get_bit_ntuple_from_whole_uint(i,8,0x000000FF,boffset);
-     index5 = LSHIFT5(index5,b5s[j]);
-     /*
-      * I THINK that this basically throws away the sixth digit in the
-      * left-shifted base 5 value, keeping the value of the 5-digit base 5
-      * number in the range 0 to 5^5-1 or 0 to 3124 decimal.
-      */
-     index5 = index5%3125;
-     if(verbose == D_DIEHARD_COUNT_1S_STREAM || verbose == D_ALL){
-       printf("b5s[%u] = %u, index5 = %u\n",j,b5s[j],index5);
-       dumpbits(&j,8);
-     }
-     boffset+=8;
-   } else {
-     /*
-      * Get the next five bytes and make an index5 out of them, no
-      * overlap.
-      */
-     for(k=0;k<5;k++){
-       if(boffset%32 == 0){
-         /*
-	  * We need a new rand to get our next byte.
-	  */
-         boffset = 0;
-         i = get_rand_bits_uint(32, 0xFFFFFFFF, cur_rng, 0);
-         if(verbose == D_DIEHARD_COUNT_1S_STREAM || verbose == D_ALL){
-           dumpbits(&i,32);
-         }
-       }
-       /*
-        * get next byte from the last rand we generated.
-        */
-       /* Cruft:  See above. j = get_bit_ntuple_from_uint(i,8,0x000000FF,boffset); */
-       j = get_bit_ntuple_from_whole_uint(i,8,0x000000FF,boffset);
-       index5 = LSHIFT5(index5,b5s[j]);
-       if(verbose == D_DIEHARD_COUNT_1S_STREAM || verbose == D_ALL){
-         printf("b5s[%u] = %u, index5 = %u\n",j,b5s[j],index5);
-         dumpbits(&j,8);
-       }
-       boffset+=8;
+ for(t=0;t<test[0]->tsamples;t+=nb){
+   nb = test[0]->tsamples - t;
+   if(nb > 4*COUNT_1S_RANDS) nb = 4*COUNT_1S_RANDS;
+   nw = (nb + 3)/4;
+   get_rand_uint_block(words,nw,cur_rng);
+   for(i=0;i<nw;i++){
+     for(k=0;k<4;k++){
+       bytes[4*i+k] = (words[i] >> (8*k)) & 0xFF;
      }
    }
-   /*
-    * We use modulus to throw away the sixth digit in the left-shifted
-    * base 5 index value, keeping the value of the 5-digit base 5 number
-    * in the range 0 to 5^5-1 or 0 to 3124 decimal.  We repeat for the
-    * four digit index.  At this point we increment the counts for index4
-    * and index5.  Tres simple, no?
-    */
-   index5 = index5%3125;
-   index4 = index5%625;
-   vtest4.x[index4]++;
-   vtest5.x[index5]++;
+   count_1s_letters(bytes,letters + 4,nb);
+   count_1s_words(letters,1,nb,index);
+   multihist_add_u16(hist,index,nb);
+   MYDEBUG(D_DIEHARD_COUNT_1S_STREAM){
+     printf("# block of %u bytes, first index5 = %u, last index5 = %u\n",nb,index[0],index[nb-1]);
+   }
+   memmove(letters,letters + nb,4);
  }
+
+ /*
+  * The four letter words are just the last four letters of the five
+  * letter ones, so count4 is count5 folded mod 625.
+  */
+ multihist_merge(hist,count5);
+ multihist_free(hist);
+ memset(count4,0,625*sizeof(uint));
+ for(i=0;i<3125;i++) count4[i%625] += count5[i];
+ for(i=0;i<625;i++) vtest4.x[i] = count4[i];
+ for(i=0;i<3125;i++) vtest5.x[i] = count5[i];
+
+ nullfree(index);
+ nullfree(letters);
+ nullfree(bytes);
+ nullfree(words);
+
  /*
   * OK, all that is left now is to figure out the statistic.
   */
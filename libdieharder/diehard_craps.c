@@ -27,9 +27,23 @@
 
 #include <dieharder/libdieharder.h>
 
-uint roll(gsl_rng *rng){
-  uint d = 1 + gsl_rng_uniform_int(rng,6);
-  return d;
+/*
+ * Dice are rolled CRAPS_DICE at a time with get_rand_bounded_block(),
+ * which makes each one as 1 + floor(6*x/2^32) for a 32 bit x (just as
+ * described above, with the few x that would bias it rejected).  Any
+ * dice left over at the end of a run are thrown away.
+ */
+#define CRAPS_DICE 4096
+
+static inline uint roll(random_generator_t *cur_rng,uint *dice,uint *next)
+{
+
+ if(*next == CRAPS_DICE){
+   get_rand_bounded_block(dice,CRAPS_DICE,6,cur_rng);
+   *next = 0;
+ }
+ return 1 + dice[(*next)++];
+
 }
 
 int diehard_craps(Test **test, int irun, random_generator_t *cur_rng)
@@ -37,6 +51,7 @@ int diehard_craps(Test **test, int irun, random_generator_t *cur_rng)
 
  uint i;
  uint point,throw,tries,wins;
+ uint dice[CRAPS_DICE],next = CRAPS_DICE;
  double sum,p;
  Xtest ptest;
  Vtest vtest;
@@ -105,7 +120,8 @@ int diehard_craps(Test **test, int irun, random_generator_t *cur_rng)
     * This is the point count we have to make, the sum of two rolled
     * dice.
     */
-   point = roll(cur_rng->rng) + roll(cur_rng->rng);
+   point = roll(cur_rng,dice,&next);
+   point += roll(cur_rng,dice,&next);
    tries = 0;
 
    if(point == 7 || point == 11) {
@@ -132,7 +148,8 @@ int diehard_craps(Test **test, int irun, random_generator_t *cur_rng)
 	* then freezes it.
         */
        (tries<20)?tries++:tries;
-       throw = roll(cur_rng->rng) + roll(cur_rng->rng);
+       throw = roll(cur_rng,dice,&next);
+       throw += roll(cur_rng,dice,&next);
        if(throw == 7){
          vtest.x[tries]++;
 	 break;
@@ -44,6 +44,7 @@ int diehard_dna(Test **test, int irun, random_generator_t *cur_rng)
 
  uint i,j,k,l,m,n,o,p,q,r,t,boffset;
  uint i0,j0,k0,l0,m0,n0,o0,p0,q0,r0;
+ uint rands[10];
  Xtest ptest;
  char **********w;
 
@@ -140,31 +141,37 @@ int diehard_dna(Test **test, int irun, random_generator_t *cur_rng)
     * the tsamples loop at tsamples = 2^15...
     */
    if(t%32 == 0) {
-     i0 = gsl_rng_get(cur_rng->rng);
-     j0 = gsl_rng_get(cur_rng->rng);
-     k0 = gsl_rng_get(cur_rng->rng);
-     l0 = gsl_rng_get(cur_rng->rng);
-     m0 = gsl_rng_get(cur_rng->rng);
-     n0 = gsl_rng_get(cur_rng->rng);
-     o0 = gsl_rng_get(cur_rng->rng);
-     p0 = gsl_rng_get(cur_rng->rng);
-     q0 = gsl_rng_get(cur_rng->rng);
-     r0 = gsl_rng_get(cur_rng->rng);
+     /*
+      * Whole 32 bit uints, so that a generator with rmax_bits < 32
+      * has every one of its bits used once (the same rands as
+      * before for a 32 bit generator).
+      */
+     get_rand_uint_block(rands,10,cur_rng);
+     i0 = rands[0];
+     j0 = rands[1];
+     k0 = rands[2];
+     l0 = rands[3];
+     m0 = rands[4];
+     n0 = rands[5];
+     o0 = rands[6];
+     p0 = rands[7];
+     q0 = rands[8];
+     r0 = rands[9];
      boffset = 0;
    }
    /*
     * Get four "letters" (indices into w)
     */
-   i = get_bit_ntuple_from_uint(i0,2,mask,boffset, cur_rng->rmax_bits);
-   j = get_bit_ntuple_from_uint(j0,2,mask,boffset, cur_rng->rmax_bits);
-   k = get_bit_ntuple_from_uint(k0,2,mask,boffset, cur_rng->rmax_bits);
-   l = get_bit_ntuple_from_uint(l0,2,mask,boffset, cur_rng->rmax_bits);
-   m = get_bit_ntuple_from_uint(m0,2,mask,boffset, cur_rng->rmax_bits);
-   n = get_bit_ntuple_from_uint(n0,2,mask,boffset, cur_rng->rmax_bits);
-   o = get_bit_ntuple_from_uint(o0,2,mask,boffset, cur_rng->rmax_bits);
-   p = get_bit_ntuple_from_uint(p0,2,mask,boffset, cur_rng->rmax_bits);
-   q = get_bit_ntuple_from_uint(q0,2,mask,boffset, cur_rng->rmax_bits);
-   r = get_bit_ntuple_from_uint(r0,2,mask,boffset, cur_rng->rmax_bits);
+   i = get_bit_ntuple_from_whole_uint(i0,2,mask,boffset);
+   j = get_bit_ntuple_from_whole_uint(j0,2,mask,boffset);
+   k = get_bit_ntuple_from_whole_uint(k0,2,mask,boffset);
+   l = get_bit_ntuple_from_whole_uint(l0,2,mask,boffset);
+   m = get_bit_ntuple_from_whole_uint(m0,2,mask,boffset);
+   n = get_bit_ntuple_from_whole_uint(n0,2,mask,boffset);
+   o = get_bit_ntuple_from_whole_uint(o0,2,mask,boffset);
+   p = get_bit_ntuple_from_whole_uint(p0,2,mask,boffset);
+   q = get_bit_ntuple_from_whole_uint(q0,2,mask,boffset);
+   r = get_bit_ntuple_from_whole_uint(r0,2,mask,boffset);
    /* printf("%u:   %u  %u  %u  %u  %u\n",t,i,j,k,l,boffset); */
    w[i][j][k][l][m][n][o][p][q][r]++;
    boffset++;
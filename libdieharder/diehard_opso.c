@@ -43,6 +43,7 @@ int diehard_opso(Test **test, int irun, random_generator_t *cur_rng)
 {
 
  uint j0=0,k0=0,j,k,t;
+ uint rands[2];
  Xtest ptest;
  /*
   * Fixed test size for speed and as per diehard.
@@ -106,8 +107,13 @@ int diehard_opso(Test **test, int irun, random_generator_t *cur_rng)
     * the test[0]->tsamples loop at test[0]->tsamples = 2^15...
     */
    if(t%2 == 0) {
-     j0 = gsl_rng_get(cur_rng->rng);
-     k0 = gsl_rng_get(cur_rng->rng);
+     /*
+      * Whole uints packed from the stream, so that two letters always
+      * have 20 good bits to come from whatever rmax_bits is.
+      */
+     get_rand_uint_block(rands,2,cur_rng);
+     j0 = rands[0];
+     k0 = rands[1];
      j = j0 & 0x03ff;
      k = k0 & 0x03ff;
    } else {
@@ -38,6 +38,7 @@ int diehard_oqso(Test **test, int irun, random_generator_t *cur_rng)
 {
 
  uint i,j,k,l,i0=0,j0=0,k0=0,l0=0,t,boffset=0;
+ uint rands[4];
  Xtest ptest;
  char w[32][32][32][32];
 
@@ -83,10 +84,16 @@ int diehard_oqso(Test **test, int irun, random_generator_t *cur_rng)
   */
  for(t=0;t<test[0]->tsamples;t++){
    if(t%6 == 0) {
-     i0 = gsl_rng_get(cur_rng->rng);
-     j0 = gsl_rng_get(cur_rng->rng);
-     k0 = gsl_rng_get(cur_rng->rng);
-     l0 = gsl_rng_get(cur_rng->rng);
+     /*
+      * Six letters use 30 bits of each uint, more than a generator
+      * with rmax_bits < 32 returns per call, so we take whole uints
+      * packed from the stream rather than raw rands.
+      */
+     get_rand_uint_block(rands,4,cur_rng);
+     i0 = rands[0];
+     j0 = rands[1];
+     k0 = rands[2];
+     l0 = rands[3];
      boffset = 0;
    }
    /*
@@ -81,6 +81,7 @@ int diehard_parking_lot(Test **test, int irun, random_generator_t *cur_rng)
  Cars parked[12000];
  uint k,n,i,crashed;
  double xtry,ytry;
+ double *tries;
  Xtest ptest;
 
  /*
@@ -103,11 +104,17 @@ int diehard_parking_lot(Test **test, int irun, random_generator_t *cur_rng)
   */
  memset(parked,0,12000*sizeof(Cars));
 
+ /*
+  * All 12000 attempts need an x and a y, so generate them up front.
+  */
+ tries = (double *)malloc(2*12000*sizeof(double));
+ get_rand_uniform_block(tries,2*12000,0,cur_rng);
+
  /*
   * Park a single car to have something to avoid and count it.
   */
- parked[0].x = 100.0*gsl_rng_uniform(cur_rng->rng);
- parked[0].y = 100.0*gsl_rng_uniform(cur_rng->rng);
+ parked[0].x = 100.0*tries[0];
+ parked[0].y = 100.0*tries[1];
  k = 1;
  
 
@@ -117,8 +124,8 @@ int diehard_parking_lot(Test **test, int irun, random_generator_t *cur_rng)
   * successes.  We brute force the crash test.
   */
  for(n=1;n<12000;n++){
-   xtry = 100.0*gsl_rng_uniform(cur_rng->rng);
-   ytry = 100.0*gsl_rng_uniform(cur_rng->rng);
+   xtry = 100.0*tries[2*n];
+   ytry = 100.0*tries[2*n+1];
    crashed = 0;
    for(i=0;i<k;i++){
      /*
@@ -143,6 +150,8 @@ int diehard_parking_lot(Test **test, int irun, random_generator_t *cur_rng)
    }
  }
 
+ nullfree(tries);
+
  ptest.x = (double)k;
  Xtest_eval(&ptest);
  test[0]->st_values[irun] = ptest.x;
@@ -51,10 +51,17 @@ static double sdata[]={
 0.00001803, 0.00000982, 0.00001121
 };
 
+/*
+ * Number of uniforms generated at a time.
+ */
+#define SQUEEZE_BLOCK 4096
+
 int diehard_squeeze(Test **test, int irun, random_generator_t *cur_rng)
 {
 
  int i,j,k;
+ uint iu,nu;
+ double u[SQUEEZE_BLOCK];
  Vtest vtest;
 
  /*
@@ -94,15 +101,25 @@ int diehard_squeeze(Test **test, int irun, random_generator_t *cur_rng)
  }
 
  /*
-  * We now squeeze test[0]->tsamples times.
+  * We now squeeze test[0]->tsamples times.  The uniforms come from a
+  * block that we refill as it runs dry.  Every squeeze that is left
+  * needs at least one uniform, so asking for no more than that many
+  * never draws past the ones the test actually uses.
   */
+ nu = iu = 0;
  for(i=0;i<test[0]->tsamples;i++){
    k = 2147483647;
    j = 0;
 
    /* printf("%d:   %d\n",j,k); */
    while((k != 1) && (j < 48)){
-     k = ceil(k*gsl_rng_uniform(cur_rng->rng));
+     if(iu == nu){
+       nu = test[0]->tsamples - i;
+       if(nu > SQUEEZE_BLOCK) nu = SQUEEZE_BLOCK;
+       get_rand_uniform_block(u,nu,0,cur_rng);
+       iu = 0;
+     }
+     k = ceil(k*u[iu++]);
      j++;
      /* printf("%d:   %d\n",j,k); */
    }
@@ -176,8 +176,8 @@ int diehard_sums(Test **test, int irun, random_generator_t *cur_rng)
    printf("#==================================================================\n");
    printf("# Initializing initial y[0] and rand_list\n");
  }
+ get_rand_uniform_block(rand_list,m,0,cur_rng);
  for(t=0;t<m;t++){
-   rand_list[t] = gsl_rng_uniform(cur_rng->rng);
    y[0] += rand_list[t];
    if(verbose == D_DIEHARD_SUMS || verbose == D_ALL){
      printf("y[0] =  y[0] + %f = %f\n",rand_list[t],y[0]);
@@ -189,12 +189,17 @@ int diehard_sums(Test **test, int irun, random_generator_t *cur_rng)
    printf("# Now we generate the rest of the %u overlapping y's\n",m);
    printf("y[%u] =  %f (raw)\n",0,y[0]);
  }
+ /*
+  * x[] isn't needed until the sums are done, so it holds the m-1 new
+  * rands in the meantime.
+  */
+ get_rand_uniform_block(x,m-1,0,cur_rng);
  for(t=1;t<m;t++){
    /*
     * Each successive sum is the previous one, with its first
     * entry in rand_list[] removed.
     */
-   newrand = gsl_rng_uniform(cur_rng->rng);
+   newrand = x[t-1];
    y[t] = y[t-1] - rand_list[t-1] + newrand;
    if(verbose == D_DIEHARD_SUMS || verbose == D_ALL){
      printf("y[%u] =  %f - %f + %f = %f (raw)\n",t,y[t-1],rand_list[t-1],newrand,y[t]);
@@ -267,7 +272,8 @@ int diehard_sums(Test **test, int irun, random_generator_t *cur_rng)
  if(verbose == D_DIEHARD_SUMS || verbose == D_ALL){
    histogram(x,"pvalues",m,0.0,1.0,10,"x-values");
  }
- test[0]->pvalues[irun] = kstest(x,m);
+ /* rand_list[] is done with, so it serves as kstest()'s sort scratch. */
+ test[0]->pvalues[irun] = kstest(x,m,rand_list);
  MYDEBUG(D_DIEHARD_SUMS) {
    printf("# diehard_sums(): test[0]->pvalues[%u] = %10.5f\n",irun,test[0]->pvalues[irun]);
  }
@@ -100,6 +100,8 @@ void dieharder_rng_types()
  dh_num_dieharder_rngs++;
  ADD(gsl_rng_superkiss);
  dh_num_dieharder_rngs++;
+ ADD(gsl_rng_shm_input_raw);
+ dh_num_dieharder_rngs++;
  MYDEBUG(D_TYPES){
    printf("# startup:  Found %u dieharder rngs.\n",dh_num_dieharder_rngs);
  }
@@ -0,0 +1,290 @@
+/*
+ * See copyright in copyright.h and the accompanying file COPYING
+ */
+
+/*
+ *========================================================================
+ * Fan-out of one stream of rands to several consumers (-A).  With
+ * stdin_input_raw or a capture file every test normally eats its own
+ * slice of the stream one after another, so a -a run needs a capture
+ * as long as all of the tests put together (or rewinds it).  Here one
+ * reader thread pulls rands from the source generator into a ring of
+ * FANOUT_NBLOCKS blocks of FANOUT_BLOCK rands, and each consumer reads
+ * the whole stream from its start through its own gsl_rng, at its own
+ * pace, on its own thread.  A slot in the ring is refilled only once
+ * every consumer still running has moved past it, so the slowest
+ * consumer paces the reader and the fastest can be at most the ring's
+ * length ahead of it.
+ *
+ *   fanout_alloc()     a fan-out from source to nconsumers consumers.
+ *   fanout_consumer()  consumer i's gsl_rng, to put in its own
+ *                      random_generator_t.  Its max is the source's.
+ *   fanout_start()     starts the reader.
+ *   fanout_done()      a consumer that is finished must say so, or
+ *                      it holds up the ring forever.
+ *   fanout_free()      stops the reader and frees everything.
+ *
+ * stdin is read a block at a time, and running out of it only ends the
+ * run when a consumer actually needs a rand past the end (the reader is
+ * usually well ahead).  Other sources, including the file_input ones,
+ * are read through gsl_rng_get() as usual.
+ *========================================================================
+ */
+
+/* pthreads are POSIX, not c99 */
+#define _DEFAULT_SOURCE
+#include <dieharder/libdieharder.h>
+#include <pthread.h>
+
+#define FANOUT_BLOCK 65536
+#define FANOUT_NBLOCKS 64
+
+typedef struct {
+  fanout_t *f;
+  const unsigned int *word;     /* The block being read */
+  unsigned int pos;             /* Next rand in it */
+  unsigned int len;             /* Rands in it */
+  unsigned long long block;     /* Its number in the stream */
+  int done;
+} fanout_state_t;
+
+struct fanout {
+  gsl_rng *source;
+  gsl_rng_type type;            /* The consumers' generator type */
+  unsigned int nconsumers;
+  gsl_rng **consumer;
+  unsigned int *ring;           /* FANOUT_NBLOCKS blocks of FANOUT_BLOCK */
+  unsigned long long produced;  /* Blocks filled so far */
+  int eof;                      /* stdin ran out in block produced-1 */
+  unsigned int eof_len;         /* ...after this many rands */
+  int stop;
+  int started;
+  pthread_t reader;
+  pthread_mutex_t lock;
+  pthread_cond_t filled;        /* The reader filled a block */
+  pthread_cond_t freed;         /* A consumer moved on or finished */
+};
+
+/*
+ * The block number the consumers still running are all at or past,
+ * or produced if none are running.  Called with the lock held.
+ */
+static unsigned long long fanout_min_block(fanout_t *f)
+{
+
+ unsigned int i;
+ unsigned long long b = f->produced;
+ fanout_state_t *s;
+
+ for(i=0;i<f->nconsumers;i++){
+   s = (fanout_state_t *) f->consumer[i]->state;
+   if(!s->done && s->block < b) b = s->block;
+ }
+ return b;
+
+}
+
+static int fanout_all_done(fanout_t *f)
+{
+
+ unsigned int i;
+
+ for(i=0;i<f->nconsumers;i++){
+   if(!((fanout_state_t *) f->consumer[i]->state)->done) return 0;
+ }
+ return 1;
+
+}
+
+static void *fanout_reader(void *arg)
+{
+
+ fanout_t *f = (fanout_t *) arg;
+ unsigned int i,n,*w;
+ int from_stdin;
+
+ from_stdin = (strcmp(gsl_rng_name(f->source),"stdin_input_raw") == 0);
+ pthread_mutex_lock(&f->lock);
+ while(!f->stop){
+   if(fanout_all_done(f)) break;
+   if(f->produced - fanout_min_block(f) >= FANOUT_NBLOCKS){
+     pthread_cond_wait(&f->freed,&f->lock);
+     continue;
+   }
+   w = f->ring + (size_t)(f->produced % FANOUT_NBLOCKS)*FANOUT_BLOCK;
+   pthread_mutex_unlock(&f->lock);
+
+   /*
+    * No consumer is in this slot, so it is ours until we say it is
+    * filled.
+    */
+   if(from_stdin){
+     n = fread(w,sizeof(unsigned int),FANOUT_BLOCK,stdin);
+   } else {
+     for(i=0;i<FANOUT_BLOCK;i++) w[i] = gsl_rng_get(f->source);
+     n = FANOUT_BLOCK;
+   }
+
+   pthread_mutex_lock(&f->lock);
+   f->produced++;
+   if(n < FANOUT_BLOCK){
+     f->eof = 1;
+     f->eof_len = n;
+   }
+   pthread_cond_broadcast(&f->filled);
+   if(f->eof) break;
+ }
+ pthread_mutex_unlock(&f->lock);
+ return NULL;
+
+}
+
+/*
+ * Move consumer s on to its next block, waiting for the reader if it
+ * has to.
+ */
+static void fanout_next_block(fanout_state_t *s)
+{
+
+ fanout_t *f = s->f;
+
+ pthread_mutex_lock(&f->lock);
+ if(s->word != NULL){
+   s->block++;
+   pthread_cond_broadcast(&f->freed);
+ }
+ while(s->block >= f->produced && !f->eof){
+   pthread_cond_wait(&f->filled,&f->lock);
+ }
+ if(s->block >= f->produced || (f->eof && s->block == f->produced - 1 && f->eof_len == 0)){
+   pthread_mutex_unlock(&f->lock);
+   fprintf(stderr,"# stdin_input_raw(): Error: EOF\n");
+   exit(0);
+ }
+ s->word = f->ring + (size_t)(s->block % FANOUT_NBLOCKS)*FANOUT_BLOCK;
+ s->len = (f->eof && s->block == f->produced - 1) ? f->eof_len : FANOUT_BLOCK;
+ s->pos = 0;
+ pthread_mutex_unlock(&f->lock);
+
+}
+
+static unsigned long int fanout_get(void *vstate)
+{
+
+ fanout_state_t *s = (fanout_state_t *) vstate;
+
+ if(s->pos == s->len) fanout_next_block(s);
+ return s->word[s->pos++];
+
+}
+
+static double fanout_get_double(void *vstate)
+{
+
+ fanout_state_t *s = (fanout_state_t *) vstate;
+
+ return fanout_get(vstate)/((double) s->f->type.max + 1.0);
+
+}
+
+static void fanout_set(void *vstate,unsigned long int seed)
+{
+
+ /* A stream can't be reseeded (or rewound) */
+
+}
+
+fanout_t *fanout_alloc(gsl_rng *source,unsigned int nconsumers)
+{
+
+ unsigned int i;
+ fanout_t *f;
+ fanout_state_t *s;
+
+ f = (fanout_t *)malloc(sizeof(fanout_t));
+ f->source = source;
+ f->type.name = "fanout";
+ f->type.max = gsl_rng_max(source);
+ f->type.min = gsl_rng_min(source);
+ f->type.size = sizeof(fanout_state_t);
+ f->type.set = fanout_set;
+ f->type.get = fanout_get;
+ f->type.get_double = fanout_get_double;
+ f->nconsumers = nconsumers;
+ f->ring = (unsigned int *)malloc((size_t)FANOUT_NBLOCKS*FANOUT_BLOCK*sizeof(unsigned int));
+ f->produced = 0;
+ f->eof = 0;
+ f->eof_len = 0;
+ f->stop = 0;
+ f->started = 0;
+ pthread_mutex_init(&f->lock,NULL);
+ pthread_cond_init(&f->filled,NULL);
+ pthread_cond_init(&f->freed,NULL);
+
+ f->consumer = (gsl_rng **)malloc((size_t)nconsumers*sizeof(gsl_rng *));
+ for(i=0;i<nconsumers;i++){
+   f->consumer[i] = gsl_rng_alloc(&f->type);
+   s = (fanout_state_t *) f->consumer[i]->state;
+   s->f = f;
+   s->word = NULL;
+   s->pos = s->len = 0;
+   s->block = 0;
+   s->done = 0;
+ }
+
+ MYDEBUG(D_STD_TEST){
+   printf("# fanout_alloc(): %u consumers of %s, ring of %u x %u rands\n",
+          nconsumers,gsl_rng_name(source),FANOUT_NBLOCKS,FANOUT_BLOCK);
+ }
+ return f;
+
+}
+
+gsl_rng *fanout_consumer(fanout_t *f,unsigned int i)
+{
+
+ return f->consumer[i];
+
+}
+
+int fanout_start(fanout_t *f)
+{
+
+ if(pthread_create(&f->reader,NULL,fanout_reader,f) != 0) return -1;
+ f->started = 1;
+ return 0;
+
+}
+
+void fanout_done(fanout_t *f,unsigned int i)
+{
+
+ pthread_mutex_lock(&f->lock);
+ ((fanout_state_t *) f->consumer[i]->state)->done = 1;
+ pthread_cond_broadcast(&f->freed);
+ pthread_mutex_unlock(&f->lock);
+
+}
+
+void fanout_free(fanout_t *f)
+{
+
+ unsigned int i;
+
+ if(f == NULL) return;
+ if(f->started){
+   pthread_mutex_lock(&f->lock);
+   f->stop = 1;
+   pthread_cond_broadcast(&f->freed);
+   pthread_mutex_unlock(&f->lock);
+   pthread_join(f->reader,NULL);
+ }
+ for(i=0;i<f->nconsumers;i++) gsl_rng_free(f->consumer[i]);
+ nullfree(f->consumer);
+ nullfree(f->ring);
+ pthread_mutex_destroy(&f->lock);
+ pthread_cond_destroy(&f->filled);
+ pthread_cond_destroy(&f->freed);
+ free(f);
+
+}
@@ -0,0 +1,186 @@
+/*
+ * See copyright in copyright.h and the accompanying file COPYING
+ */
+
+/*
+ *========================================================================
+ * Several goodness of fit tests for uniformity on [0,1) at once.
+ * dieharder's final p-value for a test is the KS (or, with -k 3, the
+ * Kuiper KS) p-value of its psamples p-values, and a borderline result
+ * used to mean running the whole test again with the other -k to see
+ * what it thought.  Once the p-values are sorted, though, all of
+ *
+ *   GOF_KS      Kolmogorov-Smirnov, exactly as kstest() does it
+ *   GOF_KUIPER  Kuiper, exactly as kstest_kuiper() does it
+ *   GOF_AD      Anderson-Darling, which weights the tails
+ *   GOF_CVM     Cramer-von Mises, which weights the middle
+ *
+ * come out of one pass over them, so std_test() saves all four in
+ * test->gof_pvalues[] and -D gof shows them in the output table.
+ *========================================================================
+ */
+
+#include <dieharder/libdieharder.h>
+#include <float.h>
+
+/*
+ * The Anderson-Darling distribution, from "Evaluating the
+ * Anderson-Darling Distribution" by G. and J. Marsaglia (J. Stat.
+ * Software 9, 2004):  the limiting CDF, good to about 2e-6, plus a
+ * correction for finite n that makes it good to about the same for
+ * n >= 5 or so.
+ */
+static double ad_inf(double z)
+{
+
+ if(z < 2.0){
+   return exp(-1.2337141/z)/sqrt(z)*(2.00012+(.247105-(.0649821-(.0347962-
+          (.011672-.00168691*z)*z)*z)*z)*z);
+ }
+ return exp(-exp(1.0776-(2.30695-(.43424-(.082433-(.008056-.0003146*z)*z)*z)*z)*z));
+
+}
+
+static double ad_errfix(int n,double x)
+{
+
+ double c,t;
+
+ if(x > .8){
+   return (-130.2137+(745.2337-(1705.091-(1950.646-(1116.360-255.7844*x)*x)*x)*x)*x)/n;
+ }
+ c = .01265 + .1757/n;
+ if(x < c){
+   t = x/c;
+   t = sqrt(t)*(1. - t)*(49*t - 102);
+   return t*(.0037/(n*n) + .00078/n + .00006)/n;
+ }
+ t = (x - c)/(.8 - c);
+ t = -.00022633+(6.54034-(14.6538-(14.458-(8.259-1.91864*t)*t)*t)*t)*t;
+ return t*(.04213 + .01365/n)/n;
+
+}
+
+double ad_pvalue(int n,double a2)
+{
+
+ double x;
+
+ if(a2 <= 0.0) return 1.0;
+ x = ad_inf(a2);
+ x += ad_errfix(n,x);
+ if(x > 1.0) x = 1.0;
+ if(x < 0.0) x = 0.0;
+ return 1.0 - x;
+
+}
+
+/*
+ * The Cramer-von Mises distribution.  W^2 is first corrected for finite
+ * n with Stephens' modification, (W^2 - 0.4/n + 0.6/n^2)(1 + 1/n), and
+ * then looked up in the limiting CDF of Anderson and Darling (1952):
+ *
+ *   F(z) = 1/(pi sqrt(z)) sum_j c_j sqrt(4j+1) exp(-y_j) K_1/4(y_j)
+ *
+ * with y_j = (4j+1)^2/(16z) and c_j = Gamma(j+1/2)/(Gamma(1/2) j!).
+ */
+double cvm_pvalue(int n,double w2)
+{
+
+ int j;
+ double z,y,c,term,sum;
+
+ z = (w2 - 0.4/n + 0.6/((double)n*n))*(1.0 + 1.0/n);
+ if(z <= 0.0) return 1.0;
+ sum = 0.0;
+ c = 1.0;
+ for(j=0;j<200;j++){
+   y = (4.0*j + 1.0)*(4.0*j + 1.0)/(16.0*z);
+   if(y > 700.0) break;
+   term = c*sqrt(4.0*j + 1.0)*exp(-2.0*y)*gsl_sf_bessel_Knu_scaled(0.25,y);
+   sum += term;
+   if(term < 1.0e-16*sum) break;
+   c *= (2.0*j + 1.0)/(2.0*j + 2.0);
+ }
+ sum /= M_PI*sqrt(z);
+ if(sum > 1.0) sum = 1.0;
+ return 1.0 - sum;
+
+}
+
+/*
+ * gof[GOF_KS..GOF_CVM] for count pvalues that are already sorted.
+ * The KS and Kuiper p-values are exactly what kstest_sorted() and
+ * kstest_kuiper_sorted() would return.
+ */
+void gof_sorted(double *pvalue,int count,double *gof)
+{
+
+ int i;
+ double u,y,d1,dmax,v,vmax,vmin,a2,w2;
+ double lo,hi;
+
+ if(count < 1){
+   for(i=0;i<GOF_N;i++) gof[i] = -1.0;
+   return;
+ }
+ if(count == 1){
+   for(i=0;i<GOF_N;i++) gof[i] = pvalue[0];
+   return;
+ }
+
+ /*
+  * p-values of exactly 0 or 1 would make the AD sum infinite; they are
+  * clamped to within rounding of the ends, which fails it anyway.
+  */
+ lo = DBL_EPSILON/2.0;
+ hi = 1.0 - DBL_EPSILON/2.0;
+ dmax = 0.0;
+ vmax = 0.0;
+ vmin = 0.0;
+ a2 = 0.0;
+ w2 = 1.0/(12.0*count);
+ for(i=0;i<count;i++){
+   u = pvalue[i];
+
+   /* KS, with kstest()'s (i+1)/(count+1) */
+   y = (double) (i+1)/(count+1.0);
+   d1 = fabs(u - y);
+   if(d1 > dmax) dmax = d1;
+
+   /* Kuiper, with kstest_kuiper()'s i/count */
+   y = (double) i/count;
+   v = u - y;
+   if(v > vmax) {
+     vmax = v;
+   } else if(v < vmin) {
+     vmin = v;
+   }
+
+   /* Anderson-Darling, pairing the i-th smallest with the i-th largest */
+   y = pvalue[count-1-i];
+   if(u < lo) u = lo;
+   if(u > hi) u = hi;
+   if(y < lo) y = lo;
+   if(y > hi) y = hi;
+   a2 += (2.0*i + 1.0)*(log(u) + log1p(-y));
+
+   /* Cramer-von Mises */
+   y = pvalue[i] - (2.0*i + 1.0)/(2.0*count);
+   w2 += y*y;
+ }
+ a2 = -count - a2/count;
+
+ gof[GOF_KS] = kstest_dmax_pvalue(count,dmax);
+ gof[GOF_KUIPER] = kstest_kuiper_v_pvalue(count,fabs(vmax) + fabs(vmin));
+ gof[GOF_AD] = ad_pvalue(count,a2);
+ gof[GOF_CVM] = cvm_pvalue(count,w2);
+
+ MYDEBUG(D_KSTEST){
+   printf("# gof_sorted(): count = %d  D = %f  V = %f  A^2 = %f  W^2 = %f\n",
+          count,dmax,fabs(vmax) + fabs(vmin),a2,w2);
+   printf("# gof_sorted(): p = %10.8f (KS) %10.8f (Kuiper) %10.8f (AD) %10.8f (CvM)\n",
+          gof[GOF_KS],gof[GOF_KUIPER],gof[GOF_AD],gof[GOF_CVM]);
+ }
+
+}
@@ -18,9 +18,10 @@
 #include <dieharder/libdieharder.h>
 #define KCOUNTMAX 4999
 /* Threshold: whether to use precise or asymptotic
- * version of two sample method
+ * version of two sample method, in (roughly) steps of
+ * the exact method's DP
  */
-#define K2COUNTMAX 10000
+#define K2COSTMAX 10000000
 #define M_1_SQRT_2PI 0.398942280401432677939946059934
 
 double p_ks_new(int n,double d);
@@ -81,11 +82,20 @@ double pkstwo(double x)
 	return x;
 }
 
-/* Two-sided two-sample */
-double psmirnov2x(double x, int m, int n)
+/*
+ * Two-sided two-sample, P(D < x).  u is the DP row and must hold
+ * max(m,n)+1 doubles.
+ *
+ * Only the u[j] with |i/m - j/n| <= q can be nonzero, a band about the
+ * diagonal that moves right as i grows, so row i only has to visit
+ * j = jlo..jhi:  O(m n q) instead of O(m n).  Everything left of the
+ * band is dead for good, and everything right of it is still the zero
+ * it was set to in the first row.
+ */
+static double psmirnov2x_band(double x, int m, int n, double *u)
 {
-    double md, nd, q, *u, w;
-    int i, j;
+    double md, nd, q, w, left;
+    int i, j, jlo, jhi;
 
     if(m > n) {
 	i = n; n = m; m = i;
@@ -98,72 +108,164 @@ double psmirnov2x(double x, int m, int n)
 
     */
     q = (0.5 + floor(x * md * nd - 1e-7)) / (md * nd);
-    u = (double *) malloc((n + 1) * sizeof(double));
 
+    jhi = -1;
     for(j = 0; j <= n; j++) {
 	u[j] = ((j / nd) > q) ? 0 : 1;
+	if(u[j] != 0) jhi = j;
     }
+    jlo = 0;
     for(i = 1; i <= m; i++) {
 	w = (double)(i) / ((double)(i + n));
-	if((i / md) > q)
-	    u[0] = 0;
-	else
-	    u[0] = w * u[0];
-	for(j = 1; j <= n; j++) {
-	    if(fabs(i / md - j / nd) > q)
-		u[j] = 0;
-	    else
-		u[j] = w * u[j] + u[j - 1];
+	while(jlo <= n && fabs(i / md - jlo / nd) > q && jlo / nd < i / md)
+	    jlo++;
+	/* An empty band zeroes this row and so every row after it. */
+	if(jlo > n || fabs(i / md - jlo / nd) > q)
+	    return 0.0;
+	if(jhi < jlo)
+	    jhi = jlo;
+	while(jhi < n && !(fabs(i / md - (jhi + 1) / nd) > q))
+	    jhi++;
+	left = 0;
+	for(j = jlo; j <= jhi; j++) {
+	    u[j] = w * u[j] + left;
+	    left = u[j];
 	}
     }
-    double result = u[n];
+    return u[n];
+}
+
+/* Two-sided two-sample */
+double psmirnov2x(double x, int m, int n)
+{
+    double *u, result;
+
+    u = (double *) malloc(((m > n ? m : n) + 1) * sizeof(double));
+    result = psmirnov2x_band(x, m, n, u);
     free(u);
     return (result);
 }
 
-double two_sample_kstest(double *value, double *ref_value, int m, int n){
+/*
+ * Sorts value[] and ref_value[] in place.  scratch holds max(m,n)+1
+ * doubles, for the sorts and then the exact distribution, or is NULL to
+ * have them allocated.
+ */
+double two_sample_kstest(double *value, double *ref_value, int m, int n, double *scratch){
+	if (m < 1)
+		return -1;
+	radix_sort_double(value,m,scratch);
+	radix_sort_double(ref_value,n,scratch);
+	return two_sample_kstest_sorted(value, ref_value, m, n, scratch);
+}
+
+/*
+ * two_sample_kstest() on value[] and ref_value[] that are already
+ * sorted, which it leaves alone.  work holds max(m,n)+1 doubles for the
+ * exact distribution, or is NULL to have one allocated.
+ */
+double two_sample_kstest_sorted(const double *value, const double *ref_value, int m, int n, double *work){
+	int r, pos = 0;
+	double max_diff = 0, d_1, d_2, cost, p;
+	double *mine = NULL;
+
 	if (m < 1)
 		return -1;
-	gsl_sort(value,1,m);
-	gsl_sort(ref_value,1,n);
-	int r = 0;
-	int pos = 0;
-	double cur_val = 0;
-	double max_diff = 0;
-	for (int r = 0; r < m; r++) {
-		while (value[r] > ref_value[pos] && pos < n)
+	for (r = 0; r < m; r++) {
+		while (pos < n && value[r] > ref_value[pos])
 			pos++;
-		double d_1 = fabs((r + 1.0) / m - (pos + ((ref_value[pos] - value[r] < 1e-10)? 1.0 : 0.0)) / n);
+		d_1 = fabs((r + 1.0) / m - (pos + ((pos < n && ref_value[pos] - value[r] < 1e-10)? 1.0 : 0.0)) / n);
 		if (max_diff < d_1)
 			max_diff = d_1;
-		double d_2 = fabs((double)pos / n - (double)r / m);
+		d_2 = fabs((double)pos / n - (double)r / m);
 	    if (max_diff < d_2)
 		    max_diff = d_2;
 	}
 
-	long int max = n * m;
-    if (max < K2COUNTMAX)
-    	return 1 - psmirnov2x(max_diff, m, n);
+	/* Roughly the work psmirnov2x_band() will do. */
+	cost = (double)(m < n ? m : n) * (2.0 * max_diff * (m > n ? m : n) + 2.0);
+	if (cost < K2COSTMAX) {
+		if (work == NULL)
+			work = mine = (double *) malloc(((m > n ? m : n) + 1) * sizeof(double));
+		p = 1 - psmirnov2x_band(max_diff, m, n, work);
+		nullfree(mine);
+		return p;
+	}
 
-    double Klm = sqrt((double)max / (n + m)) * max_diff;
-    return (1 - pkstwo(Klm));
+	double Klm = sqrt((double)m * n / (n + m)) * max_diff;
+	return (1 - pkstwo(Klm));
 }
 
-double kstest(double *pvalue,int count)
+/*
+ * pvalue[0..nsorted) is already in order, pvalue[nsorted..count) has
+ * just been added.  Sort the new ones and merge them in, so that all of
+ * pvalue[] is in order.  This is how std_test() keeps its pvalues
+ * sorted as TTD/RA modes add Xstep at a time:  the cost is that of
+ * sorting the new batch plus one linear merge, where sorting the whole
+ * vector again would get slower and slower as it grows toward Xoff.
+ * The merge works back from the end, so the only extra space is a copy
+ * of the new batch, in scratch (count - nsorted doubles) if it isn't
+ * NULL.
+ */
+void pvalue_merge(double *pvalue,unsigned int nsorted,unsigned int count,double *scratch)
 {
 
- int i;
- double y,d,d1,d2,dmax,csqrt;
- double p,x;
+ unsigned int m,i,j,k;
+ double *batch,*mine = NULL;
+
+ if(nsorted >= count) return;
+ m = count - nsorted;
+ radix_sort_double(pvalue + nsorted,m,scratch);
+ if(nsorted == 0 || pvalue[nsorted-1] <= pvalue[nsorted]) return;
+
+ if(scratch == NULL) scratch = mine = (double *)malloc((size_t)m*sizeof(double));
+ batch = scratch;
+ memcpy(batch,pvalue + nsorted,(size_t)m*sizeof(double));
+ i = nsorted;
+ j = m;
+ k = count;
+ while(j > 0){
+   if(i > 0 && pvalue[i-1] > batch[j-1]){
+     pvalue[--k] = pvalue[--i];
+   } else {
+     pvalue[--k] = batch[--j];
+   }
+ }
+ nullfree(mine);
+
+}
+
+/*
+ * Sorts pvalue[] in place.  scratch holds count doubles for the sort,
+ * or is NULL to have them allocated.  Tests that call this every run
+ * should pass their own.
+ */
+double kstest(double *pvalue,int count,double *scratch)
+{
 
  /* First, handle degenerate cases. */
  if (count < 1) return -1.0;
  if (count == 1) return *pvalue;
 
  /*
-  * We start by sorting the list of pvalues.
+  * We start by sorting the list of pvalues (see radix_sort.c).
   */
- gsl_sort(pvalue,1,count);
+ radix_sort_double(pvalue,count,scratch);
+ return(kstest_sorted(pvalue,count));
+
+}
+
+/*
+ * kstest() on a vector of pvalues that is already sorted.
+ */
+double kstest_sorted(double *pvalue,int count)
+{
+
+ int i;
+ double y,d,d1,d2,dmax;
+
+ if (count < 1) return -1.0;
+ if (count == 1) return *pvalue;
 
  /*
   * Here's the test.  For each (sorted) pvalue, its index is the
@@ -206,36 +308,47 @@ double kstest(double *pvalue,int count)
 
  }
 
+ return(kstest_dmax_pvalue(count,dmax));
+
+}
+
+/*
+ * Turn the KS distance dmax over count pvalues into a p-value.
+ */
+double kstest_dmax_pvalue(int count,double dmax)
+{
+
+ double csqrt,p,x;
+
  /*
   * Here's where we have to make a few choices:
   *
   * ks_test = 0
-  * Use the new algorithm when count is less than KCOUNTMAX, but
-  * for large values of the count use the old q_ks(), valid for
-  * asymptotically large counts and MUCH faster.  This will
-  * will introduce a SMALL error in the distribution of pvalues
-  * for all of the tests together, but it will be negligible for
-  * any given single test.
+  * Use the exact distribution (p_ks_new()) when count is at most
+  * KCOUNTMAX, but for larger counts use the old q_ks(), valid for
+  * asymptotically large counts and cheaper still.  This introduces
+  * a SMALL error in the distribution of pvalues for all of the tests
+  * together, but it is negligible for any given single test.
   *
   * ks_test = 1
-  * Use the new (mostly exact) algorithm exactly as is.  This is
-  * QUITE SLOW although it is "sped up" at the expense of some
-  * precision.  By slow I mean 220 seconds at -k 1, 2.5 seconds at
-  * (default) -k 0.
+  * Always use p_ks_new(), which picks its method by count and
+  * w = count*dmax^2 as described above it.  That is now cheap for
+  * any count dieharder uses.
   *
   * ks_test = 2
-  * Use the exact (7 digit accurate) version of the new code, but
-  * be prepared for "long" runtimes.  Empirically I only got 230
-  * seconds -- not enough to worry about, really.
-  * 
+  * As 1, but for 140 < count <= KS_NKOLMO it keeps to Durbin's
+  * matrix method even where that is large and Pelz-Good's series
+  * would otherwise be used, for full precision at some cost in time.
+  * For count <= 140 the method still depends on w (Durbin below
+  * 0.754693, Pomeranz above), and the far tails use the closed
+  * forms, exactly as for ks_test = 1.
+  *
   */
 
  /*
-  * We only need this test here (and can adjust KCOUNTMAX to play
-  * with accuracy vs speed, although I've verified that 5000 isn't
-  * terrible).  The ks_test = 1 or 2 option are fallthrough, with
-  * 1 being "normal", 2 omitting the speedup step below to get FULL
-  * precision.
+  * We only need this test here (KCOUNTMAX trades accuracy for speed,
+  * and 5000 isn't terrible).  ks_test = 1 and 2 fall through to
+  * p_ks_new(), which looks at ks_test itself.
   */
  if(ks_test == 0 && count > KCOUNTMAX){
    csqrt = sqrt(count);
@@ -295,172 +408,499 @@ double q_ks(double x)
 
 /*
  *========================================================================
- * The following routines are from the paper "Evaluating Kolmogorov's
- * Distribution" by Marsaglia, Tsang and Wang.  They should permit kstest
- * to return precise pvalues for more or less arbitrary numbers of samples
- * ranging from n = 10 out to n approaching the asymptotic form where
- * Kolmogorov's original result is valid.  It contains some cutoffs
- * intended to prevent excessive runtimes in the rare cases where p being
- * returned is close to 1 and n is large (at which point the asymptotic
- * form is generally adequate anyway).
+ * The exact Kolmogorov distribution, P(D_n >= d), evaluated the way
+ * Simard and L'Ecuyer do in "Computing the Two-Sided Kolmogorov-Smirnov
+ * Distribution" (J. Stat. Software 39, 2011).  No one method is both
+ * fast and accurate everywhere, so we pick one by n and w = n d^2:
+ *
+ *   - a few special cases that are known in closed form;
+ *   - the upper tail (w >= 4 for n <= 140, w >= 2.65 above that) is
+ *     twice Smirnov's exact one-sided tail, which is accurate to many
+ *     more than 7 digits *relative* to the (tiny) p-value;
+ *   - otherwise, for n <= 140, Durbin's matrix method for w < 0.754693
+ *     and Pomeranz's recursion above that;
+ *   - otherwise Durbin's matrix method while n <= 1000 or n d^(3/2) is
+ *     small enough to keep the matrix small, and the Pelz-Good
+ *     asymptotic series beyond that (with ks_test = 2, Durbin up to
+ *     n = KS_NKOLMO however big the matrix).
+ *     Simard and L'Ecuyer switch to Pelz-Good at n = 140, but it is
+ *     only good to about 1e-6 there; by n = 1000 it is better than
+ *     1e-7, and below that the matrix is small anyway.
  *
- * This is so far a first pass -- I'm guessing that we can improve the
- * linear algebra using the GSL or otherwise.  The code is therefore
- * more or less straight from the paper.
+ * Durbin's method is the one Marsaglia, Tsang and Wang ("Evaluating
+ * Kolmogorov's Distribution") made practical, raising a (2k-1)x(2k-1)
+ * matrix to the n-th power, and it used to be all we had.  It is now
+ * only ever handed small matrices, does its powers by repeated squaring
+ * in one workspace, and multiplies in blocks that skip the zeros above
+ * the matrix's first superdiagonal.
  *========================================================================
  */
+#define KS_NEXACT 140
+#define KS_NDURBIN 1000
+#define KS_NKOLMO 100000
+#define KS_BLOCK 64
+
+/*
+ * n!/n^n, for the closed forms.
+ */
+static double ks_rapfac(int n)
+{
+
+ int i;
+ double r = 1.0;
+
+ for(i=1;i<=n;i++) r *= (double)i/n;
+ return r;
+
+}
+
+/*
+ * C = A B for m x m matrices, blocked on the inner index so a panel of
+ * B stays in cache while we sweep over the rows of A.
+ */
 void mMultiply(double *A,double *B,double *C,int m)
 {
-  int i,j,k;
-  double s;
-  for(i=0; i<m; i++){
-    for(j=0; j<m; j++){
-      s=0.0;
-      for(k=0; k<m; k++){
-        s+=A[i*m+k]*B[k*m+j];
-	C[i*m+j]=s;
-      }
-    }
-  }
+
+ int i,j,k,kk,kmax;
+ double a,*b,*c;
+
+ memset(C,0,(size_t)m*m*sizeof(double));
+ for(kk=0;kk<m;kk+=KS_BLOCK){
+   kmax = (kk + KS_BLOCK < m) ? kk + KS_BLOCK : m;
+   for(i=0;i<m;i++){
+     c = C + i*m;
+     for(k=kk;k<kmax;k++){
+       a = A[i*m+k];
+       if(a == 0.0) continue;
+       b = B + k*m;
+       for(j=0;j<m;j++) c[j] += a*b[j];
+     }
+   }
+ }
+
 }
 
-void mPower(double *A,int eA,double *V,int *eV,int m,int n)
+/*
+ * Rescale as needed to avoid overflow.  We check EVERY element of V to
+ * make sure NONE of them exceed the threshold (and if any do, rescale
+ * the whole thing).
+ */
+static void mRescale(double *V,int *eV,int m)
 {
-  double *B;
-  int eB,i,j;
-
-  /*
-   * n == 1: first power just returns A.
-   */
-  if(n == 1){
-    for(i=0;i<m*m;i++){
-      V[i]=A[i];*eV=eA;
-    }
-    return;
-  }
-
-  /*
-   * This is a recursive call.  Either n/2 will equal 1 (and the line
-   * above will return and the recursion will terminate) or it won't
-   * and we will cumulate the product.
-   */
-  mPower(A,eA,V,eV,m,n/2);
-  /* printf("n = %d  mP eV = %d\n",n/2,*eV); */
-  B=(double*)malloc((m*m)*sizeof(double));
-  mMultiply(V,V,B,m);
-  eB=2*(*eV);
-  if(n%2==0){
-    for(i=0;i<m*m;i++){
-      V[i]=B[i];
-    }
-    *eV=eB;
-    /* printf("n = %d (even) eV = %d\n",n,*eV); */
-  } else {
-    mMultiply(A,B,V,m);
-    *eV=eA+eB;
-    /* printf("n = %d (odd) eV = %d\n",n,*eV); */
-  }
-
-  /*
-   * Rescale as needed to avoid overflow.  Note that we check
-   * EVERY element of V to make sure NONE of them exceed the
-   * threshold (and if any do, rescale the whole thing).
-   */
-  for(i=0;i<m*m;i++) {
-    if( V[i] > 1.0e140 ) {
-      for(j=0;j<m*m;j++) {
-        V[j]=V[j]*1.0e-140;
-      }
-      *eV+=140;
-      /* printf("rescale eV = %d\n",*eV); */
-    }
-  }
 
-  free(B);
+ int i;
+
+ for(i=0;i<m*m;i++){
+   if(V[i] > 1.0e140){
+     for(i=0;i<m*m;i++) V[i] *= 1.0e-140;
+     *eV += 140;
+     return;
+   }
+ }
+
+}
+
+/*
+ * V = A^n (times 10^eV), by repeated squaring.  work must hold 2 m^2
+ * doubles, and A is used as scratch.
+ */
+void mPower(double *A,double *V,int *eV,int m,int n,double *work)
+{
+
+ int i,eA = 0,first = 1;
+ double *T = work,*P = work + m*m,*swap;
+
+ *eV = 0;
+ memcpy(P,A,(size_t)m*m*sizeof(double));
+ while(1){
+   if(n & 1){
+     if(first){
+       memcpy(V,P,(size_t)m*m*sizeof(double));
+       *eV = eA;
+       first = 0;
+     } else {
+       mMultiply(V,P,T,m);
+       for(i=0;i<m*m;i++) V[i] = T[i];
+       *eV += eA;
+       mRescale(V,eV,m);
+     }
+   }
+   n >>= 1;
+   if(n == 0) break;
+   mMultiply(P,P,A,m);
+   swap = P; P = A; A = swap;
+   eA *= 2;
+   mRescale(P,&eA,m);
+ }
+
+}
+
+/*
+ * Durbin's matrix method for the CDF, P(D_n < d).
+ */
+static double ks_durbin(int n,double d)
+{
+
+ int k,m,i,j,eQ;
+ double h,s,f,*H,*Q,*work;
+
+ k = (int)(n*d) + 1;
+ m = 2*k - 1;
+ h = k - n*d;
+ H = (double *)calloc((size_t)4*m*m,sizeof(double));
+ Q = H + m*m;
+ work = Q + m*m;
+
+ for(i=0;i<m;i++){
+   for(j=0;j<m;j++){
+     H[i*m+j] = (i - j + 1 < 0) ? 0.0 : 1.0;
+   }
+ }
+ for(i=0;i<m;i++){
+   H[i*m] -= pow(h,i+1);
+   H[(m-1)*m+i] -= pow(h,(m-i));
+ }
+ H[(m-1)*m] += (2*h - 1 > 0 ? pow(2*h - 1,m) : 0);
+ for(i=0;i<m;i++){
+   f = 1.0;
+   for(j=i;j>=0;j--){
+     f *= i - j + 1;
+     H[i*m+j] /= f;
+   }
+ }
+
+ mPower(H,Q,&eQ,m,n,work);
+ s = Q[(k-1)*m+k-1];
+ for(i=1;i<=n;i++){
+   s = s*i/n;
+   if(s < 1e-140){
+     s *= 1e140;
+     eQ -= 140;
+   }
+ }
+ s *= pow(10.,eQ);
+ free(H);
+ return s;
+
+}
+
+/*
+ * Pomeranz's recursion for the CDF, for n <= KS_NEXACT.  A[] are the
+ * break points of the recursion, and Atflo[]/Atcei[] the floors and
+ * ceilings of A[] -/+ t that bound each step.
+ */
+static void ks_pomeranz_bounds(int n,double t,double *A,double *Atflo,double *Atcei)
+{
+
+ int i,ell = (int)t;
+ double z = t - ell,w = ceil(t) - t;
+
+ if(z > 0.5){
+   for(i=2;i<=2*n+2;i+=2) Atflo[i] = i/2 - 2 - ell;
+   for(i=1;i<=2*n+2;i+=2) Atflo[i] = i/2 - 1 - ell;
+   for(i=2;i<=2*n+2;i+=2) Atcei[i] = i/2 + ell;
+   for(i=1;i<=2*n+2;i+=2) Atcei[i] = i/2 + 1 + ell;
+ } else if(z > 0.0){
+   for(i=1;i<=2*n+2;i++) Atflo[i] = i/2 - 1 - ell;
+   for(i=2;i<=2*n+2;i++) Atcei[i] = i/2 + ell;
+   Atcei[1] = 1 + ell;
+ } else {
+   for(i=2;i<=2*n+2;i+=2) Atflo[i] = i/2 - 1 - ell;
+   for(i=1;i<=2*n+2;i+=2) Atflo[i] = i/2 - ell;
+   for(i=2;i<=2*n+2;i+=2) Atcei[i] = i/2 - 1 + ell;
+   for(i=1;i<=2*n+2;i+=2) Atcei[i] = i/2 + ell;
+ }
+ if(w < z) z = w;
+ A[0] = A[1] = 0;
+ A[2] = z;
+ A[3] = 1 - A[2];
+ for(i=4;i<=2*n+1;i++) A[i] = A[i-2] + 1;
+ A[2*n+2] = n;
+
+}
+
+static double ks_pomeranz(int n,double d)
+{
+
+ const int eno = 350;
+ const double reno = ldexp(1.0,eno);
+ int i,j,k,s,r1,r2,jlow,jup,klow,kup,kup0,coreno;
+ double t = n*d,w,sum,minsum;
+ double *A,*Atflo,*Atcei,*V[2],*H[4];
+
+ A = (double *)malloc((size_t)(3*(2*n+3) + 6*(n+2))*sizeof(double));
+ Atflo = A + 2*n + 3;
+ Atcei = Atflo + 2*n + 3;
+ V[0] = Atcei + 2*n + 3;
+ V[1] = V[0] + n + 2;
+ for(i=0;i<4;i++) H[i] = V[1] + (i+1)*(n+2);
+
+ ks_pomeranz_bounds(n,t,A,Atflo,Atcei);
+
+ for(j=1;j<=n+1;j++) V[0][j] = 0;
+ for(j=2;j<=n+1;j++) V[1][j] = 0;
+ V[1][1] = reno;
+ coreno = 1;
+
+ /*
+  * There are only four distinct step lengths A[i] - A[i-1], so we
+  * tabulate H[s][j] = (step/n)^j/j! for each of them.
+  */
+ H[0][0] = 1;
+ w = 2.0*A[2]/n;
+ for(j=1;j<=n+1;j++) H[0][j] = w*H[0][j-1]/j;
+ H[1][0] = 1;
+ w = (1.0 - 2.0*A[2])/n;
+ for(j=1;j<=n+1;j++) H[1][j] = w*H[1][j-1]/j;
+ H[2][0] = 1;
+ w = A[2]/n;
+ for(j=1;j<=n+1;j++) H[2][j] = w*H[2][j-1]/j;
+ H[3][0] = 1;
+ for(j=1;j<=n+1;j++) H[3][j] = 0;
+
+ r1 = 0;
+ r2 = 1;
+ for(i=2;i<=2*n+2;i++){
+   jlow = 2 + (int)Atflo[i];
+   if(jlow < 1) jlow = 1;
+   jup = (int)Atcei[i];
+   if(jup > n+1) jup = n+1;
+   klow = 2 + (int)Atflo[i-1];
+   if(klow < 1) klow = 1;
+   kup0 = (int)Atcei[i-1];
+
+   w = (A[i] - A[i-1])/n;
+   s = 3;
+   for(j=0;j<4;j++){
+     if(fabs(w - H[j][1]) <= 1.0e-15){
+       s = j;
+       break;
+     }
+   }
+
+   minsum = reno;
+   r1 = (r1 + 1) & 1;
+   r2 = (r2 + 1) & 1;
+   for(j=jlow;j<=jup;j++){
+     kup = (kup0 > j) ? j : kup0;
+     sum = 0;
+     for(k=kup;k>=klow;k--) sum += V[r1][k]*H[s][j-k];
+     V[r2][j] = sum;
+     if(sum < minsum) minsum = sum;
+   }
+   /* Renormalize to keep the probabilities from underflowing. */
+   if(minsum < 1.0e-280){
+     for(j=jlow;j<=jup;j++) V[r2][j] *= reno;
+     coreno++;
+   }
+ }
+
+ sum = V[r2][n+1];
+ free(A);
+ w = lgamma(n + 1.0) - coreno*eno*M_LN2 + log(sum);
+ if(w >= 0.0) return 1.0;
+ return exp(w);
+
+}
+
+/*
+ * The Pelz-Good asymptotic series for the CDF, for large n.
+ */
+static double ks_pelz_good(int n,double d)
+{
+
+ const int jmax = 20;
+ const double eps = 1.0e-10;
+ const double c = 2.506628274631001;     /* sqrt(2 pi) */
+ const double c2 = 1.2533141373155001;   /* sqrt(pi/2) */
+ const double pi2 = M_PI*M_PI,pi4 = pi2*pi2;
+ double rn = sqrt((double)n);
+ double z = rn*d,z2 = z*z,z4 = z2*z2,z6 = z4*z2;
+ double w = pi2/(2.0*z2);
+ double ti,term,tom,sum;
+ int j;
+
+ term = 1;
+ sum = 0;
+ for(j=0;j<=jmax && term > eps*sum;j++){
+   ti = j + 0.5;
+   term = exp(-ti*ti*w);
+   sum += term;
+ }
+ sum *= c/z;
+
+ term = 1;
+ tom = 0;
+ for(j=0;j<=jmax && fabs(term) > eps*fabs(tom);j++){
+   ti = j + 0.5;
+   term = (pi2*ti*ti - z2)*exp(-pi2*ti*ti/(2.0*z2));
+   tom += term;
+ }
+ sum += tom*c2/(rn*3.0*z4);
+
+ term = 1;
+ tom = 0;
+ for(j=0;j<=jmax && fabs(term) > eps*fabs(tom);j++){
+   ti = j + 0.5;
+   term = 6*z6 + 2*z4 + pi2*(2*z4 - 5*z2)*ti*ti + pi4*(1 - 2*z2)*ti*ti*ti*ti;
+   term *= exp(-pi2*ti*ti/(2.0*z2));
+   tom += term;
+ }
+ sum += tom*c2/(n*36.0*z*z6);
+
+ term = 1;
+ tom = 0;
+ for(j=1;j<=jmax && term > eps*tom;j++){
+   ti = j;
+   term = pi2*ti*ti*exp(-pi2*ti*ti/(2.0*z2));
+   tom += term;
+ }
+ sum -= tom*c2/(n*18.0*z*z2);
+
+ term = 1;
+ tom = 0;
+ for(j=0;j<=jmax && fabs(term) > eps*fabs(tom);j++){
+   ti = j + 0.5;
+   ti = ti*ti;
+   term = -30*z6 - 90*z6*z2 + pi2*(135*z4 - 96*z6)*ti + pi4*(212*z4 - 60*z2)*ti*ti
+          + pi2*pi4*ti*ti*ti*(5 - 30*z2);
+   term *= exp(-ti*pi2/(2.0*z2));
+   tom += term;
+ }
+ sum += tom*c2/(rn*n*3240.0*z4*z6);
+
+ term = 1;
+ tom = 0;
+ for(j=1;j<=jmax && fabs(term) > eps*fabs(tom);j++){
+   ti = (double)j*j;
+   term = (3*pi2*ti*z2 - pi4*ti*ti)*exp(-pi2*ti/(2.0*z2));
+   tom += term;
+ }
+ sum += tom*c2/(rn*n*108.0*z6);
+
+ return sum;
+
+}
+
+/*
+ * Smirnov's exact formula for the one-sided upper tail P(D_n^+ >= d),
+ *
+ *   d sum_{j=0}^{n(1-d)} C(n,j) (j/n + d)^(j-1) (1 - d - j/n)^(n-j)
+ *
+ * summed outward from near its largest term until the terms stop
+ * mattering.  That walk gets long for the counts streaming mode makes,
+ * so above KS_NASYMP we use the asymptotic expansion
+ *
+ *   exp(-z) (1 - (2z^2 - 4z - 1)/(18n)),  z = (6nd + 1)^2/(18n)
+ *
+ * instead, as Simard and L'Ecuyer do.
+ */
+#define KS_NASYMP 200000
+static double ks_plus_upper(int n,double d)
+{
+
+ const double eps = 1.0e-12;
+ int j,jdiv,jmax = (int)(n*(1.0 - d));
+ double q,sum = 0.0,t,logcom,logjmax;
+
+ if(n > KS_NASYMP){
+   t = 6.0*n*d + 1.0;
+   q = t*t/(18.0*n);
+   t = 1.0 - (2.0*q*q - 4.0*q - 1.0)/(18.0*n);
+   if(t <= 0.0) return 0.0;
+   t *= exp(-q);
+   return (t >= 1.0) ? 1.0 : t;
+ }
+
+ /* Avoid log(0) for j = jmax and q ~ 1.0 */
+ if((1.0 - d - (double)jmax/n) <= 0.0) jmax--;
+ jdiv = (n > 3000) ? 2 : 3;
+ j = jmax/jdiv + 1;
+ logcom = lgamma(n + 1.0) - lgamma(j + 1.0) - lgamma(n - j + 1.0);
+ logjmax = logcom;
+ while(j <= jmax){
+   q = (double)j/n + d;
+   t = exp(logcom + (j - 1)*log(q) + (n - j)*log1p(-q));
+   sum += t;
+   logcom += log((double)(n - j)/(j + 1));
+   if(t <= sum*eps) break;
+   j++;
+ }
+ j = jmax/jdiv;
+ logcom = logjmax + log((double)(j + 1)/(n - j));
+ while(j > 0){
+   q = (double)j/n + d;
+   t = exp(logcom + (j - 1)*log(q) + (n - j)*log1p(-q));
+   sum += t;
+   logcom += log((double)j/(n - j + 1));
+   if(t <= sum*eps) break;
+   j--;
+ }
+ sum *= d;
+ /* and the j = 0 term */
+ sum += exp(n*log1p(-d));
+ return sum;
 
 }
 
+static double ks_cdf(int n,double d);
+
 /*
- * Marsaglia's definition is K = 1 - p.  I convert it to p, as p is
- * what we want in dieharder.
+ * The p-value, P(D_n >= d).  Marsaglia's definition is K = 1 - p, the
+ * CDF; we want p, and want it accurate even when it is tiny, so we
+ * compute it directly in the tail instead of subtracting.
  */
 double p_ks_new(int n,double d)
 {
 
-  int k,m,i,j,g,eH,eQ;
-  double h,s,*H,*Q;
-
-  /*
-   * The next fragment is used if ks_test is not 2.  This is faster
-   * than going to convergence, but is still really slow compared to
-   * switching to the asymptotic form.
-   *
-   * If you require >7 digit accuracy in the right tail use ks_test = 2
-   * but be prepared for occasional long runtimes.
-   */
-  s=d*d*n;
-  if(ks_test != 2 && ( s>7.24 || ( s>3.76 && n>99 ))) {
-    if(n == 10400) printf("Returning the easy way\n");
-    return 2.0*exp(-(2.000071+.331/sqrt(n)+1.409/n)*s);
-  }
-
-  /*
-   * If ks_test = 2, we always execute the following code and work to
-   * convergence.
-   */
-  k=(int)(n*d)+1;
-  m=2*k-1;
-  h=k-n*d;
-  /* printf("p_ks_new:  n = %d  k = %d  m = %d  h = %f\n",n,k,m,h); */
-  H=(double*)malloc((m*m)*sizeof(double));
-  Q=(double*)malloc((m*m)*sizeof(double));
-  for(i=0;i<m;i++){
-    for(j=0;j<m;j++){
-      if(i-j+1<0){
-        H[i*m+j]=0;
-      } else {
-        H[i*m+j]=1;
-      }
-    }
-  }
-
-  for(i=0;i<m;i++){
-    H[i*m]-=pow(h,i+1);
-    H[(m-1)*m+i]-=pow(h,(m-i));
-  }
-
-  H[(m-1)*m]+=(2*h-1>0?pow(2*h-1,m):0);
-  for(i=0;i<m;i++){
-    for(j=0;j<m;j++){
-      if(i-j+1>0){
-        for(g=1;g<=i-j+1;g++){
-	  H[i*m+j]/=g;
-	}
-      }
-    }
-  }
-
-  eH=0;
-  mPower(H,eH,Q,&eQ,m,n);
-  /* printf("p_ks_new eQ = %d\n",eQ); */
-  s=Q[(k-1)*m+k-1];
-  /* printf("s = %16.8e\n",s); */
-  for(i=1;i<=n;i++){
-    s=s*i/n;
-    /* printf("i = %d: s = %16.8e\n",i,s); */
-    if(s<1e-140){
-      /* printf("Oops, starting to have underflow problems: s = %16.8e\n",s); */
-      s*=1e140;
-      eQ-=140;
-    }
-  }
+ double w = n*d*d,t;
+
+ if(w >= 370.0 || d >= 1.0) return 0.0;
+ if(w <= 0.0274 || d <= 0.5/n) return 1.0;
+ if(n == 1) return 2.0 - 2.0*d;
+ if(d <= 1.0/n){
+   t = 2.0*d*n - 1.0;
+   if(n <= KS_NEXACT) return 1.0 - ks_rapfac(n)*pow(t,(double)n);
+   return 1.0 - exp(lgamma(n + 1.0) + n*log(t/n));
+ }
+ if(d >= 1.0 - 1.0/n) return 2.0*pow(1.0 - d,(double)n);
+
+ if(n <= KS_NEXACT){
+   if(w < 4.0) return 1.0 - ks_cdf(n,d);
+   return 2.0*ks_plus_upper(n,d);
+ }
+ if(w >= 2.65) return 2.0*ks_plus_upper(n,d);
+ return 1.0 - ks_cdf(n,d);
+
+}
+
+/*
+ * The CDF, P(D_n < d).
+ */
+static double ks_cdf(int n,double d)
+{
 
-  /* printf("I'll bet this is it: s = %16.8e  eQ = %d\n",s,eQ); */
-  s*=pow(10.,eQ);
-  s = 1.0 - s;
-  free(H);
-  free(Q);
-  return s;
+ double w = n*d*d,t;
+
+ if(w >= 18.0 || d >= 1.0) return 1.0;
+ if(d <= 0.5/n) return 0.0;
+ if(n == 1) return 2.0*d - 1.0;
+ if(d <= 1.0/n){
+   t = 2.0*d*n - 1.0;
+   if(n <= KS_NEXACT) return ks_rapfac(n)*pow(t,(double)n);
+   return exp(lgamma(n + 1.0) + n*log(t/n));
+ }
+ if(d >= 1.0 - 1.0/n) return 1.0 - 2.0*pow(1.0 - d,(double)n);
+
+ if(n <= KS_NEXACT){
+   if(w < 0.754693) return ks_durbin(n,d);
+   if(w < 4.0) return ks_pomeranz(n,d);
+   return 1.0 - p_ks_new(n,d);
+ }
+ if(n <= KS_NDURBIN || (n <= KS_NKOLMO && (ks_test == 2 || w*d*n <= 7.0))){
+   return ks_durbin(n,d);
+ }
+ return ks_pelz_good(n,d);
 
 }
      
@@ -476,15 +916,14 @@ double p_ks_new(int n,double d)
  * don't need it anymore unless it turns out to be faster AND precise.
  *========================================================================
  */
-double kstest_kuiper(double *pvalue,int count)
+double kstest_kuiper(double *pvalue,int count,double *scratch)
 {
 
  int i;
- double y,v,vmax,vmin,csqrt;
- double p,x;
 
  /*
-  * We start by sorting the list of pvalues.
+  * We start by sorting the list of pvalues, with scratch as kstest()
+  * uses it.
   */
  if(verbose == D_KSTEST || verbose == D_ALL){
    printf("# kstest_kuiper(): Computing Kuiper KS pvalue for:\n");
@@ -500,7 +939,22 @@ double kstest_kuiper(double *pvalue,int count)
   * return the one pvalue and skip the rest of the test.
   */
  if(count == 1) return pvalue[0];
- gsl_sort(pvalue,1,count);
+ radix_sort_double(pvalue,count,scratch);
+ return(kstest_kuiper_sorted(pvalue,count));
+
+}
+
+/*
+ * kstest_kuiper() on a vector of pvalues that is already sorted.
+ */
+double kstest_kuiper_sorted(double *pvalue,int count)
+{
+
+ int i;
+ double y,v,vmax,vmin;
+ double p;
+
+ if(count == 1) return pvalue[0];
 
  /*
   * Here's the test.  For each (sorted) pvalue, its index is the number of
@@ -528,12 +982,7 @@ double kstest_kuiper(double *pvalue,int count)
    }
  }
  v = fabs(vmax) + fabs(vmin);
- csqrt = sqrt(count);
- x = (csqrt + 0.155 + 0.24/csqrt)*v;
- if(verbose == D_KSTEST || verbose == D_ALL){
-   printf("Kuiper's V = %8.3f, evaluating q_ks_kuiper(%6.2f)\n",v,x);
- }
- p = q_ks_kuiper(x,count);
+ p = kstest_kuiper_v_pvalue(count,v);
 
  if(verbose == D_KSTEST || verbose == D_ALL){
    if(p < 0.0001){
@@ -548,6 +997,23 @@ double kstest_kuiper(double *pvalue,int count)
 
 }
 
+/*
+ * Turn Kuiper's V over count pvalues into a p-value.
+ */
+double kstest_kuiper_v_pvalue(int count,double v)
+{
+
+ double csqrt,x;
+
+ csqrt = sqrt(count);
+ x = (csqrt + 0.155 + 0.24/csqrt)*v;
+ if(verbose == D_KSTEST || verbose == D_ALL){
+   printf("Kuiper's V = %8.3f, evaluating q_ks_kuiper(%6.2f)\n",v,x);
+ }
+ return(q_ks_kuiper(x,count));
+
+}
+
 double q_ks_kuiper(double x,int count)
 {
 
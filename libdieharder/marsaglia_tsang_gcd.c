@@ -25,16 +25,14 @@
  * on both of these binned distributions yield two p-values per test,
  * and 100 (default) p-values of each are accumulated and subjected to
  * final KS tests and displayed in a histogram.
+ *
+ * -n 64 makes u and v 64 bit uints (two successive rands each) and uses
+ * a separate simulated k table for them (mean k is about 38).
  *========================================================================
  */
 
 #include <dieharder/libdieharder.h>
 
-/*
- * Include inline uint generator
- */
-#include "static_get_bits.c"
-
 /*
  * This determines the number of samples that go into building the kprob[]
  * table.
@@ -144,12 +142,176 @@ double kprob2[KTBLSIZE] = {
  0.000523884717, 0.000187620922, 6.0831732e-05, 1.7787961e-05, 4.66037e-06, 1.090656e-06,
  2.26719e-07, 4.1078e-08,  6.431e-09,    8.8e-10,    1.2e-10,};
 
+/*
+ * k for 64 bit operands.  The mean step count roughly doubles (to about
+ * 38) so the 32 bit table is useless here.  This one is 2x10^9 samples,
+ * 10^9 each from xoshiro256** and splitmix64 (which agree, chisq 39 for
+ * 47 well populated bins), with the operands built from their 32 bit
+ * halves the way the test builds them and k counted as the kernel
+ * below counts it.  The tails are too sparse to simulate bin by bin
+ * (k = 10 came up 3 times in 2x10^9, k = 66 once), so every bin at
+ * either end with fewer than 10^4 samples is merged into its neighbour:
+ * k <= KMIN64 is lumped into bin KMIN64 and k >= KTBLSIZE64-1 into the
+ * last bin, leaving every nonzero entry good to about 1%.
+ */
+#define KTBLSIZE64 60
+#define KMIN64 17
+
+double kprob64[KTBLSIZE64] = {
+ 0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
+ 0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
+ 0.0, 0.0, 0.0, 0.0, 0.0, 8.418e-06,
+ 1.4778e-05, 3.6714e-05, 8.61465e-05, 0.000191121, 0.000402414, 0.000804776,
+ 0.0015223685, 0.002742184, 0.004702242, 0.0076740875, 0.011947251, 0.017736451,
+ 0.025137733, 0.0340481665, 0.044068146, 0.054542186, 0.0645988415, 0.073219364,
+ 0.0794683885, 0.0825882875, 0.08223418, 0.078436517, 0.0716913695, 0.0628072025,
+ 0.0527291885, 0.0424326735, 0.0327282575, 0.0241933245, 0.01713045, 0.011629804,
+ 0.007561157, 0.0047121725, 0.002809536, 0.0016051475, 0.0008754965, 0.000458539,
+ 0.00022911, 0.000109415, 5.00135e-05, 2.16375e-05, 9.0685e-06, 5.6755e-06 };
+
+/*
+ * Euclid's method is a chain of dependent divisions ending in an
+ * unpredictable branch, so a single pair at a time leaves the divider
+ * idle most of the time.  The kernels below run GCD_LANES pairs in
+ * lockstep, one Euclid step per lane per round, and refill a lane from
+ * the batch as soon as its pair is done.  The step count k (the
+ * statistic the kprob tables describe) and the gcd w are exactly the
+ * ones the one-pair-at-a-time loop produced.
+ */
+#define GCD_LANES 8
+#define GCD_PAIRS 4096
+
+static void gcd_lanes32(uint *pu,uint *pv,uint npairs,uint *gcd,uint gtblsize,
+                        unsigned long long int *ktbl,uint ktblsize)
+{
+
+ uint u[GCD_LANES],v[GCD_LANES],k[GCD_LANES],idle[GCD_LANES];
+ uint next = 0,active = 0,lane,w;
+
+ for(lane=0;lane<GCD_LANES;lane++){
+   k[lane] = 0;
+   if(next < npairs){
+     u[lane] = pu[next];
+     v[lane] = pv[next];
+     next++;
+     idle[lane] = 0;
+     active++;
+   } else {
+     u[lane] = v[lane] = 1;
+     idle[lane] = 1;
+   }
+ }
+
+ while(active > 0){
+   for(lane=0;lane<GCD_LANES;lane++){
+     w = u[lane]%v[lane];
+     u[lane] = v[lane];
+     v[lane] = w;
+     k[lane]++;
+   }
+   for(lane=0;lane<GCD_LANES;lane++){
+     if(v[lane] != 0) continue;
+     if(idle[lane]){
+       v[lane] = 1;
+       continue;
+     }
+     /*
+      * Lump the gcd's past gtblsize into the tail and the k's past
+      * ktblsize into the last bin, as always.
+      */
+     gcd[(u[lane]<gtblsize)?u[lane]:gtblsize-1]++;
+     ktbl[(k[lane]>ktblsize-1)?ktblsize-1:k[lane]]++;
+     k[lane] = 0;
+     if(next < npairs){
+       u[lane] = pu[next];
+       v[lane] = pv[next];
+       next++;
+     } else {
+       u[lane] = v[lane] = 1;
+       idle[lane] = 1;
+       active--;
+     }
+   }
+ }
+
+}
+
+static void gcd_lanes64(unsigned long long int *pu,unsigned long long int *pv,
+                        uint npairs,uint *gcd,uint gtblsize,
+                        unsigned long long int *ktbl,uint ktblsize)
+{
+
+ unsigned long long int u[GCD_LANES],v[GCD_LANES],w;
+ uint k[GCD_LANES],idle[GCD_LANES];
+ uint next = 0,active = 0,lane;
+
+ for(lane=0;lane<GCD_LANES;lane++){
+   k[lane] = 0;
+   if(next < npairs){
+     u[lane] = pu[next];
+     v[lane] = pv[next];
+     next++;
+     idle[lane] = 0;
+     active++;
+   } else {
+     u[lane] = v[lane] = 1;
+     idle[lane] = 1;
+   }
+ }
+
+ while(active > 0){
+   for(lane=0;lane<GCD_LANES;lane++){
+     w = u[lane]%v[lane];
+     u[lane] = v[lane];
+     v[lane] = w;
+     k[lane]++;
+   }
+   for(lane=0;lane<GCD_LANES;lane++){
+     if(v[lane] != 0) continue;
+     if(idle[lane]){
+       v[lane] = 1;
+       continue;
+     }
+     gcd[(u[lane]<gtblsize)?u[lane]:gtblsize-1]++;
+     ktbl[(k[lane]>ktblsize-1)?ktblsize-1:k[lane]]++;
+     k[lane] = 0;
+     if(next < npairs){
+       u[lane] = pu[next];
+       v[lane] = pv[next];
+       next++;
+     } else {
+       u[lane] = v[lane] = 1;
+       idle[lane] = 1;
+       active--;
+     }
+   }
+ }
+
+}
+
+/*
+ * Next word of the batch, or a fresh one from the stream if zeros have
+ * eaten into the batch.
+ */
+static uint gcd_word(uint *words,uint *iw,uint nw,random_generator_t *cur_rng)
+{
+
+ uint w;
+
+ if(*iw < nw) return words[(*iw)++];
+ get_rand_uint_block(&w,1,cur_rng);
+ return w;
+
+}
 
 int marsaglia_tsang_gcd(Test **test, int irun, random_generator_t *cur_rng)
 {
 
- unsigned long long int t,ktbl[KTBLSIZE];
- uint i,j,k,u,v,w;
+ unsigned long long int t,ktbl[KTBLSIZE64];
+ unsigned long long int *pu64 = 0,*pv64 = 0;
+ uint i,j,p,npairs,nw,nwpp,iw,ktblsize,wide;
+ uint *words,*pu = 0,*pv = 0;
+ double *kp;
  static uint *gcd = 0;
  static double gnorm = 6.0/(PI*PI);
  static uint gtblsize = 0;
@@ -161,6 +323,21 @@ int marsaglia_tsang_gcd(Test **test, int irun, random_generator_t *cur_rng)
  test[0]->ntuple = 0;
  test[1]->ntuple = 0;
 
+ /*
+  * -n 64 selects 64 bit operands (built from two successive uints,
+  * high word first), which need their own k table.
+  */
+ wide = (test[0]->ntuple_cl == 64);
+ if(wide){
+   ktblsize = KTBLSIZE64;
+   kp = kprob64;
+   test[0]->ntuple = 64;
+   test[1]->ntuple = 64;
+ } else {
+   ktblsize = KTBLSIZE;
+   kp = kprob;
+ }
+
  /* Make data tables for one-time entry -- do not delete.
  uint nbin = 50;
  double pbin = 0.376;
@@ -189,10 +366,10 @@ int marsaglia_tsang_gcd(Test **test, int irun, random_generator_t *cur_rng)
  }
  if(gcd == 0) gcd = (uint *)malloc(gtblsize*sizeof(uint));
  memset(gcd,0,gtblsize*sizeof(uint));
- memset(ktbl,0,KTBLSIZE*sizeof(unsigned long long int));
+ memset(ktbl,0,KTBLSIZE64*sizeof(unsigned long long int));
 
 
- Vtest_create(&vtest_k,KTBLSIZE);
+ Vtest_create(&vtest_k,ktblsize);
  Vtest_create(&vtest_u,gtblsize);
 
  /* exit(0); */
@@ -201,44 +378,65 @@ int marsaglia_tsang_gcd(Test **test, int irun, random_generator_t *cur_rng)
    printf("# user_marsaglia_tsang_gcd(): Beginning gcd test\n");
  }
 
- /* for(t=0;t<KCNT;t++){ */
- for(t=0;t<test[0]->tsamples;t++){
-   /* Initialize counter for this sample */
-   k = 0;
-   /* Get nonzero u,v */
-   do{
-    u = get_rand_bits_uint(32,0xffffffff,cur_rng, 0);
-   } while(u == 0);
-   do{
-    v = get_rand_bits_uint(32,0xffffffff,cur_rng, 0);
-   } while(v == 0);
-
-   do{
-     w = u%v;
-     u = v;
-     v = w;
-     k++;
-   } while(v>0);
-
-   /*
-    * We just need test[0]->tsamples*c/u^2 to be greater than about 10, the
-    * cutoff built into Vtest_eval()  For test[0]->tsamples = 10^7, turns out that
-    * gtblsize < sqrt((double)test[0]->tsamples*gnorm/10.0) (about 780) should be just
-    * about right.  We lump all counts larger than that into "the tail",
-    * which MUST be included in the chisq targets down below.
-    */
-   if(u>=gtblsize) u = gtblsize-1;
-   if(u<gtblsize) {
-     gcd[u]++;
+ /*
+  * Draw the pairs a batch at a time from a block of words and hand each
+  * batch to the interleaved kernel.  We ask for exactly as many words as
+  * the batch needs if none of them are zero, so the stream is consumed
+  * just as it was when we pulled u and v one at a time.
+  */
+ nwpp = wide?4:2;
+ words = (uint *)malloc(GCD_PAIRS*nwpp*sizeof(uint));
+ if(wide){
+   pu64 = (unsigned long long int *)malloc(GCD_PAIRS*sizeof(unsigned long long int));
+   pv64 = (unsigned long long int *)malloc(GCD_PAIRS*sizeof(unsigned long long int));
+ } else {
+   pu = (uint *)malloc(GCD_PAIRS*sizeof(uint));
+   pv = (uint *)malloc(GCD_PAIRS*sizeof(uint));
+ }
+ for(t=0;t<test[0]->tsamples;t+=npairs){
+   npairs = test[0]->tsamples - t;
+   if(npairs > GCD_PAIRS) npairs = GCD_PAIRS;
+   nw = npairs*nwpp;
+   get_rand_uint_block(words,nw,cur_rng);
+   iw = 0;
+   for(p=0;p<npairs;p++){
+     /* Get nonzero u,v */
+     if(wide){
+       do{
+         pu64[p] = (unsigned long long int) gcd_word(words,&iw,nw,cur_rng) << 32;
+         pu64[p] |= gcd_word(words,&iw,nw,cur_rng);
+       } while(pu64[p] == 0);
+       do{
+         pv64[p] = (unsigned long long int) gcd_word(words,&iw,nw,cur_rng) << 32;
+         pv64[p] |= gcd_word(words,&iw,nw,cur_rng);
+       } while(pv64[p] == 0);
+     } else {
+       do{
+         pu[p] = gcd_word(words,&iw,nw,cur_rng);
+       } while(pu[p] == 0);
+       do{
+         pv[p] = gcd_word(words,&iw,nw,cur_rng);
+       } while(pv[p] == 0);
+     }
+   }
+   if(wide){
+     gcd_lanes64(pu64,pv64,npairs,gcd,gtblsize,ktbl,ktblsize);
+   } else {
+     gcd_lanes32(pu,pv,npairs,gcd,gtblsize,ktbl,ktblsize);
+   }
+ }
+ nullfree(words);
+ nullfree(pu);
+ nullfree(pv);
+ nullfree(pu64);
+ nullfree(pv64);
+
+ /* kprob64 lumps the sparse low k's into bin KMIN64, so we do too */
+ if(wide){
+   for(i=0;i<KMIN64;i++){
+     ktbl[KMIN64] += ktbl[i];
+     ktbl[i] = 0;
    }
-
-   /*
-    * lump the k's > KTBLSIZE only because that's what we did generating
-    * the table...
-    */
-   k = (k>KTBLSIZE-1)?KTBLSIZE-1:k;
-   ktbl[k]++;
-
  }
 
  /*
@@ -267,9 +465,9 @@ int marsaglia_tsang_gcd(Test **test, int irun, random_generator_t *cur_rng)
    printf("  i\t  mean\n");
  }
  vtest_k.cutoff = 5.0;
- for(i=0;i<KTBLSIZE;i++){
+ for(i=0;i<ktblsize;i++){
    vtest_k.x[i] = (double)ktbl[i];
-   vtest_k.y[i] = test[0]->tsamples*kprob[i];
+   vtest_k.y[i] = test[0]->tsamples*kp[i];
    MYDEBUG(D_MARSAGLIA_TSANG_GCD) {
      printf(" %2u\t%f\t%f\t%f\n",i,vtest_k.x[i],vtest_k.y[i],vtest_k.x[i]-vtest_k.y[i]);
    }
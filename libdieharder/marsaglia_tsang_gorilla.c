@@ -15,7 +15,8 @@
 void marsaglia_tsang_gorilla(Test **test, int irun, random_generator_t *cur_rng)
 {
 
- uint t,i,lag;
+ uint t,lag;
+ double u;
  Xtest ptest;
 
  /*
@@ -49,10 +50,11 @@ void marsaglia_tsang_gorilla(Test **test, int irun, random_generator_t *cur_rng)
     */
 
    /* Throw away lag-1 per sample */
-   for(i=0;i<(lag-1);i++) gsl_rng_uniform(cur_rng->rng);
+   rng_discard(cur_rng->rng,lag-1);
 
    /* sample only every lag numbers, reset counter */
-   ptest.x += gsl_rng_uniform(cur_rng->rng);
+   get_rand_uniform_block(&u,1,0,cur_rng);
+   ptest.x += u;
 
  }
 
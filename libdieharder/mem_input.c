@@ -0,0 +1,243 @@
+/*
+ * See copyright in copyright.h and the accompanying file COPYING
+ */
+
+/*
+ *========================================================================
+ * Running tests on rands the caller already holds, for programs that
+ * embed libdieharder.  There is no need to write a gsl_rng_type, pick a
+ * generator number or touch the global generator:
+ *
+ *   mem_input_alloc()       a gsl_rng that reads n 32 bit words straight
+ *                           out of the caller's buffer, in place.  Past
+ *                           the end it starts over at the front and
+ *                           counts that as an overrun.
+ *   mem_input_fill_alloc()  a gsl_rng that asks fill(arg,block,n) for up
+ *                           to n words at a time, MEM_INPUT_BLOCK at most.
+ *                           When fill returns 0 the source is dry, and
+ *                           every read after that returns 0 and counts
+ *                           as an overrun.
+ *   mem_input_overruns()    how many times a source ran out, 0 for any
+ *                           other kind of gsl_rng.
+ *   mem_input_read()        the bulk read get_rand_uint_block() uses on
+ *                           these sources instead of a call per word.
+ *   run_test_on_rng()       runs one pass of a test made by create_test()
+ *                           on any gsl_rng, with a random_generator_t of
+ *                           its own, and returns the overruns.
+ *   run_test_on_buffer()    ...on a buffer, and
+ *   run_test_on_fill()      ...on a fill callback.
+ *
+ * e.g.
+ *
+ *   test = create_test(dh_test_types[0],0,100);
+ *   if(run_test_on_buffer(dh_test_types[0],test,words,n) == 0){
+ *     ... test[0]->ks_pvalue ...
+ *   }
+ *   destroy_test(dh_test_types[0],test);
+ *
+ * The results are in test[] as usual, and a nonzero return means some
+ * rands were used twice (or were zeros), so the pvalues can't be
+ * trusted.  The tests' settings are still the globals, so set them up
+ * first as the CLI's set_globals() does (overlap = 1, and Xoff, which
+ * caps psamples, at least).  The -Y modes and the two sample test need
+ * more of the CLI and aren't done here.  Different tests can run on
+ * different threads at once, but not two instances of one test (see
+ * run_fanout.c in the CLI).
+ *========================================================================
+ */
+
+#include <dieharder/libdieharder.h>
+
+#define MEM_INPUT_BLOCK 16384
+
+typedef struct {
+  const unsigned int *word;     /* The buffer, or block below */
+  unsigned long long len;       /* Words in it */
+  unsigned long long pos;
+  unsigned int overruns;
+  mem_input_fill_t fill;        /* NULL for a buffer */
+  void *arg;
+  unsigned int block[MEM_INPUT_BLOCK];
+} mem_input_state_t;
+
+/*
+ * Refill a fill source, or start a buffer over.
+ */
+static void mem_input_next(mem_input_state_t *s)
+{
+
+ if(s->fill == NULL){
+   s->pos = 0;
+   s->overruns++;
+   return;
+ }
+ s->len = s->fill(s->arg,s->block,MEM_INPUT_BLOCK);
+ if(s->len > MEM_INPUT_BLOCK) s->len = MEM_INPUT_BLOCK;
+ if(s->len == 0){
+   memset(s->block,0,sizeof(s->block));
+   s->len = MEM_INPUT_BLOCK;
+   s->overruns++;
+ }
+ s->pos = 0;
+
+}
+
+static unsigned long int mem_input_get(void *vstate)
+{
+
+ mem_input_state_t *s = (mem_input_state_t *) vstate;
+
+ if(s->pos == s->len) mem_input_next(s);
+ return s->word[s->pos++];
+
+}
+
+static double mem_input_get_double(void *vstate)
+{
+
+ return mem_input_get(vstate)/(double) UINT_MAX;
+
+}
+
+/*
+ * Like stdin, these can't be reseeded:  a test that tries (e.g.
+ * rgb_persist) just goes on reading where it was rather than
+ * silently reusing rands.
+ */
+static void mem_input_set(void *vstate,unsigned long int seed)
+{
+
+}
+
+static const gsl_rng_type mem_input_type =
+{"mem_input",                             /* name */
+ UINT_MAX,                    /* RAND_MAX */
+ 0,                           /* RAND_MIN */
+ sizeof (mem_input_state_t),
+ &mem_input_set,
+ &mem_input_get,
+ &mem_input_get_double};
+
+gsl_rng *mem_input_alloc(const unsigned int *words,unsigned long long n)
+{
+
+ gsl_rng *rng;
+ mem_input_state_t *s;
+
+ if(words == NULL || n == 0) return NULL;
+ rng = gsl_rng_alloc(&mem_input_type);
+ s = (mem_input_state_t *) rng->state;
+ s->word = words;
+ s->len = n;
+ s->pos = 0;
+ s->overruns = 0;
+ s->fill = NULL;
+ s->arg = NULL;
+ return rng;
+
+}
+
+gsl_rng *mem_input_fill_alloc(mem_input_fill_t fill,void *arg)
+{
+
+ gsl_rng *rng;
+ mem_input_state_t *s;
+
+ if(fill == NULL) return NULL;
+ rng = gsl_rng_alloc(&mem_input_type);
+ s = (mem_input_state_t *) rng->state;
+ s->word = s->block;
+ s->len = s->pos = 0;          /* The first read fills the block */
+ s->overruns = 0;
+ s->fill = fill;
+ s->arg = arg;
+ return rng;
+
+}
+
+unsigned int mem_input_overruns(gsl_rng *rng)
+{
+
+ if(rng == NULL || rng->type != &mem_input_type) return 0;
+ return ((mem_input_state_t *) rng->state)->overruns;
+
+}
+
+/*
+ * Copies the next n words into data[], exactly as n gsl_rng_get()s
+ * would return them, and returns n.  Returns 0 (and reads nothing) if
+ * rng isn't a mem_input source.
+ */
+unsigned int mem_input_read(gsl_rng *rng,unsigned int *data,unsigned int n)
+{
+
+ mem_input_state_t *s;
+ unsigned long long m;
+ unsigned int i;
+
+ if(rng->type != &mem_input_type) return 0;
+ s = (mem_input_state_t *) rng->state;
+ for(i=0;i<n;i += m){
+   if(s->pos == s->len) mem_input_next(s);
+   m = s->len - s->pos;
+   if(m > n - i) m = n - i;
+   memcpy(data + i,s->word + s->pos,(size_t)m*sizeof(unsigned int));
+   s->pos += m;
+ }
+ return n;
+
+}
+
+unsigned int run_test_on_rng(Dtest *dtest,Test **test,gsl_rng *rng)
+{
+
+ unsigned int overruns;
+ random_generator_t source;
+
+ memset(&source,0,sizeof(source));
+ source.rng = rng;
+ source.random_max = gsl_rng_max(rng);
+ source.rmax = source.random_max;
+ while(source.rmax){
+   source.rmax >>= 1;
+   source.rmax_mask = (source.rmax_mask << 1) + 1;
+   source.rmax_bits++;
+ }
+ reset_bit_buffers(&source.read_buffer);
+
+ overruns = mem_input_overruns(rng);
+ test[0]->rng = &source;
+ std_test(dtest,test,NULL);
+ test[0]->rng = NULL;
+ return mem_input_overruns(rng) - overruns;
+
+}
+
+unsigned int run_test_on_buffer(Dtest *dtest,Test **test,const unsigned int *words,
+                                unsigned long long n)
+{
+
+ unsigned int overruns;
+ gsl_rng *rng;
+
+ rng = mem_input_alloc(words,n);
+ if(rng == NULL) return 1;
+ overruns = run_test_on_rng(dtest,test,rng);
+ gsl_rng_free(rng);
+ return overruns;
+
+}
+
+unsigned int run_test_on_fill(Dtest *dtest,Test **test,mem_input_fill_t fill,void *arg)
+{
+
+ unsigned int overruns;
+ gsl_rng *rng;
+
+ rng = mem_input_fill_alloc(fill,arg);
+ if(rng == NULL) return 1;
+ overruns = run_test_on_rng(dtest,test,rng);
+ gsl_rng_free(rng);
+ return overruns;
+
+}
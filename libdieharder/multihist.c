@@ -0,0 +1,125 @@
+/*
+ * See copyright in copyright.h and the accompanying file COPYING
+ */
+
+/*
+ *========================================================================
+ * A histogram of small integer values, for the counting tests
+ * (rgb_bitdist, dab_bytedistrib, diehard_count_1s_byte, sts_serial).
+ *
+ * The obvious count[value]++ is a load, add and store to wherever value
+ * points, and when the same value comes up again before that store has
+ * retired -- which is exactly what a weak generator does -- the next
+ * increment has to wait for it.  So we keep MULTIHIST_BANKS separate
+ * integer sub-histograms, drop successive values into successive banks
+ * so that neighbouring increments never touch the same counter, and
+ * only add the banks together when the caller asks for the counts.
+ *
+ * Values are passed in a batch (an array of values already pulled out
+ * of the bitstream), and must be less than nbins.  There is no range
+ * check; the tests all mask their values anyway.
+ *========================================================================
+ */
+
+#include <dieharder/libdieharder.h>
+
+multihist_t *multihist_alloc(unsigned int nbins)
+{
+
+ multihist_t *h;
+
+ h = (multihist_t *)malloc(sizeof(multihist_t));
+ h->nbins = nbins;
+ h->bank = (unsigned int *)malloc((size_t)MULTIHIST_BANKS*nbins*sizeof(unsigned int));
+ multihist_clear(h);
+ return h;
+
+}
+
+void multihist_free(multihist_t *h)
+{
+
+ if(h == NULL) return;
+ nullfree(h->bank);
+ free(h);
+
+}
+
+void multihist_clear(multihist_t *h)
+{
+
+ memset(h->bank,0,(size_t)MULTIHIST_BANKS*h->nbins*sizeof(unsigned int));
+
+}
+
+/*
+ * Count v[0]..v[n-1].  The two versions differ only in the type of the
+ * values.  The inner loop over the banks has a constant trip count, so
+ * the compiler unrolls it into MULTIHIST_BANKS independent increments.
+ */
+void multihist_add_u32(multihist_t *h,const unsigned int *v,unsigned int n)
+{
+
+ unsigned int i,j,nbins = h->nbins;
+ unsigned int *b = h->bank;
+
+ for(i=0;i+MULTIHIST_BANKS<=n;i+=MULTIHIST_BANKS){
+   for(j=0;j<MULTIHIST_BANKS;j++) b[j*nbins + v[i+j]]++;
+ }
+ for(;i<n;i++) b[v[i]]++;
+
+}
+
+void multihist_add_u16(multihist_t *h,const unsigned short *v,unsigned int n)
+{
+
+ unsigned int i,j,nbins = h->nbins;
+ unsigned int *b = h->bank;
+
+ for(i=0;i+MULTIHIST_BANKS<=n;i+=MULTIHIST_BANKS){
+   for(j=0;j<MULTIHIST_BANKS;j++) b[j*nbins + v[i+j]]++;
+ }
+ for(;i<n;i++) b[v[i]]++;
+
+}
+
+/*
+ * counts[k] = total count of value k, for all nbins values.  The
+ * histogram is left as it is.
+ */
+void multihist_merge(multihist_t *h,unsigned int *counts)
+{
+
+ unsigned int j,k,nbins = h->nbins;
+ const unsigned int *b = h->bank;
+
+ for(k=0;k<nbins;k++) counts[k] = b[k];
+ for(j=1;j<MULTIHIST_BANKS;j++){
+   for(k=0;k<nbins;k++) counts[k] += b[j*nbins + k];
+ }
+
+}
+
+/*
+ * The sparse version of merge-and-clear, for when only a few values
+ * were counted since the last clear:  counts[i] = total count of v[i]
+ * the first time v[i] appears in v[], 0 for any repeats, and every bin
+ * named in v[] is zeroed.  v[] would normally be the batch that was
+ * just added.
+ */
+void multihist_drain_u32(multihist_t *h,const unsigned int *v,unsigned int n,unsigned int *counts)
+{
+
+ unsigned int i,j,k,nbins = h->nbins;
+ unsigned int *b = h->bank;
+
+ for(i=0;i<n;i++){
+   k = v[i];
+   counts[i] = 0;
+   for(j=0;j<MULTIHIST_BANKS;j++){
+     counts[i] += b[j*nbins + k];
+     b[j*nbins + k] = 0;
+   }
+ }
+
+}
@@ -0,0 +1,430 @@
+/*
+ * See copyright in copyright.h and the accompanying file COPYING
+ */
+
+/*
+ *========================================================================
+ * The pieces of the capture file planner (-b, see run_plan() in the
+ * dieharder CLI).  A -a run on a file_input_raw capture normally reads
+ * the file from the front, test after test, and rewinds it when it runs
+ * out, so the later tests quietly reuse data the earlier ones already
+ * saw.  The planner instead gives every test a disjoint range of the
+ * file, just big enough for it, and runs them all at once.  For that it
+ * needs
+ *
+ *   test_words()        how many rands one psample of a test uses.  The
+ *                       tests don't know this themselves (several use a
+ *                       variable number, e.g. diehard_craps throws dice
+ *                       until a game ends), so we count:  the test is run
+ *                       for npsamples psamples on a counting stand-in for
+ *                       the generator with the same range of values, and
+ *                       the count is rounded up per psample and saved in
+ *                       test[0]->words.
+ *   plan_ranges()       how long a range each of n tests gets out of
+ *                       avail rands, given its words per psample and its
+ *                       psamples:  what those need plus 1/PLAN_MARGIN and
+ *                       PLAN_SLACK rands more (for the tests that use a
+ *                       variable number), and a share of anything left
+ *                       over in proportion.  If avail is too short every
+ *                       test's psamples are scaled down by one factor
+ *                       until it isn't, but no test gets fewer than one.
+ *   file_range_alloc()  a gsl_rng that reads rands start..start+len-1 of
+ *                       a raw file with pread() on its own descriptor, so
+ *                       any number of them can read one file at once
+ *                       without sharing a file pointer.  Past the end of
+ *                       its range it starts over at the front of the
+ *                       range, never in anyone else's, and counts that
+ *                       as a rewind.
+ *   file_map_open()     maps a whole raw file into memory once, and
+ *   file_map_rng()      gives out gsl_rngs that read ranges of it just
+ *                       like file_range_alloc()'s, straight from the
+ *                       mapping (mem_input_alloc()s, see mem_input.c;
+ *                       the batch mode, -M, keeps one mapping per file
+ *                       for all of the tests on it).
+ *   file_range_rewinds() how many times a range was started over, 0 for
+ *                       any other kind of gsl_rng.
+ *   file_range_free()   frees either kind of range.
+ *========================================================================
+ */
+
+/* pread() and mmap() are POSIX, not c99 */
+#define _DEFAULT_SOURCE
+#include <dieharder/libdieharder.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#define FILE_RANGE_BLOCK 16384
+#define PLAN_MARGIN 128
+#define PLAN_SLACK 65536
+
+/*
+ * The counting stand-in, an xorshift64* generator whose output is cut
+ * down to [0,max] of the generator it stands in for.
+ */
+typedef struct {
+  unsigned long long x;
+  unsigned long long count;
+  unsigned long long range;     /* max + 1 */
+  double scale;                 /* 1/(max + 1) */
+} words_count_state_t;
+
+static unsigned long int words_count_get(void *vstate)
+{
+
+ words_count_state_t *s = (words_count_state_t *) vstate;
+
+ s->x ^= s->x >> 12;
+ s->x ^= s->x << 25;
+ s->x ^= s->x >> 27;
+ s->count++;
+ return (unsigned long int) (((s->x*0x2545F4914F6CDD1Dull) >> 32) % s->range);
+
+}
+
+static double words_count_get_double(void *vstate)
+{
+
+ words_count_state_t *s = (words_count_state_t *) vstate;
+
+ return words_count_get(vstate)*s->scale;
+
+}
+
+static void words_count_set(void *vstate,unsigned long int seed)
+{
+
+ words_count_state_t *s = (words_count_state_t *) vstate;
+
+ s->x = 0x9E3779B97F4A7C15ull ^ seed;
+ s->count = 0;
+
+}
+
+unsigned long long test_words(Dtest *dtest,Test **test,random_generator_t *like,
+                              unsigned int npsamples)
+{
+
+ unsigned int i;
+ unsigned long long words;
+ gsl_rng_type type;
+ random_generator_t counter;
+ words_count_state_t *s;
+
+ type.name = "words_count";
+ type.max = gsl_rng_max(like->rng);
+ type.min = gsl_rng_min(like->rng);
+ type.size = sizeof(words_count_state_t);
+ type.set = words_count_set;
+ type.get = words_count_get;
+ type.get_double = words_count_get_double;
+
+ counter = *like;
+ counter.rng = gsl_rng_alloc(&type);
+ s = (words_count_state_t *) counter.rng->state;
+ s->range = (unsigned long long) type.max + 1;
+ s->scale = 1.0/((double) type.max + 1.0);
+ s->count = 0;
+ /*
+  * All of the partial rand state, including get_rand_bits_uint()'s
+  * leftover bits, is in counter's own read_buffer, which goes away with
+  * it:  none of the stand-in's bits can reach like's (or the real
+  * run's) buffers.
+  */
+ reset_bit_buffers(&counter.read_buffer);
+
+ /*
+  * Every psample goes in slot 0, as pvalues[] may only have room for
+  * one.  create_test() left the test ready to run, and std_test()
+  * overwrites anything we leave behind.
+  */
+ if(npsamples < 1) npsamples = 1;
+ for(i=0;i<npsamples;i++){
+   dtest->test(test,0,&counter);
+ }
+ words = (s->count + npsamples - 1)/npsamples;
+ gsl_rng_free(counter.rng);
+
+ test[0]->words = words;
+ MYDEBUG(D_STD_TEST){
+   printf("# test_words(): %s (ntuple %u) uses %llu rands per psample\n",
+          dtest->sname,test[0]->ntuple_cl,words);
+ }
+ return words;
+
+}
+
+/*
+ * The rands a range of p psamples needs.
+ */
+static unsigned long long plan_len(unsigned long long words,unsigned int p)
+{
+
+ return words*p + words*p/PLAN_MARGIN + PLAN_SLACK;
+
+}
+
+/*
+ * Returns the factor psamples[] were scaled by (1.0 if they weren't),
+ * or 0.0 if avail can't hold even one psample of every test.  A test
+ * the factor would leave with no psamples keeps one, and the others
+ * are scaled down further to make room for it.
+ */
+double plan_ranges(unsigned int n,const unsigned long long *words,unsigned int *psamples,
+                   unsigned long long avail,unsigned long long *len)
+{
+
+ unsigned int j,*p0;
+ unsigned long long total,add,given;
+ double scale,sum;
+
+ total = 0;
+ for(j=0;j<n;j++) total += plan_len(words[j],1);
+ if(total > avail) return 0.0;
+
+ total = 0;
+ for(j=0;j<n;j++){
+   len[j] = plan_len(words[j],psamples[j]);
+   total += len[j];
+ }
+
+ scale = 1.0;
+ if(total > avail){
+   p0 = (unsigned int *)malloc(n*sizeof(unsigned int));
+   memcpy(p0,psamples,n*sizeof(unsigned int));
+   sum = 0.0;
+   for(j=0;j<n;j++) sum += (double) words[j]*p0[j]*(1.0 + 1.0/PLAN_MARGIN);
+   scale = (double)(avail - (unsigned long long) n*PLAN_SLACK)/sum;
+   /*
+    * Rounding, and the tests held at one psample, can still leave us
+    * over; shrink the factor until everything fits.  One psample each
+    * fits, so this ends.
+    */
+   for(;;){
+     total = 0;
+     for(j=0;j<n;j++){
+       psamples[j] = (unsigned int)(p0[j]*scale);
+       if(psamples[j] < 1) psamples[j] = 1;
+       len[j] = plan_len(words[j],psamples[j]);
+       total += len[j];
+     }
+     if(total <= avail) break;
+     scale *= 0.999*(double) avail/total;
+   }
+   free(p0);
+ }
+
+ /*
+  * The room to spare, shared out in proportion.  Rounding can only
+  * cost the last ranges some of their share, never what they need.
+  */
+ given = 0;
+ for(j=0;j<n;j++){
+   add = (unsigned long long)((double)(avail - total)*len[j]/total);
+   if(given + add > avail - total) add = avail - total - given;
+   len[j] += add;
+   given += add;
+ }
+ return scale;
+
+}
+
+/*
+ * A range of a raw file.  The rands are read FILE_RANGE_BLOCK at a time
+ * into buf.
+ */
+typedef struct {
+  int fd;
+  const char *filename;
+  unsigned long long start;     /* Its first rand in the file */
+  unsigned long long len;       /* Rands in the range */
+  unsigned long long pos;       /* Next rand to read, from start */
+  unsigned int rewind_cnt;
+  unsigned int n;               /* Rands in buf */
+  unsigned int k;               /* Next one to return */
+  unsigned int buf[FILE_RANGE_BLOCK];
+} file_range_state_t;
+
+static void file_range_fill(file_range_state_t *s)
+{
+
+ unsigned int m;
+ size_t want,got;
+ ssize_t r;
+ off_t offset;
+
+ if(s->pos == s->len){
+   s->pos = 0;
+   s->rewind_cnt++;
+ }
+ m = (s->len - s->pos < FILE_RANGE_BLOCK) ? (unsigned int)(s->len - s->pos) : FILE_RANGE_BLOCK;
+ want = (size_t)m*sizeof(unsigned int);
+ offset = (off_t)((s->start + s->pos)*sizeof(unsigned int));
+ got = 0;
+ while(got < want){
+   r = pread(s->fd,(char *)s->buf + got,want - got,offset + (off_t)got);
+   if(r <= 0){
+     fprintf(stderr,"# file_range(): Error reading %s at rand %llu.\n",
+             s->filename,s->start + s->pos);
+     exit(0);
+   }
+   got += (size_t) r;
+ }
+ s->n = m;
+ s->k = 0;
+ s->pos += m;
+
+}
+
+static unsigned long int file_range_get(void *vstate)
+{
+
+ file_range_state_t *s = (file_range_state_t *) vstate;
+
+ if(s->k == s->n) file_range_fill(s);
+ return s->buf[s->k++];
+
+}
+
+/* The same scaling as file_input_raw, so the tests see the same doubles */
+static double file_range_get_double(void *vstate)
+{
+
+ return file_range_get(vstate)/(double) UINT_MAX;
+
+}
+
+/*
+ * Like file_input_raw_set(), this rewinds (here to the front of the
+ * range) and doesn't count it.
+ */
+static void file_range_set(void *vstate,unsigned long int s)
+{
+
+ file_range_state_t *state = (file_range_state_t *) vstate;
+
+ state->pos = 0;
+ state->n = state->k = 0;
+
+}
+
+static const gsl_rng_type file_range_type =
+{"file_range",                            /* name */
+ UINT_MAX,                    /* RAND_MAX */
+ 0,                           /* RAND_MIN */
+ sizeof (file_range_state_t),
+ &file_range_set,
+ &file_range_get,
+ &file_range_get_double};
+
+gsl_rng *file_range_alloc(const char *filename,unsigned long long start,
+                          unsigned long long len)
+{
+
+ int fd;
+ gsl_rng *rng;
+ file_range_state_t *s;
+
+ if(len == 0) return NULL;
+ fd = open(filename,O_RDONLY);
+ if(fd < 0) return NULL;
+ rng = gsl_rng_alloc(&file_range_type);
+ s = (file_range_state_t *) rng->state;
+ s->fd = fd;
+ s->filename = filename;
+ s->start = start;
+ s->len = len;
+ s->pos = 0;
+ s->rewind_cnt = 0;
+ s->n = s->k = 0;
+ return rng;
+
+}
+
+/*
+ * A whole raw file, mapped, and a range of it.
+ */
+struct file_map {
+  int fd;
+  const unsigned int *word;
+  unsigned long long len;       /* Rands in the file */
+};
+
+file_map_t *file_map_open(const char *filename)
+{
+
+ struct stat sbuf;
+ void *map;
+ file_map_t *m;
+ int fd;
+
+ fd = open(filename,O_RDONLY);
+ if(fd < 0) return NULL;
+ if(fstat(fd,&sbuf) != 0 || !S_ISREG(sbuf.st_mode) || sbuf.st_size < (off_t)sizeof(unsigned int)){
+   close(fd);
+   return NULL;
+ }
+ map = mmap(NULL,(size_t)sbuf.st_size,PROT_READ,MAP_SHARED,fd,0);
+ if(map == MAP_FAILED){
+   close(fd);
+   return NULL;
+ }
+ /* The tests read it front to back */
+ madvise(map,(size_t)sbuf.st_size,MADV_SEQUENTIAL);
+ m = (file_map_t *)malloc(sizeof(file_map_t));
+ m->fd = fd;
+ m->word = (const unsigned int *) map;
+ m->len = (unsigned long long) sbuf.st_size/sizeof(unsigned int);
+ return m;
+
+}
+
+unsigned long long file_map_len(file_map_t *m)
+{
+
+ return m->len;
+
+}
+
+gsl_rng *file_map_rng(file_map_t *m,unsigned long long start,unsigned long long len)
+{
+
+ if(start >= m->len || len == 0) return NULL;
+ if(len > m->len - start) len = m->len - start;
+ return mem_input_alloc(m->word + start,len);
+
+}
+
+/*
+ * Every gsl_rng from file_map_rng() must be freed first.
+ */
+void file_map_close(file_map_t *m)
+{
+
+ if(m == NULL) return;
+ munmap((void *) m->word,(size_t)(m->len*sizeof(unsigned int)));
+ close(m->fd);
+ free(m);
+
+}
+
+unsigned int file_range_rewinds(gsl_rng *rng)
+{
+
+ if(rng == NULL) return 0;
+ if(rng->type == &file_range_type){
+   return ((file_range_state_t *) rng->state)->rewind_cnt;
+ }
+ return mem_input_overruns(rng);
+
+}
+
+void file_range_free(gsl_rng *rng)
+{
+
+ if(rng == NULL) return;
+ if(rng->type == &file_range_type){
+   close(((file_range_state_t *) rng->state)->fd);
+ }
+ gsl_rng_free(rng);
+
+}
@@ -0,0 +1,395 @@
+/*
+ * See copyright in copyright.h and the accompanying file COPYING
+ */
+
+/*
+ *========================================================================
+ * Counting 1 bits, shared by the tests that are mostly about counting
+ * 1 bits (sts_monobit, dab_monobit2, diehard_count_1s_stream and
+ * diehard_count_1s_byte).  Each of them used to do it its own way, a
+ * word or a byte at a time.  Here there are three ways of counting:
+ *
+ *   popcount_buf()     the total number of 1's in a buffer of uints.
+ *   popcount_blocks()  the number of 1's in each block of blen uints.
+ *   popcount_bytes()   the number of 1's in each byte, optionally
+ *                      mapped through a small table.
+ *
+ * and three ways of doing each, picked at run time:
+ *
+ *   AVX-512  VPOPCNTDQ counts whole 64 bit (or 32 bit) lanes directly,
+ *            BITALG does the bytes.
+ *   AVX2     the bytes are counted with a nibble table shuffle.  For
+ *            the total this is wrapped in a Harley-Seal carry-save
+ *            adder tree, so that only one in sixteen vectors is
+ *            actually counted.
+ *   scalar   __builtin_popcount() and friends.
+ *
+ * The SIMD paths are compiled with target attributes, so the library
+ * still runs on anything the compiler otherwise targets.
+ *========================================================================
+ */
+
+#include <dieharder/libdieharder.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define POPCOUNT_AVX2 1
+#if defined(__clang__) || __GNUC__ >= 8
+#define POPCOUNT_AVX512 1
+#endif
+#endif
+
+/*
+ * What the CPU we are running on can do.
+ */
+#define POPCOUNT_SCALAR 0
+#define POPCOUNT_HAVE_AVX2 1
+#define POPCOUNT_HAVE_VPOPCNT 2
+
+static int popcount_level = -1;
+static int popcount_bitalg = 0;
+
+static void popcount_init(void)
+{
+
+ popcount_level = POPCOUNT_SCALAR;
+#ifdef POPCOUNT_AVX2
+ __builtin_cpu_init();
+ if(__builtin_cpu_supports("avx2")) popcount_level = POPCOUNT_HAVE_AVX2;
+#ifdef POPCOUNT_AVX512
+ if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq")){
+   popcount_level = POPCOUNT_HAVE_VPOPCNT;
+ }
+ if(__builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512bitalg")){
+   popcount_bitalg = 1;
+ }
+#endif
+#endif
+ MYDEBUG(D_BITS){
+   printf("# popcount_init(): level = %d, bitalg = %d\n",popcount_level,popcount_bitalg);
+ }
+
+}
+
+/*
+ *========================================================================
+ * scalar
+ *========================================================================
+ */
+static unsigned long long popcount_buf_scalar(const unsigned int *w,unsigned int n)
+{
+
+ unsigned int i;
+ unsigned long long total = 0;
+
+ for(i=0;i<n;i++){
+   total += __builtin_popcount(w[i]);
+ }
+ return total;
+
+}
+
+static void popcount_words_scalar(const unsigned int *w,unsigned int n,unsigned int *counts)
+{
+
+ unsigned int i;
+
+ for(i=0;i<n;i++){
+   counts[i] = __builtin_popcount(w[i]);
+ }
+
+}
+
+static void popcount_bytes_scalar(const unsigned char *bytes,unsigned char *counts,
+                                  unsigned int n,const unsigned char *map)
+{
+
+ unsigned int i;
+
+ if(map == NULL){
+   for(i=0;i<n;i++) counts[i] = __builtin_popcount(bytes[i]);
+ } else {
+   for(i=0;i<n;i++) counts[i] = map[__builtin_popcount(bytes[i])];
+ }
+
+}
+
+#ifdef POPCOUNT_AVX2
+
+/*
+ *========================================================================
+ * AVX2
+ *========================================================================
+ */
+
+/*
+ * Per byte count of 1's:  one table shuffle per nibble.
+ */
+#define POPCOUNT_AVX2_BYTES(v) _mm256_add_epi8( \
+   _mm256_shuffle_epi8(ntab,_mm256_and_si256(v,lo)), \
+   _mm256_shuffle_epi8(ntab,_mm256_and_si256(_mm256_srli_epi16(v,4),lo)))
+#define POPCOUNT_AVX2_TABLES \
+ const __m256i lo = _mm256_set1_epi8(0x0f); \
+ const __m256i ntab = _mm256_setr_epi8( \
+   0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, \
+   0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4)
+
+/*
+ * Carry-save adder:  h:l = a + b + c, bitwise.
+ */
+#define POPCOUNT_CSA(h,l,a,b,c) { \
+   __m256i u_ = _mm256_xor_si256(a,b); \
+   h = _mm256_or_si256(_mm256_and_si256(a,b),_mm256_and_si256(u_,c)); \
+   l = _mm256_xor_si256(u_,c); }
+
+__attribute__((target("avx2")))
+static unsigned long long popcount_buf_avx2(const unsigned int *w,unsigned int n)
+{
+
+ unsigned int i,nv;
+ unsigned long long sum[4];
+ const __m256i *v = (const __m256i *) w;
+ __m256i total,ones,twos,fours,eights,sixteens;
+ __m256i twosA,twosB,foursA,foursB,eightsA,eightsB,d;
+ const __m256i zero = _mm256_setzero_si256();
+ POPCOUNT_AVX2_TABLES;
+
+#define POPCOUNT_AVX2_QWORDS(x) _mm256_sad_epu8(POPCOUNT_AVX2_BYTES(x),zero)
+#define POPCOUNT_LOAD(k) _mm256_loadu_si256(v + i + (k))
+ /*
+  * Harley-Seal:  sixteen vectors at a time go through a tree of
+  * carry-save adders that keeps running ones, twos, fours and eights
+  * and emits one vector of sixteens, which is all we count.
+  */
+ nv = n/8;
+ total = zero;
+ ones = twos = fours = eights = zero;
+ for(i=0;i+16<=nv;i+=16){
+   POPCOUNT_CSA(twosA,ones,ones,POPCOUNT_LOAD(0),POPCOUNT_LOAD(1));
+   POPCOUNT_CSA(twosB,ones,ones,POPCOUNT_LOAD(2),POPCOUNT_LOAD(3));
+   POPCOUNT_CSA(foursA,twos,twos,twosA,twosB);
+   POPCOUNT_CSA(twosA,ones,ones,POPCOUNT_LOAD(4),POPCOUNT_LOAD(5));
+   POPCOUNT_CSA(twosB,ones,ones,POPCOUNT_LOAD(6),POPCOUNT_LOAD(7));
+   POPCOUNT_CSA(foursB,twos,twos,twosA,twosB);
+   POPCOUNT_CSA(eightsA,fours,fours,foursA,foursB);
+   POPCOUNT_CSA(twosA,ones,ones,POPCOUNT_LOAD(8),POPCOUNT_LOAD(9));
+   POPCOUNT_CSA(twosB,ones,ones,POPCOUNT_LOAD(10),POPCOUNT_LOAD(11));
+   POPCOUNT_CSA(foursA,twos,twos,twosA,twosB);
+   POPCOUNT_CSA(twosA,ones,ones,POPCOUNT_LOAD(12),POPCOUNT_LOAD(13));
+   POPCOUNT_CSA(twosB,ones,ones,POPCOUNT_LOAD(14),POPCOUNT_LOAD(15));
+   POPCOUNT_CSA(foursB,twos,twos,twosA,twosB);
+   POPCOUNT_CSA(eightsB,fours,fours,foursA,foursB);
+   POPCOUNT_CSA(sixteens,eights,eights,eightsA,eightsB);
+   total = _mm256_add_epi64(total,POPCOUNT_AVX2_QWORDS(sixteens));
+ }
+ total = _mm256_slli_epi64(total,4);
+ total = _mm256_add_epi64(total,_mm256_slli_epi64(POPCOUNT_AVX2_QWORDS(eights),3));
+ total = _mm256_add_epi64(total,_mm256_slli_epi64(POPCOUNT_AVX2_QWORDS(fours),2));
+ total = _mm256_add_epi64(total,_mm256_slli_epi64(POPCOUNT_AVX2_QWORDS(twos),1));
+ total = _mm256_add_epi64(total,POPCOUNT_AVX2_QWORDS(ones));
+ for(;i<nv;i++){
+   d = POPCOUNT_LOAD(0);
+   total = _mm256_add_epi64(total,POPCOUNT_AVX2_QWORDS(d));
+ }
+#undef POPCOUNT_LOAD
+#undef POPCOUNT_AVX2_QWORDS
+
+ _mm256_storeu_si256((__m256i *)sum,total);
+ return sum[0] + sum[1] + sum[2] + sum[3] + popcount_buf_scalar(w + 8*nv,n - 8*nv);
+
+}
+
+__attribute__((target("avx2")))
+static void popcount_words_avx2(const unsigned int *w,unsigned int n,unsigned int *counts)
+{
+
+ unsigned int i;
+ __m256i b;
+ const __m256i one8 = _mm256_set1_epi8(1);
+ const __m256i one16 = _mm256_set1_epi16(1);
+ POPCOUNT_AVX2_TABLES;
+
+ /*
+  * Byte counts, then two horizontal multiply-adds by 1 fold each four
+  * bytes into their 32 bit lane.
+  */
+ for(i=0;i+8<=n;i+=8){
+   b = _mm256_loadu_si256((const __m256i *)(w + i));
+   b = POPCOUNT_AVX2_BYTES(b);
+   b = _mm256_madd_epi16(_mm256_maddubs_epi16(b,one8),one16);
+   _mm256_storeu_si256((__m256i *)(counts + i),b);
+ }
+ popcount_words_scalar(w + i,n - i,counts + i);
+
+}
+
+__attribute__((target("avx2")))
+static void popcount_bytes_avx2(const unsigned char *bytes,unsigned char *counts,
+                                unsigned int n,const unsigned char *map)
+{
+
+ unsigned int i;
+ __m256i b,mtab;
+ unsigned char m[16];
+ POPCOUNT_AVX2_TABLES;
+
+ if(map != NULL){
+   memset(m,0,16);
+   memcpy(m,map,9);
+   mtab = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)m));
+ }
+ for(i=0;i+32<=n;i+=32){
+   b = _mm256_loadu_si256((const __m256i *)(bytes + i));
+   b = POPCOUNT_AVX2_BYTES(b);
+   if(map != NULL) b = _mm256_shuffle_epi8(mtab,b);
+   _mm256_storeu_si256((__m256i *)(counts + i),b);
+ }
+ popcount_bytes_scalar(bytes + i,counts + i,n - i,map);
+
+}
+
+#undef POPCOUNT_CSA
+
+#ifdef POPCOUNT_AVX512
+
+/*
+ *========================================================================
+ * AVX-512
+ *========================================================================
+ */
+__attribute__((target("avx512f,avx512vpopcntdq")))
+static unsigned long long popcount_buf_vpopcnt(const unsigned int *w,unsigned int n)
+{
+
+ unsigned int i;
+ __m512i total = _mm512_setzero_si512();
+
+ for(i=0;i+16<=n;i+=16){
+   total = _mm512_add_epi64(total,_mm512_popcnt_epi64(_mm512_loadu_si512((const void *)(w + i))));
+ }
+ return (unsigned long long) _mm512_reduce_add_epi64(total) + popcount_buf_scalar(w + i,n - i);
+
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq")))
+static void popcount_words_vpopcnt(const unsigned int *w,unsigned int n,unsigned int *counts)
+{
+
+ unsigned int i;
+
+ for(i=0;i+16<=n;i+=16){
+   _mm512_storeu_si512((void *)(counts + i),
+     _mm512_popcnt_epi32(_mm512_loadu_si512((const void *)(w + i))));
+ }
+ popcount_words_scalar(w + i,n - i,counts + i);
+
+}
+
+__attribute__((target("avx512f,avx512bw,avx512bitalg")))
+static void popcount_bytes_bitalg(const unsigned char *bytes,unsigned char *counts,
+                                  unsigned int n,const unsigned char *map)
+{
+
+ unsigned int i;
+ __m512i b,mtab;
+ unsigned char m[16];
+
+ if(map != NULL){
+   memset(m,0,16);
+   memcpy(m,map,9);
+   mtab = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)m));
+ }
+ for(i=0;i+64<=n;i+=64){
+   b = _mm512_popcnt_epi8(_mm512_loadu_si512((const void *)(bytes + i)));
+   if(map != NULL) b = _mm512_shuffle_epi8(mtab,b);
+   _mm512_storeu_si512((void *)(counts + i),b);
+ }
+ popcount_bytes_scalar(bytes + i,counts + i,n - i,map);
+
+}
+
+#endif
+#endif
+
+/*
+ *========================================================================
+ * The API
+ *========================================================================
+ */
+
+/*
+ * Total number of 1 bits in w[0]..w[n-1].
+ */
+unsigned long long popcount_buf(const unsigned int *w,unsigned int n)
+{
+
+ if(popcount_level < 0) popcount_init();
+#ifdef POPCOUNT_AVX2
+#ifdef POPCOUNT_AVX512
+ if(popcount_level == POPCOUNT_HAVE_VPOPCNT) return popcount_buf_vpopcnt(w,n);
+#endif
+ if(popcount_level >= POPCOUNT_HAVE_AVX2) return popcount_buf_avx2(w,n);
+#endif
+ return popcount_buf_scalar(w,n);
+
+}
+
+/*
+ * counts[k] = number of 1 bits in w[k*blen]..w[(k+1)*blen-1] for each
+ * of the n/blen complete blocks in w; any partial block at the end is
+ * ignored.  counts[] has to have room for n entries (it is used for the
+ * per word counts on the way).
+ */
+void popcount_blocks(const unsigned int *w,unsigned int n,unsigned int blen,unsigned int *counts)
+{
+
+ unsigned int i,k,nb,sum;
+
+ if(popcount_level < 0) popcount_init();
+#ifdef POPCOUNT_AVX2
+#ifdef POPCOUNT_AVX512
+ if(popcount_level == POPCOUNT_HAVE_VPOPCNT){
+   popcount_words_vpopcnt(w,n,counts);
+ } else
+#endif
+ if(popcount_level >= POPCOUNT_HAVE_AVX2){
+   popcount_words_avx2(w,n,counts);
+ } else
+#endif
+ popcount_words_scalar(w,n,counts);
+
+ if(blen <= 1) return;
+ nb = n/blen;
+ for(k=0;k<nb;k++){
+   sum = 0;
+   for(i=0;i<blen;i++) sum += counts[k*blen + i];
+   counts[k] = sum;
+ }
+
+}
+
+/*
+ * counts[i] = number of 1 bits in bytes[i], or map[] of that (map has
+ * to have 9 entries, for 0-8 ones) if map isn't NULL.  counts may be
+ * the same as bytes.
+ */
+void popcount_bytes(const unsigned char *bytes,unsigned char *counts,
+                    unsigned int n,const unsigned char *map)
+{
+
+ if(popcount_level < 0) popcount_init();
+#ifdef POPCOUNT_AVX2
+#ifdef POPCOUNT_AVX512
+ if(popcount_bitalg){
+   popcount_bytes_bitalg(bytes,counts,n,map);
+   return;
+ }
+#endif
+ if(popcount_level >= POPCOUNT_HAVE_AVX2){
+   popcount_bytes_avx2(bytes,counts,n,map);
+   return;
+ }
+#endif
+ popcount_bytes_scalar(bytes,counts,n,map);
+
+}
@@ -0,0 +1,292 @@
+/*
+ * See copyright in copyright.h and the accompanying file COPYING
+ */
+
+/*
+ *========================================================================
+ * Streaming p-values (-j bits).  Normally std_test() keeps every
+ * p-value a test makes, psamples (or Xoff) doubles per statistic, and
+ * sorts them for the final KS test.  With -p in the hundreds of
+ * millions that is gigabytes, so in streaming mode the test fills a
+ * fixed PSTREAM_CHUNK of pvalues[] over and over and each chunk is
+ * emptied into a pstream_t instead:  a histogram of the p-values in
+ * nbins = 2^bits equal bins on [0,1), plus the total.  Two sketches
+ * with the same nbins merge by adding their counts.
+ *
+ * The goodness of fit statistics of gof.c all come from the empirical
+ * CDF F_n, and the sketch knows F_n exactly at every bin edge x_k = k/B
+ * (B = nbins) and nothing in between except that it is nondecreasing.
+ * So pstream_gof() computes
+ *
+ *   KS      D, bracketed:  the largest |F_n - x| at the edges is a
+ *           lower bound, and max(F_{k+1} - x_k, x_{k+1} - F_k) over
+ *           the bins an upper one.  The two differ by at most
+ *           1/B + (fullest bin)/n, and we report the p-value of the
+ *           midpoint.
+ *   Kuiper  V = D+ + D-, bracketed the same way.
+ *   CvM     W^2 = n int (F_n - x)^2 dx with F_n replaced by the line
+ *           joining its values at the ends of each bin (which is
+ *           exact where the p-values are spread evenly in the bin).
+ *           Inside bin k the two differ by at most c_k/n, so W^2 is
+ *           off by at most 2 n D/B.
+ *   AD      A^2 = n int (F_n - x)^2/(x(1-x)) dx, the same way.  Away
+ *           from the end bins the error is at most 2 D sum_k c_k w_k,
+ *           w_k the integral of 1/(x(1-x)) over bin k.  The end bins
+ *           carry the weight singularities and the sketch cannot tell a
+ *           p-value of 1e-12 from one of 1/B, so AD's sensitivity to a
+ *           single extreme p-value is lost below 1/B.
+ *
+ * The worst case bounds are attained only when every bin's p-values
+ * are piled up at one of its ends, all on the same side of the line;
+ * for anything resembling uniform deviates the errors are far smaller.
+ * The bounds are printed with -v D_KSTEST.  With 2^18 bins and n = 1e8
+ * D is good to about 4e-6, which is ~0.04 in the sqrt(n) D the KS
+ * p-value depends on.  More bins cost 4 bytes each per statistic.
+ *
+ * Optionally (-J prefix) every exact p-value is also appended, as a raw
+ * native double, to a file that grows through a memory mapping, for
+ * anyone who wants to redo the analysis exactly afterwards.
+ *========================================================================
+ */
+
+/* ftruncate() and mmap() are POSIX, not c99 */
+#define _DEFAULT_SOURCE
+#include <dieharder/libdieharder.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#define PSTREAM_SPILL_MIN 65536
+
+pstream_t *pstream_alloc(unsigned int nbins,const char *spill)
+{
+
+ pstream_t *ps;
+
+ ps = (pstream_t *)malloc(sizeof(pstream_t));
+ ps->nbins = nbins;
+ ps->count = (unsigned int *)malloc((size_t)nbins*sizeof(unsigned int));
+ ps->spill_fd = -1;
+ ps->spill = NULL;
+ ps->spill_cap = 0;
+ if(spill != NULL && spill[0] != 0){
+   ps->spill_fd = open(spill,O_RDWR | O_CREAT | O_TRUNC,0644);
+   if(ps->spill_fd < 0){
+     fprintf(stderr,"Warning:  cannot open p-value spill file %s.\n",spill);
+   }
+ }
+ pstream_clear(ps);
+ return ps;
+
+}
+
+static void pstream_unmap(pstream_t *ps)
+{
+
+ if(ps->spill != NULL){
+   munmap(ps->spill,ps->spill_cap*sizeof(double));
+   ps->spill = NULL;
+ }
+
+}
+
+void pstream_free(pstream_t *ps)
+{
+
+ if(ps == NULL) return;
+ if(ps->spill_fd >= 0){
+   pstream_unmap(ps);
+   /* Trim the file to what was actually written */
+   if(ftruncate(ps->spill_fd,(off_t)ps->spill_n*sizeof(double)) != 0){
+     fprintf(stderr,"Warning:  cannot trim p-value spill file.\n");
+   }
+   close(ps->spill_fd);
+ }
+ nullfree(ps->count);
+ free(ps);
+
+}
+
+/*
+ * Empty the sketch.  The spill file starts over too.
+ */
+void pstream_clear(pstream_t *ps)
+{
+
+ memset(ps->count,0,(size_t)ps->nbins*sizeof(unsigned int));
+ ps->n = 0;
+ ps->spill_n = 0;
+
+}
+
+/*
+ * Make room for at least need doubles in the spill mapping, doubling
+ * the file as it fills.  If anything fails spilling is turned off (the
+ * sketch itself doesn't need it).
+ */
+static int pstream_spill_grow(pstream_t *ps,size_t need)
+{
+
+ size_t cap;
+ void *map;
+
+ if(need <= ps->spill_cap) return 0;
+ cap = ps->spill_cap ? ps->spill_cap : PSTREAM_SPILL_MIN;
+ while(cap < need) cap *= 2;
+ pstream_unmap(ps);
+ map = MAP_FAILED;
+ if(ftruncate(ps->spill_fd,(off_t)cap*sizeof(double)) == 0){
+   map = mmap(NULL,cap*sizeof(double),PROT_READ | PROT_WRITE,MAP_SHARED,ps->spill_fd,0);
+ }
+ if(map == MAP_FAILED){
+   fprintf(stderr,"Warning:  cannot grow p-value spill file, spilling stopped.\n");
+   if(ftruncate(ps->spill_fd,(off_t)ps->spill_n*sizeof(double)) != 0){
+     /* Nothing more we can do */
+   }
+   close(ps->spill_fd);
+   ps->spill_fd = -1;
+   ps->spill_cap = 0;
+   return -1;
+ }
+ ps->spill = (double *)map;
+ ps->spill_cap = cap;
+ return 0;
+
+}
+
+/*
+ * Add p[0]..p[n-1].  Anything outside [0,1) lands in the end bins, as
+ * a p-value of exactly 1.0 should; NaNs count as 0.
+ */
+void pstream_add(pstream_t *ps,const double *p,unsigned int n)
+{
+
+ unsigned int i,k,nbins = ps->nbins;
+ double x,scale = (double) nbins;
+
+ for(i=0;i<n;i++){
+   x = p[i]*scale;
+   if(x >= scale){
+     k = nbins - 1;
+   } else if(x >= 0.0){
+     k = (unsigned int) x;
+   } else {
+     k = 0;
+   }
+   ps->count[k]++;
+ }
+ ps->n += n;
+
+ if(ps->spill_fd >= 0 && pstream_spill_grow(ps,ps->spill_n + n) == 0){
+   memcpy(ps->spill + ps->spill_n,p,(size_t)n*sizeof(double));
+   ps->spill_n += n;
+ }
+
+}
+
+/*
+ * Add the counts of from to ps.  Returns -1 (and does nothing) if the
+ * two don't have the same bins.  Spilled values are not merged.
+ */
+int pstream_merge(pstream_t *ps,const pstream_t *from)
+{
+
+ unsigned int k;
+
+ if(ps->nbins != from->nbins) return -1;
+ for(k=0;k<ps->nbins;k++) ps->count[k] += from->count[k];
+ ps->n += from->n;
+ return 0;
+
+}
+
+/*
+ * bin[0..nb-1] = the counts in nb equal bins, for output_histogram().
+ * Each sketch bin goes wherever its left edge is.
+ */
+void pstream_bins(const pstream_t *ps,unsigned int nb,unsigned int *bin)
+{
+
+ unsigned int j,k;
+
+ for(j=0;j<nb;j++) bin[j] = 0;
+ for(k=0;k<ps->nbins;k++){
+   bin[(unsigned int)(((unsigned long long)k*nb)/ps->nbins)] += ps->count[k];
+ }
+
+}
+
+/*
+ * gof[GOF_KS..GOF_CVM] from the sketch, as described above.
+ */
+void pstream_gof(const pstream_t *ps,double *gof)
+{
+
+ unsigned int i,k,nbins = ps->nbins;
+ double n,h,f0,f1,x0,x1,e0,e1,e,x,c;
+ double dlo,dhi,plo,phi,mlo,mhi,d,v,w2,a2,a2err;
+ /* 3 point Gauss-Legendre on [0,1] */
+ static const double gx[3] = {0.1127016653792583,0.5,0.8872983346207417};
+ static const double gw[3] = {5.0/18.0,8.0/18.0,5.0/18.0};
+
+ if(ps->n == 0){
+   for(i=0;i<GOF_N;i++) gof[i] = -1.0;
+   return;
+ }
+
+ n = (double) ps->n;
+ h = 1.0/nbins;
+ dlo = dhi = 0.0;
+ plo = phi = 0.0;      /* D+ = max(F_n - x) */
+ mlo = mhi = 0.0;      /* D- = max(x - F_n) */
+ w2 = a2 = a2err = 0.0;
+ c = 0.0;
+ f0 = 0.0;
+ for(k=0;k<nbins;k++){
+   c += ps->count[k];
+   x0 = k*h;
+   x1 = (k + 1)*h;
+   f1 = c/n;
+
+   /* The brackets, from the right edge and across the bin */
+   e1 = f1 - x1;
+   if(e1 > plo) plo = e1;
+   if(-e1 > mlo) mlo = -e1;
+   if(f1 - x0 > phi) phi = f1 - x0;
+   if(x1 - f0 > mhi) mhi = x1 - f0;
+
+   /* W^2 and A^2 with F_n linear across the bin */
+   e0 = f0 - x0;
+   w2 += h*(e0*e0 + e0*e1 + e1*e1)/3.0;
+   for(i=0;i<3;i++){
+     e = e0 + (e1 - e0)*gx[i];
+     x = x0 + h*gx[i];
+     a2 += gw[i]*h*e*e/(x*(1.0 - x));
+   }
+   if(k > 0 && k < nbins - 1){
+     a2err += (f1 - f0)*(log(x1/x0) + log((1.0 - x0)/(1.0 - x1)));
+   }
+   f0 = f1;
+ }
+ dlo = (plo > mlo) ? plo : mlo;
+ dhi = (phi > mhi) ? phi : mhi;
+ d = 0.5*(dlo + dhi);
+ v = 0.5*(plo + mlo + phi + mhi);
+ w2 *= n;
+ a2 *= n;
+ a2err *= 2.0*n*dhi;
+
+ gof[GOF_KS] = kstest_dmax_pvalue(ps->n,d);
+ gof[GOF_KUIPER] = kstest_kuiper_v_pvalue(ps->n,v);
+ gof[GOF_AD] = ad_pvalue(ps->n,a2);
+ gof[GOF_CVM] = cvm_pvalue(ps->n,w2);
+
+ MYDEBUG(D_KSTEST){
+   printf("# pstream_gof(): n = %u  bins = %u\n",ps->n,nbins);
+   printf("# pstream_gof(): D in [%g,%g]  V in [%g,%g]\n",dlo,dhi,plo + mlo,phi + mhi);
+   printf("# pstream_gof(): W^2 = %f +/- %g  A^2 = %f +/- %g (interior bins)\n",
+          w2,2.0*n*dhi*h,a2,a2err);
+   printf("# pstream_gof(): p = %10.8f (KS) %10.8f (Kuiper) %10.8f (AD) %10.8f (CvM)\n",
+          gof[GOF_KS],gof[GOF_KUIPER],gof[GOF_AD],gof[GOF_CVM]);
+ }
+
+}
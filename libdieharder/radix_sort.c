@@ -0,0 +1,244 @@
+/*
+ * See copyright in copyright.h and the accompanying file COPYING
+ */
+
+/*
+ *========================================================================
+ * LSD radix sorts for the places where a statistic needs its numbers
+ * in order:  kstest() and friends sort every p-value they are handed,
+ * diehard_birthdays sorts its birthdays and then their spacings for
+ * every sample, the minimum distance tests sort all of their points.  GSL's
+ * sorts are heapsorts, which hop all over memory and compare their way
+ * to O(n log n).  Here we make one pass to histogram every byte of the
+ * keys at once, then one stable scatter per byte -- skipping any byte
+ * that is the same in every key, like the top byte of a 24 bit
+ * birthday or most of the exponent of a p-value.
+ *
+ *   radix_sort_uint()          unsigned ints.
+ *   radix_sort_double()        doubles.  Any doubles sort correctly
+ *                              (NaNs excepted); p-values in [0,1] are
+ *                              just the case we care about.
+ *   radix_sort_double_index()  doubles, carrying an index array along
+ *                              so the caller can reorder whatever the
+ *                              keys came from.
+ *   radix_sort_dtuple()        dTuple points, on their first coordinate
+ *                              (the minimum distance tests).
+ *
+ * scratch (and iscratch) must hold n entries of the same type.  Callers
+ * that sort over and over can allocate them once and pass them in;
+ * NULL makes the routine allocate and free its own.  Short arrays are
+ * insertion sorted, as a radix sort doesn't pay for its histograms
+ * until there are a few dozen keys.
+ *========================================================================
+ */
+
+#include <dieharder/libdieharder.h>
+
+#define RADIX_SMALL 48
+
+/*
+ * Turn count[b][256] into starting offsets, and return a mask of the
+ * bytes that actually need a pass (those where not every key has the
+ * same digit).
+ */
+static unsigned int radix_offsets(unsigned int (*count)[256],unsigned int nbytes,unsigned int n)
+{
+
+ unsigned int b,d,sum,c,need = 0;
+
+ for(b=0;b<nbytes;b++){
+   sum = 0;
+   for(d=0;d<256;d++){
+     c = count[b][d];
+     if(c == n) break;
+     count[b][d] = sum;
+     sum += c;
+   }
+   if(d == 256) need |= 1u << b;
+ }
+ return need;
+
+}
+
+void radix_sort_uint(unsigned int *a,unsigned int n,unsigned int *scratch)
+{
+
+ unsigned int i,j,b,x,need;
+ unsigned int count[4][256];
+ unsigned int *src,*dst,*tmp,*mine = NULL;
+
+ if(n < RADIX_SMALL){
+   for(i=1;i<n;i++){
+     x = a[i];
+     for(j=i;j>0 && a[j-1] > x;j--) a[j] = a[j-1];
+     a[j] = x;
+   }
+   return;
+ }
+ if(scratch == NULL) scratch = mine = (unsigned int *)malloc(n*sizeof(unsigned int));
+
+ memset(count,0,sizeof(count));
+ for(i=0;i<n;i++){
+   x = a[i];
+   count[0][x & 0xff]++;
+   count[1][(x >> 8) & 0xff]++;
+   count[2][(x >> 16) & 0xff]++;
+   count[3][x >> 24]++;
+ }
+ need = radix_offsets(count,4,n);
+
+ src = a;
+ dst = scratch;
+ for(b=0;b<4;b++){
+   if(!(need & (1u << b))) continue;
+   for(i=0;i<n;i++){
+     x = src[i];
+     dst[count[b][(x >> (8*b)) & 0xff]++] = x;
+   }
+   tmp = src; src = dst; dst = tmp;
+ }
+ if(src != a) memcpy(a,src,n*sizeof(unsigned int));
+ nullfree(mine);
+
+}
+
+/*
+ * The bits of a double, flipped so that they compare as unsigned
+ * integers in the same order as the doubles:  positive numbers get the
+ * sign bit set, negative ones get every bit inverted.
+ */
+static inline unsigned long long radix_key(double x)
+{
+
+ unsigned long long u;
+
+ memcpy(&u,&x,sizeof(u));
+ return (u & 0x8000000000000000ull) ? ~u : (u | 0x8000000000000000ull);
+
+}
+
+/*
+ * The doubles themselves are moved pass to pass (the key is cheap to
+ * recompute), so the callers' arrays stay arrays of doubles.
+ */
+static void radix_sort_double_core(double *a,unsigned int *index,unsigned int n,
+                                   double *scratch,unsigned int *iscratch)
+{
+
+ unsigned int i,b,k,need;
+ unsigned int count[8][256];
+ unsigned long long x;
+ double *src,*dst,*tmp;
+ unsigned int *isrc,*idst,*itmp;
+
+ memset(count,0,sizeof(count));
+ for(i=0;i<n;i++){
+   x = radix_key(a[i]);
+   for(b=0;b<8;b++) count[b][(x >> (8*b)) & 0xff]++;
+ }
+ need = radix_offsets(count,8,n);
+
+ src = a;
+ dst = scratch;
+ isrc = index;
+ idst = iscratch;
+ for(b=0;b<8;b++){
+   if(!(need & (1u << b))) continue;
+   if(index == NULL){
+     for(i=0;i<n;i++){
+       k = count[b][(radix_key(src[i]) >> (8*b)) & 0xff]++;
+       dst[k] = src[i];
+     }
+   } else {
+     for(i=0;i<n;i++){
+       k = count[b][(radix_key(src[i]) >> (8*b)) & 0xff]++;
+       dst[k] = src[i];
+       idst[k] = isrc[i];
+     }
+     itmp = isrc; isrc = idst; idst = itmp;
+   }
+   tmp = src; src = dst; dst = tmp;
+ }
+ if(src != a){
+   memcpy(a,src,n*sizeof(double));
+   if(index != NULL) memcpy(index,isrc,n*sizeof(unsigned int));
+ }
+
+}
+
+void radix_sort_double(double *a,unsigned int n,double *scratch)
+{
+
+ unsigned int i,j;
+ double x,*mine = NULL;
+
+ if(n < RADIX_SMALL){
+   for(i=1;i<n;i++){
+     x = a[i];
+     for(j=i;j>0 && a[j-1] > x;j--) a[j] = a[j-1];
+     a[j] = x;
+   }
+   return;
+ }
+ if(scratch == NULL) scratch = mine = (double *)malloc(n*sizeof(double));
+ radix_sort_double_core(a,NULL,n,scratch,NULL);
+ nullfree(mine);
+
+}
+
+void radix_sort_double_index(double *a,unsigned int *index,unsigned int n,
+                             double *scratch,unsigned int *iscratch)
+{
+
+ unsigned int i,j,xi;
+ double x,*mine = NULL;
+ unsigned int *imine = NULL;
+
+ if(n < RADIX_SMALL){
+   for(i=1;i<n;i++){
+     x = a[i];
+     xi = index[i];
+     for(j=i;j>0 && a[j-1] > x;j--){
+       a[j] = a[j-1];
+       index[j] = index[j-1];
+     }
+     a[j] = x;
+     index[j] = xi;
+   }
+   return;
+ }
+ if(scratch == NULL) scratch = mine = (double *)malloc(n*sizeof(double));
+ if(iscratch == NULL) iscratch = imine = (unsigned int *)malloc(n*sizeof(unsigned int));
+ radix_sort_double_core(a,index,n,scratch,iscratch);
+ nullfree(mine);
+ nullfree(imine);
+
+}
+
+/*
+ * Sort points[] on their first coordinate, for the minimum distance
+ * tests.  The tuples are big, so we sort the first coordinates with an
+ * index and move each tuple just once, at the end.
+ */
+void radix_sort_dtuple(dTuple *points,unsigned int n)
+{
+
+ unsigned int i,*index;
+ double *keys;
+ dTuple *sorted;
+
+ keys = (double *)malloc(n*sizeof(double));
+ index = (unsigned int *)malloc(n*sizeof(unsigned int));
+ for(i=0;i<n;i++){
+   keys[i] = points[i].c[0];
+   index[i] = i;
+ }
+ radix_sort_double_index(keys,index,n,NULL,NULL);
+ sorted = (dTuple *)malloc(n*sizeof(dTuple));
+ for(i=0;i<n;i++) sorted[i] = points[index[i]];
+ memcpy(points,sorted,n*sizeof(dTuple));
+ nullfree(sorted);
+ nullfree(keys);
+ nullfree(index);
+
+}
@@ -0,0 +1,134 @@
+/*
+ * See copyright in copyright.h and the accompanying file COPYING
+ */
+
+/*
+ *========================================================================
+ *                      RGB Autocorrelation Test
+ *
+ * rgb_lagged_sums tests one lag per run, and run_all_tests() used to
+ * sweep it over lags 0-32 -- 33 complete runs, each generating its own
+ * stream plus everything it skips.  Here we test every lag 1..L against
+ * a single stream of n uniforms.  With y_i = u_i - 1/2 the lagged
+ * products
+ *
+ *   r_k = sum_{i=0}^{n-1-k} y_i y_{i+k}
+ *
+ * are the (linear) autocorrelation of y, which is the inverse FFT of
+ * its power spectrum provided we zero pad y out to N >= n + L so the
+ * circular correlation doesn't wrap around.  That is two radix 2 real
+ * FFTs of length N -- O(N log N) for all L lags, instead of O(n L).
+ *
+ * Under the null hypothesis each r_k is a sum of n-k products with mean
+ * 0 and variance 1/144, and no two products (for any pair of lags)
+ * are correlated, so z_k = 12 r_k/sqrt(n-k) are L very nearly
+ * independent standard normals.  From these we make:
+ *
+ *   test[0]:  chisq = sum_k z_k^2 with L degrees of freedom.
+ *   test[1]:  the smallest two-sided per-lag p-value, corrected for
+ *             having looked at L of them, 1 - (1 - p_min)^L.
+ *
+ * Per-lag p-values are printed in verbose mode.
+ *========================================================================
+ */
+
+#include <dieharder/libdieharder.h>
+#include <gsl/gsl_fft_real.h>
+#include <gsl/gsl_fft_halfcomplex.h>
+
+int rgb_autocorr(Test **test,int irun, random_generator_t *cur_rng)
+{
+
+ uint i,k,n,lags,nfft;
+ double *y,re,im,z,chisq,p,pmin;
+ uint kmin;
+
+ /*
+  * n is the length of the sequence, lags the number of lags tested.
+  * We need at least as many products as lags for the normal
+  * approximation to make any sense.
+  */
+ n = test[0]->tsamples;
+ lags = (test[0]->ntuple_cl == 0) ? 1024 : test[0]->ntuple_cl;
+ if(lags > n/2) lags = n/2;
+ if(lags < 1) lags = 1;
+ test[0]->ntuple = lags;
+ test[1]->ntuple = lags;
+
+ nfft = 1;
+ while(nfft < n + lags) nfft <<= 1;
+
+ MYDEBUG(D_RGB_AUTOCORR){
+   printf("# rgb_autocorr(): n = %u, lags = %u, fft length = %u\n",n,lags,nfft);
+ }
+
+ /*
+  * Fill y with the centered uniforms and zero pad it.
+  */
+ y = (double *)malloc((size_t)nfft*sizeof(double));
+ get_rand_uniform_block(y,n,0,cur_rng);
+ for(i=0;i<n;i++) y[i] -= 0.5;
+ memset(&y[n],0,(size_t)(nfft - n)*sizeof(double));
+
+ /*
+  * Forward transform to halfcomplex order (y[0] and y[nfft/2] are the
+  * purely real DC and Nyquist terms, y[k] and y[nfft-k] the real and
+  * imaginary parts of term k), replace each term by its squared
+  * modulus and transform back.  The inverse includes the 1/nfft, so
+  * y[k] is then r_k.
+  */
+ gsl_fft_real_radix2_transform(y,1,nfft);
+ y[0] = y[0]*y[0];
+ y[nfft/2] = y[nfft/2]*y[nfft/2];
+ for(k=1;k<nfft/2;k++){
+   re = y[k];
+   im = y[nfft - k];
+   y[k] = re*re + im*im;
+   y[nfft - k] = 0.0;
+ }
+ gsl_fft_halfcomplex_radix2_inverse(y,1,nfft);
+
+ chisq = 0.0;
+ pmin = 1.0;
+ kmin = 1;
+ for(k=1;k<=lags;k++){
+   z = 12.0*y[k]/sqrt((double)(n - k));
+   chisq += z*z;
+   p = erfc(fabs(z)/sqrt(2.0));
+   if(p < pmin){
+     pmin = p;
+     kmin = k;
+   }
+   MYDEBUG(D_RGB_AUTOCORR){
+     printf("# rgb_autocorr(): lag %5u  r = %12.4f  z = %8.4f  p = %10.8f\n",k,y[k],z,p);
+   }
+ }
+
+ nullfree(y);
+
+ test[0]->st_values[irun] = chisq;
+ test[0]->pvalues[irun] = gsl_sf_gamma_inc_Q((double)lags/2.0,chisq/2.0);
+
+ /*
+  * 1 - (1 - pmin)^lags without losing pmin to roundoff when it is tiny.
+  */
+ test[1]->st_values[irun] = pmin;
+ test[1]->pvalues[irun] = -expm1((double)lags*log1p(-pmin));
+
+ MYDEBUG(D_RGB_AUTOCORR){
+   printf("# rgb_autocorr(): chisq = %f for %u lags, p = %10.8f\n",
+          chisq,lags,test[0]->pvalues[irun]);
+   printf("# rgb_autocorr(): most extreme lag %u has p = %10.8f, corrected p = %10.8f\n",
+          kmin,pmin,test[1]->pvalues[irun]);
+ }
+
+ return(0);
+
+}
+
+void help_rgb_autocorr()
+{
+
+  printf("%s",rgb_autocorr_dtest.description);
+
+}
@@ -66,14 +66,14 @@ int rgb_bitdist(Test **test,int irun, random_generator_t *cur_rng)
  uint nb;          /* number of bits in a tested ntuple */
  uint value_max;   /* 2^{nb}, basically (max size of nb bit word + 1) */
  uint bsamples;    /* The number of non-overlapping samples in buffer */
- uint value;       /* value of sampled ntuple (as a uint) */
- uint mask;
+ uint *value;      /* values of the bsamples sampled ntuples (as uints) */
 
  /* Look for cruft below */
 
  uint b,t,i;   /* loop indices? */
  uint ri;
  uint *count,ctotal; /* count of any ntuple per bitstring */
+ multihist_t *hist;
 
  double ntuple_prob,pbin;  /* probabilities */
  Vtest *vtest;               /* A reusable vector of binomial test bins */
@@ -81,12 +81,12 @@ int rgb_bitdist(Test **test,int irun, random_generator_t *cur_rng)
  /*
   * Sample a bitstring ntuple in length (exactly).
   */
- if(ntuple>0){
+ if(test[0]->ntuple_cl>0){
    /*
     * Set test[0]->ntuple to pass back to output()
     */
-   test[0]->ntuple = ntuple;
-   nb = ntuple;
+   test[0]->ntuple = test[0]->ntuple_cl;
+   nb = test[0]->ntuple_cl;
    MYDEBUG(D_RGB_BITDIST){
      printf("# rgb_bitdist: Testing ntuple = %u\n",nb);
    }
@@ -126,7 +126,8 @@ int rgb_bitdist(Test **test,int irun, random_generator_t *cur_rng)
   * or leak.
   */
  vtest = (Vtest *)malloc(value_max*sizeof(Vtest));
- count = (uint *)malloc(value_max*sizeof(uint));
+ value = (uint *)malloc(bsamples*sizeof(uint));
+ count = (uint *)malloc(bsamples*sizeof(uint));
 
  /*
   * This is the probability of getting any given ntuple.  For example,
@@ -144,22 +145,6 @@ int rgb_bitdist(Test **test,int irun, random_generator_t *cur_rng)
    
  tsamples = test[0]->tsamples;
 
- /*
-  * Set the mask for bits to be returned.  I think that I want to
-  * change routines here over to the sliding window routine.
-  *
-  * The following mask will work OK, but John says that it won't
-  * work unless nb != CHAR_BIT*sizeof(uint), so the loop is a bit
-  * more robust.
-  *
-  *  mask = ((1u << nb) - 1);
-  */
- mask = 0;
- for(i = 0; i < nb; i++){
-   mask |= (1u << nb);
- }
- mask = ((1u << nb) - 1);
-
  /*
   * OK, I'm getting to where I think I can manage to fix this test once
   * and for all.  I want to make this test evaluate a counter:
@@ -223,52 +208,49 @@ int rgb_bitdist(Test **test,int irun, random_generator_t *cur_rng)
   * with the bitcount as an index as a trial that generated that
   * bitcount.
   */
- memset(count,0,value_max*sizeof(uint));
+ hist = multihist_alloc(value_max);
  for(t=0;t<tsamples;t++){
 
    /*
-    * Clear the count vector for this sample.
+    * This gets the integer values of the next bsamples ntuples of length
+    * nb that are available in the bitstream provided by the generator,
+    * without skipping bits.
     */
-    
-   for(b=0;b<bsamples;b++){
-
-     /*
-      * This gets the integer value of the ntuple of length nb that is the
-      * next available in the bitstream provided by the generator, without
-      * skipping bits.  Then increment the count of this ntuple value's
-      * occurrence out of bsamples tries.
-      */
-     value = get_rand_bits_uint (nb, mask, cur_rng, 0);
-     count[value]++;
-
-     MYDEBUG(D_RGB_BITDIST) {
-       printf("# rgb_bitdist():b=%u count[%u] = %u\n",b,value,count[value]);
+   get_rand_bits_uint_block(value,bsamples,nb,cur_rng);
+   MYDEBUG(D_RGB_BITDIST) {
+     for(b=0;b<bsamples;b++){
+       printf("# rgb_bitdist():b=%u value = %u\n",b,value[b]);
      }
-
    }
 
    /*
+    * Count the occurrences of each ntuple value out of the bsamples
+    * tries, then pull the counts back out (which clears them for the
+    * next sample).  Draining by the values we saw rather than sweeping
+    * all value_max counts keeps large nb cheap:  count[b] is the count
+    * of value[b] the first time it appears and 0 for repeats.
+    *
     * We now increment the CUMULATIVE counter -- vtest -- so we can
     * compare the result to the expected value when we're done.
     */
+   multihist_add_u32(hist,value,bsamples);
+   multihist_drain_u32(hist,value,bsamples,count);
    ctotal = 0;
-   for(i=0;i<value_max;i++){
-      uint count_i = count[i];
-      if (count_i)
-	{
-	   count[i] = 0;		       /* performs memset */
-	   ctotal += count_i;
-	   vtest[i].x[count_i]++;
-	   vtest[i].x[0]--;
-	}
-      MYDEBUG(D_RGB_BITDIST){
-	 printf("# rgb_bitdist(): vtest[%u].x[%u] = %u\n",i,count[i],(uint)vtest[i].x[count[i]]);
+   for(b=0;b<bsamples;b++){
+     if(count[b]){
+       ctotal += count[b];
+       vtest[value[b]].x[count[b]]++;
+       vtest[value[b]].x[0]--;
+       MYDEBUG(D_RGB_BITDIST){
+         printf("# rgb_bitdist(): vtest[%u].x[%u] = %u\n",value[b],count[b],(uint)vtest[value[b]].x[count[b]]);
+       }
      }
    }
    MYDEBUG(D_RGB_BITDIST){
      printf("# rgb_bitdist(): Sample %u: total count = %u (should be %u, count of bits)\n",t,ctotal,bits);
    }
  }
+ multihist_free(hist);
 
  /*
   * Now, finally, we need to score the vtest for this value of nb
@@ -283,7 +265,7 @@ int rgb_bitdist(Test **test,int irun, random_generator_t *cur_rng)
    printf("# rgb_bitdist():            vtest table\n");
    printf("# rgb_bitdist(): Outcome   bit          x           y       sigma\n");
  }
- ri = gsl_rng_uniform_int(cur_rng->rng,value_max);
+ ri = get_rand_bounded(value_max,cur_rng);
  for(i=0;i<value_max;i++){
    for(b=0;b<=bsamples;b++){
      MYDEBUG(D_RGB_BITDIST){
@@ -324,6 +306,7 @@ int rgb_bitdist(Test **test,int irun, random_generator_t *cur_rng)
    Vtest_destroy(&vtest[i]);
  }
 
+ free(value);
  free(count);
  free(vtest);
  
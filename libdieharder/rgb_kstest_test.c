@@ -39,22 +39,20 @@ int rgb_kstest_test(Test **test, int irun, random_generator_t *cur_rng)
 {
 
  uint t,tsamples;
- double *testvec;
+ double *testvec,*scratch;
 
+ /* scratch, the second half of testvec, is for the sort in kstest(). */
  tsamples = test[0]->tsamples;
- testvec = (double *)malloc(tsamples*sizeof(double));
+ testvec = (double *)malloc(2*tsamples*sizeof(double));
+ scratch = testvec + tsamples;
 
  if(verbose == D_RGB_KSTEST_TEST || verbose == D_ALL){
      printf("Generating a vector of %u uniform deviates.\n",test[0]->tsamples);
  }
- for(t=0;t<tsamples;t++){
-
-   /*
-    * Generate and (conditionally) print out a point.
-    */
-   testvec[t] = gsl_rng_uniform_pos(cur_rng->rng);
-   if(verbose == D_RGB_KSTEST_TEST || verbose == D_ALL){
-       printf("testvec[%u] = %f",t,testvec[t]);
+ get_rand_uniform_block(testvec,tsamples,1,cur_rng);
+ if(verbose == D_RGB_KSTEST_TEST || verbose == D_ALL){
+   for(t=0;t<tsamples;t++){
+     printf("testvec[%u] = %f",t,testvec[t]);
    }
  }
 
@@ -63,12 +61,12 @@ int rgb_kstest_test(Test **test, int irun, random_generator_t *cur_rng)
     * This (Kuiper) can be selected with -k 3 from the command line.
     * All other values test variants of the regular kstest().
     */
-   test[0]->pvalues[irun] = kstest_kuiper(testvec,tsamples);
+   test[0]->pvalues[irun] = kstest_kuiper(testvec,tsamples,scratch);
  } else {
    /*
     * This (Symmetrized KS) is -k 0,1,2.  Default is 0.
     */
-   test[0]->pvalues[irun] = kstest(testvec,tsamples);
+   test[0]->pvalues[irun] = kstest(testvec,tsamples,scratch);
  }
 
  test[0]->st_values[irun] = test[0]->pvalues[irun];
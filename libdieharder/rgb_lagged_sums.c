@@ -37,17 +37,23 @@
 
 #include <dieharder/libdieharder.h>
 
+/*
+ * Number of uniforms generated per block.
+ */
+#define LAGGED_SUMS_BLOCK 16384
+
 int rgb_lagged_sums(Test **test,int irun, random_generator_t *cur_rng)
 {
 
- uint t,i,lag;
+ uint t,i,n,lag;
+ double u,*block;
  Xtest ptest;
 
  /*
   * Get the lag from ntuple.  Note that a lag of zero means
   * "don't throw any away".
   */
- test[0]->ntuple = ntuple;
+ test[0]->ntuple = test[0]->ntuple_cl;
  lag = test[0]->ntuple;
 
  /*
@@ -63,19 +69,33 @@ int rgb_lagged_sums(Test **test,int irun, random_generator_t *cur_rng)
    printf("# rgb_lagged_sums(): Doing a test with lag %u\n",lag);
  }
 
- for(t=0;t<test[0]->tsamples;t++){
-
-   /*
-    * A VERY SIMPLE test, but sufficient to demonstrate the
-    * weaknesses in e.g. mt19937.
-    */
-
-   /* Throw away lag per sample */
-   for(i=0;i<lag;i++) gsl_rng_uniform(cur_rng->rng);
-
-   /* sample only every lag numbers, reset counter */
-   ptest.x += gsl_rng_uniform(cur_rng->rng);
-
+ /*
+  * A VERY SIMPLE test, but sufficient to demonstrate the
+  * weaknesses in e.g. mt19937.  Each sample throws away lag rands
+  * and keeps the next one.  With no lag we generate the uniforms a
+  * block at a time.  Otherwise rng_discard() skips the lag -- by
+  * jumping the generator or seeking the file where it can -- and we
+  * only generate the uniforms we actually sum.
+  */
+ if(lag == 0){
+   block = (double *)malloc(LAGGED_SUMS_BLOCK*sizeof(double));
+   for(t=0;t<test[0]->tsamples;t+=n){
+     n = test[0]->tsamples - t;
+     if(n > LAGGED_SUMS_BLOCK) n = LAGGED_SUMS_BLOCK;
+     get_rand_uniform_block(block,n,0,cur_rng);
+     for(i=0;i<n;i++){
+       ptest.x += block[i];
+     }
+   }
+   nullfree(block);
+ } else {
+   for(t=0;t<test[0]->tsamples;t++){
+     /* Throw away lag per sample */
+     rng_discard(cur_rng->rng,lag);
+     /* sample only every lag numbers */
+     get_rand_uniform_block(&u,1,0,cur_rng);
+     ptest.x += u;
+   }
  }
 
  test[0]->st_values[irun] = ptest.x;
@@ -77,6 +77,7 @@ int rgb_minimum_distance(Test **test, int irun, random_generator_t *cur_rng)
   * the straightforward N^2 algorithm, but we'll see.
   */
  dTuple *points;
+ double *coords;
  double earg,qarg,dist,mindist,dvolume;
 
  rgb_mindist_avg = 0.0;
@@ -106,23 +107,24 @@ int rgb_minimum_distance(Test **test, int irun, random_generator_t *cur_rng)
   * Set this for output.  ntuple should be set from the CLI or from
   * -a(ll) (run_all_tests()).
   */
- test[0]->ntuple = ntuple;
+ test[0]->ntuple = test[0]->ntuple_cl;
  rgb_md_dim = test[0]->ntuple;
 
  if(verbose == D_RGB_MINIMUM_DISTANCE || verbose == D_ALL){
      printf("Generating a list of %u points in %d dimensions\n",test[0]->tsamples,rgb_md_dim);
  }
+ /*
+  * Generate the d-dimensional points in the unit d-cube (with
+  * periodic boundary conditions), all of the coordinates in one block.
+  */
+ coords = (double *)malloc(test[0]->tsamples*rgb_md_dim*sizeof(double));
+ get_rand_uniform_block(coords,test[0]->tsamples*rgb_md_dim,1,cur_rng);
  for(t=0;t<test[0]->tsamples;t++){
-
-   /*
-    * Generate a new d-dimensional point in the unit d-cube (with
-    * periodic boundary conditions).
-    */
    if(verbose == D_RGB_MINIMUM_DISTANCE || verbose == D_ALL){
        printf("points[%u]: (",t);
    }
    for(d=0;d<rgb_md_dim;d++) {
-     points[t].c[d] = gsl_rng_uniform_pos(cur_rng->rng);
+     points[t].c[d] = coords[t*rgb_md_dim + d];
      if(verbose == D_RGB_MINIMUM_DISTANCE || verbose == D_ALL){
        printf("%6.4f",points[t].c[d]);
        if(d == rgb_md_dim - 1){
@@ -133,15 +135,13 @@ int rgb_minimum_distance(Test **test, int irun, random_generator_t *cur_rng)
      }
    }
  }
+ nullfree(coords);
 
  /*
-  * Now we sort the points using gsl_heapsort and a comparator
-  * on the first coordinate only.  Don't know how to get rid
-  * of the gcc prototype warning.  Probably need a cast of some
-  * sort.
+  * Now we sort the points on the first coordinate only (a radix
+  * sort, see radix_sort.c).
   */
- gsl_heapsort(points,test[0]->tsamples,sizeof(dTuple),
-                    (gsl_comparison_fn_t) compare_points);
+ radix_sort_dtuple(points,test[0]->tsamples);
 
  if(verbose == D_RGB_MINIMUM_DISTANCE || verbose == D_ALL){
    printf("List of points sorted by first coordinate:\n");
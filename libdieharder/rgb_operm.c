@@ -35,6 +35,7 @@
  */
 
 #include <dieharder/libdieharder.h>
+#include <float.h>
 #define RGB_OPERM_KMAX 10
 
 /*
@@ -44,11 +45,34 @@
 double fpipi(int pi1,int pi2,int nkp);
 uint piperm(size_t *data,int len);
 void make_cexact();
+void make_ceinv();
+void get_cexact();
 void make_cexpt(gsl_rng *rng);
 int nperms,noperms;
 double **cexact,**ceinv,**cexpt,**idty;
 double *cvexact,*cvein,*cvexpt,*vidty;
 
+/*
+ * cexact[][] and its pseudo-inverse ceinv[][] depend ONLY on rgb_operm_k,
+ * never on the rng or the data, but building them means iterating over
+ * all (3k-2)! overlapping permutations (and then diagonalizing a
+ * k! x k! matrix).  That is tolerable for k = 2,3,4 and hopeless for
+ * k >= 5 if it is redone for every psample.  So we build them at most
+ * once per k per process and keep them here, and we also save them to
+ * a small disk cache so later runs can just read them back in.
+ *
+ * The disk cache lives in $DIEHARDER_CACHE if it is set, otherwise in
+ * $HOME/.dieharder.  If neither exists (or can't be written) we simply
+ * run without it.
+ */
+static double *cvexact_cache[RGB_OPERM_KMAX+1];
+static double *cvein_cache[RGB_OPERM_KMAX+1];
+#define RGB_OPERM_CACHE_MAGIC "dhoperm1"
+
+static int rgb_operm_cache_path(char *path,size_t plen,uint k);
+static int rgb_operm_cache_read(uint k,double *cve,double *cvi);
+static void rgb_operm_cache_write(uint k,double *cve,double *cvi);
+
 int rgb_operm(Test **test,int irun, random_generator_t *cur_rng)
 {
 
@@ -59,7 +83,7 @@ int rgb_operm(Test **test,int irun, random_generator_t *cur_rng)
  double pvalue,ntuple_prob,pbin;  /* probabilities */
  Vtest *vtest;   /* Chisq entry vector */
 
- gsl_matrix_view CEXACT,CEINV,CEXPT,IDTY;
+ gsl_matrix_view CEINV,CEXPT,IDTY;
 
  /*
   * For a given n = ntuple size in bits, there are n! bit orderings
@@ -82,7 +106,6 @@ int rgb_operm(Test **test,int irun, random_generator_t *cur_rng)
  nperms = gsl_sf_fact(rgb_operm_k);
  noperms = gsl_sf_fact(3*rgb_operm_k-2);
  csamples = rgb_operm_k*rgb_operm_k;
- gsl_permutation * p = gsl_permutation_alloc(nperms);
 
  /*
   * Allocate memory for value_max vector of Vtest structs and counts,
@@ -94,73 +117,165 @@ int rgb_operm(Test **test,int irun, random_generator_t *cur_rng)
  Vtest_create(vtest,csamples+1);
 
  /*
-  * We have to allocate and free the cexact and cexpt matrices here
-  * or they'll be forgotten when these routines return.
+  * cexact[][] and ceinv[][] come from the per-k cache (built or loaded
+  * on the first call for this k).  cexpt[][] is sampled, so we have to
+  * allocate and free it here, along with idty[][].
   */
  MYDEBUG(D_RGB_OPERM){
-   printf("# rgb_operm: Creating and zeroing cexact[][] and cexpt[][].\n");
+   printf("# rgb_operm: Creating and zeroing cexpt[][].\n");
  }
- cexact = (double **)malloc(nperms*sizeof(double*));
- ceinv  = (double **)malloc(nperms*sizeof(double*));
+ get_cexact();
  cexpt  = (double **)malloc(nperms*sizeof(double*));
  idty   = (double **)malloc(nperms*sizeof(double*));
- cvexact = (double *)malloc(nperms*nperms*sizeof(double));
- cvein   = (double *)malloc(nperms*nperms*sizeof(double));
  cvexpt  = (double *)malloc(nperms*nperms*sizeof(double));
  vidty   = (double *)malloc(nperms*nperms*sizeof(double));
  for(i=0;i<nperms;i++){
    /* Here we pack addresses to map the matrix addressing onto the vector */
-   cexact[i] = &cvexact[i*nperms];
-   ceinv[i] = &cvein[i*nperms];
    cexpt[i] = &cvexpt[i*nperms];
    idty[i] = &vidty[i*nperms];
    for(j = 0;j<nperms;j++){
-     cexact[i][j] = 0.0;
-     ceinv[i][j] = 0.0;
      cexpt[i][j]  = 0.0;
      idty[i][j]   = 0.0;
    }
  }
 
- make_cexact();
  make_cexpt(cur_rng->rng);
 
- iv=0;
- for(i=0;i<nperms;i++){
-   for(j=0;j<nperms;j++){
-     cvexact[iv] = cexact[i][j];
-     cvexpt[iv]  = cexpt[i][j];
-     vidty[iv]   = 0.0;
-   }
- }
-
- CEXACT = gsl_matrix_view_array(cvexact, nperms, nperms);
  CEINV  = gsl_matrix_view_array(cvein  , nperms, nperms);
  CEXPT  = gsl_matrix_view_array(cvexpt , nperms, nperms);
  IDTY   = gsl_matrix_view_array(vidty  , nperms, nperms);
 
  /*
-  * Hmmm, looks like cexact isn't invertible.  Duh.  So it has eigenvalues.
-  * This seems to be important (how, I do not know) so let's find out.
-  * Here is the gsl ritual for evaluating eigenvalues etc.
+  * cexact isn't invertible (its rows sum to zero), so ceinv[][] is its
+  * Moore-Penrose pseudo-inverse, built from the eigensystem in
+  * make_ceinv().  ceinv cexpt should then be the identity on the
+  * subspace orthogonal to the null vector.
+  */
+ gsl_blas_dgemm(CblasNoTrans, CblasNoTrans, 1.0, &CEINV.matrix, &CEXPT.matrix, 0.0, &IDTY.matrix);
+ MYDEBUG(D_RGB_OPERM){
+   printf("#==================================================================\n");
+   printf("# Should be normal on identity:\n");
+   for(i=0;i<nperms;i++){
+     printf("# ");
+     for(j = 0;j<nperms;j++){
+       printf("%8.3f ",idty[i][j]);
+     }
+     printf("\n");
+   }
+   printf("#==================================================================\n");
+ }
+
+ /*
+  * OK, at this point we have two matrices:  cexact[][] is filled with
+  * the exact covariance matrix expected for the overlapping permutations.
+  * cexpt[][] has been filled numerically by generating strings of random
+  * uints or floats, generating sort index permutations, and
+  * using them to IDENTICALLY generate an "experimental" version of c[][].
+  * The two should correspond, in the limit of large tsamples.  IF I
+  * understand Alhakim, Kawczak and Molchanov, then the way to implement
+  * the simplest possible chisq test is to evaluate:
+  *       cexact^-1 cexpt \approx I
+  * where the diagonal terms should form a vector that is chisq distributed?
+  * Let's try this...
+  */
+ 
+ 
+
+ /*
+  * Free cexpt[][] and idty[][].  cexact[][] and ceinv[][] belong to the
+  * cache and are reused on the next call.
   */
+ free(cexpt);
+ free(idty);
+ free(cvexpt);
+ free(vidty);
+ Vtest_destroy(vtest);
+ free(vtest);
+ free(count);
+ 
+ return(0);
+
+}
+
+/*
+ * get_cexact() points cexact[][] and ceinv[][] at the cached matrices for
+ * the current rgb_operm_k, filling the cache from disk or (failing that)
+ * from make_cexact() and make_ceinv() on the first call for a given k.
+ */
+void get_cexact()
+{
+
+ int i,fresh;
+
+ fresh = 0;
+ if(cvexact_cache[rgb_operm_k] == 0){
+   cvexact_cache[rgb_operm_k] = (double *)malloc(nperms*nperms*sizeof(double));
+   cvein_cache[rgb_operm_k]   = (double *)malloc(nperms*nperms*sizeof(double));
+   fresh = 1;
+ }
+ cvexact = cvexact_cache[rgb_operm_k];
+ cvein   = cvein_cache[rgb_operm_k];
 
- gsl_vector *eval = gsl_vector_alloc (nperms);
- gsl_matrix *evec = gsl_matrix_alloc (nperms,nperms);
  /*
- gsl_eigen_nonsymm_workspace* w =  gsl_eigen_nonsymmv_alloc(nperms);
- gsl_eigen_nonsymm_params (1,0,w);
- gsl_eigen_nonsymmv(&CEXACT.matrix, eval, evec, w);
- gsl_eigen_nonsymmv_free (w);
+  * The row pointers are cheap, so we just redo them every call in case
+  * k changed underneath us.
+  */
+ if(cexact) free(cexact);
+ if(ceinv) free(ceinv);
+ cexact = (double **)malloc(nperms*sizeof(double*));
+ ceinv  = (double **)malloc(nperms*sizeof(double*));
+ for(i=0;i<nperms;i++){
+   cexact[i] = &cvexact[i*nperms];
+   ceinv[i] = &cvein[i*nperms];
+ }
+
+ if(fresh == 0) return;
+
+ if(rgb_operm_cache_read(rgb_operm_k,cvexact,cvein)){
+   MYDEBUG(D_RGB_OPERM){
+     printf("# rgb_operm: Read cexact[][] and ceinv[][] for k = %u from disk cache.\n",rgb_operm_k);
+   }
+   return;
+ }
+
+ memset(cvexact,0,nperms*nperms*sizeof(double));
+ memset(cvein,0,nperms*nperms*sizeof(double));
+ make_cexact();
+ make_ceinv();
+ rgb_operm_cache_write(rgb_operm_k,cvexact,cvein);
+
+}
+
+/*
+ * make_ceinv() forms the Moore-Penrose pseudo-inverse of cexact[][] in
+ * ceinv[][].  cexact is real symmetric, so this is just
+ *    ceinv = V diag(1/lambda) V^T
+ * over the eigenvalues that are not (numerically) zero.  Note that
+ * gsl_eigen_symmv() trashes its input, so we work on a copy.
  */
- gsl_eigen_symmv_workspace* w =  gsl_eigen_symmv_alloc(nperms);
- gsl_eigen_symmv(&CEXACT.matrix, eval, evec, w);
+void make_ceinv()
+{
+
+ int i,j,l;
+ double lmax,lcut,evil,sum;
+ double *cvtmp;
+ gsl_matrix_view CTMP;
+ gsl_vector *eval;
+ gsl_matrix *evec;
+ gsl_eigen_symmv_workspace *w;
+
+ cvtmp = (double *)malloc(nperms*nperms*sizeof(double));
+ memcpy(cvtmp,cvexact,nperms*nperms*sizeof(double));
+ CTMP = gsl_matrix_view_array(cvtmp, nperms, nperms);
+
+ eval = gsl_vector_alloc (nperms);
+ evec = gsl_matrix_alloc (nperms,nperms);
+ w =  gsl_eigen_symmv_alloc(nperms);
+ gsl_eigen_symmv(&CTMP.matrix, eval, evec, w);
  gsl_eigen_symmv_free (w);
  gsl_eigen_symmv_sort (eval, evec, GSL_EIGEN_SORT_ABS_ASC);
 
- {
-   int i;
-
+ MYDEBUG(D_RGB_OPERM){
    printf("#==================================================================\n");
    for (i = 0; i < nperms; i++) {
      double eval_i = gsl_vector_get (eval, i);
@@ -172,66 +287,121 @@ int rgb_operm(Test **test,int irun, random_generator_t *cur_rng)
    printf("#==================================================================\n");
  }
 
+ /*
+  * Sorted ABS_ASC, so the largest eigenvalue is last.  Anything below
+  * nperms*DBL_EPSILON of it is the null space (at least one, from the
+  * rows summing to zero) and gets dropped.
+  */
+ lmax = fabs(gsl_vector_get(eval,nperms-1));
+ lcut = nperms*DBL_EPSILON*lmax;
+ for(i=0;i<nperms;i++){
+   for(j=0;j<nperms;j++){
+     sum = 0.0;
+     for(l=0;l<nperms;l++){
+       evil = gsl_vector_get(eval,l);
+       if(fabs(evil) > lcut){
+         sum += gsl_matrix_get(evec,i,l)*gsl_matrix_get(evec,j,l)/evil;
+       }
+     }
+     ceinv[i][j] = sum;
+   }
+ }
+
  gsl_vector_free (eval);
  gsl_matrix_free (evec);
+ free(cvtmp);
+
+}
 
 /*
- gsl_linalg_LU_decomp(&CEXACT.matrix, p, &s);
- gsl_linalg_LU_invert(&CEXACT, p, &CEINV);
- gsl_permutation_free(p);
- gsl_blas_dgemm(CblasNoTrans, CblasNoTrans, 1.0, &CEINV.matrix, &CEXPT.matrix, 0.0, &IDTY.matrix);
- printf("#==================================================================\n");
- printf("# Should be inverse of C, assuming it is invertible:\n");
- for(i=0;i<nperms;i++){
-   printf("# ");
-   for(j = 0;j<nperms;j++){
-     printf("%8.3f ",idty[i][j]);
-   }
-   printf("\n");
+ * The disk cache is one file per k holding a short header followed by
+ * cexact[][] and then ceinv[][], both nperms x nperms doubles in native
+ * byte order.  Anything that doesn't look exactly right is ignored and
+ * rebuilt.
+ */
+typedef struct {
+  char magic[8];
+  uint k;
+  uint nperms;
+} rgb_operm_cache_header;
+
+static int rgb_operm_cache_path(char *path,size_t plen,uint k)
+{
+
+ char *dir;
+ struct stat sbuf;
+
+ dir = getenv("DIEHARDER_CACHE");
+ if(dir == 0 || dir[0] == 0){
+   dir = getenv("HOME");
+   if(dir == 0 || dir[0] == 0) return(0);
+   snprintf(path,plen,"%s/.dieharder",dir);
+ } else {
+   snprintf(path,plen,"%s",dir);
  }
- printf("#==================================================================\n");
- printf("#==================================================================\n");
- printf("# Should be normal on identity:\n");
- for(i=0;i<nperms;i++){
-   printf("# ");
-   for(j = 0;j<nperms;j++){
-     printf("%8.3f ",idty[i][j]);
-   }
-   printf("\n");
+ if(stat(path,&sbuf) != 0 && mkdir(path,0755) != 0) return(0);
+ snprintf(path + strlen(path),plen - strlen(path),"/rgb_operm_k%u.dat",k);
+ return(1);
+
+}
+
+static int rgb_operm_cache_read(uint k,double *cve,double *cvi)
+{
+
+ char path[K];
+ FILE *cfp;
+ size_t nel;
+ rgb_operm_cache_header hdr;
+
+ if(rgb_operm_cache_path(path,K,k) == 0) return(0);
+ if((cfp = fopen(path,"r")) == 0) return(0);
+ nel = (size_t) nperms*nperms;
+ if(fread(&hdr,sizeof(hdr),1,cfp) != 1 ||
+    memcmp(hdr.magic,RGB_OPERM_CACHE_MAGIC,8) != 0 ||
+    hdr.k != k || hdr.nperms != nperms ||
+    fread(cve,sizeof(double),nel,cfp) != nel ||
+    fread(cvi,sizeof(double),nel,cfp) != nel){
+   fclose(cfp);
+   return(0);
  }
- printf("#==================================================================\n");
- */
+ fclose(cfp);
+ return(1);
 
-    
+}
 
- /*
-  * OK, at this point we have two matrices:  cexact[][] is filled with
-  * the exact covariance matrix expected for the overlapping permutations.
-  * cexpt[][] has been filled numerically by generating strings of random
-  * uints or floats, generating sort index permutations, and
-  * using them to IDENTICALLY generate an "experimental" version of c[][].
-  * The two should correspond, in the limit of large tsamples.  IF I
-  * understand Alhakim, Kawczak and Molchanov, then the way to implement
-  * the simplest possible chisq test is to evaluate:
-  *       cexact^-1 cexpt \approx I
-  * where the diagonal terms should form a vector that is chisq distributed?
-  * Let's try this...
-  */
- 
- 
+static void rgb_operm_cache_write(uint k,double *cve,double *cvi)
+{
+
+ char path[K],tmppath[K+32];
+ FILE *cfp;
+ size_t nel;
+ rgb_operm_cache_header hdr;
+
+ if(rgb_operm_cache_path(path,K,k) == 0) return;
 
  /*
-  * Free cexact[][] and cexpt[][]
-  * Fix this when we're done so we don't leak; for now to much trouble.
- for(i=0;i<nperms;i++){
-   free(cexact[i]);
-   free(cexpt[i]);
- }
- free(cexact);
- free(cexpt);
+  * Write to a private temporary and rename() it into place, so that
+  * two dieharders racing to build the same k can't see a torn file.
   */
- 
- return(0);
+ snprintf(tmppath,sizeof(tmppath),"%s.%ld",path,(long) getpid());
+ if((cfp = fopen(tmppath,"w")) == 0) return;
+ memset(&hdr,0,sizeof(hdr));
+ memcpy(hdr.magic,RGB_OPERM_CACHE_MAGIC,8);
+ hdr.k = k;
+ hdr.nperms = nperms;
+ nel = (size_t) nperms*nperms;
+ if(fwrite(&hdr,sizeof(hdr),1,cfp) != 1 ||
+    fwrite(cve,sizeof(double),nel,cfp) != nel ||
+    fwrite(cvi,sizeof(double),nel,cfp) != nel){
+   fclose(cfp);
+   unlink(tmppath);
+   return;
+ }
+ fclose(cfp);
+ if(rename(tmppath,path) != 0) unlink(tmppath);
+ MYDEBUG(D_RGB_OPERM){
+   printf("# rgb_operm: Saved cexact[][] and ceinv[][] for k = %u to %s.\n",k,path);
+ }
 
 }
 
@@ -36,10 +36,10 @@ int rgb_permutations(Test **test,int irun, random_generator_t *cur_rng)
   * valid test is 2.  If ntuple is less than 2, we choose the default
   * test size as 5 (like operm5).
   */
- if(ntuple<2){
+ if(test[0]->ntuple_cl<2){
    test[0]->ntuple = 5;
  } else {
-   test[0]->ntuple = ntuple;
+   test[0]->ntuple = test[0]->ntuple_cl;
  }
  k = test[0]->ntuple;
  nperms = gsl_sf_fact(k);
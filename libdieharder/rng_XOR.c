@@ -60,6 +60,12 @@ gsl_rng *XOR_rng_alloc (const gsl_rng_type * T, input_params_t *params)
   return r;
 }
 gsl_rng *file_input_alloc (const gsl_rng_type * T, char *filename);
+
+/* The generators that read from a file (or ring) named with -f */
+int rng_takes_filename(const gsl_rng_type *T) {
+  return strncmp("file_input",T->name,10) == 0 || strcmp("shm_input_raw",T->name) == 0;
+}
+
 gsl_rng *wrap_gsl_rng_alloc(input_params_t *params, unsigned int i) {
   unsigned int curr_gnum = params->gnumbs[i];
   const gsl_rng_type *T = dh_rng_types[curr_gnum];
@@ -69,6 +75,9 @@ gsl_rng *wrap_gsl_rng_alloc(input_params_t *params, unsigned int i) {
   if(strncmp("file_input",T->name,10) == 0){
     return file_input_alloc(T, params->filenames[params->gfilenum[(i > 0)? (i - 1) : 0]]);
   }
+  if(strcmp("shm_input_raw",T->name) == 0){
+    return shm_input_alloc(T, params->filenames[params->gfilenum[(i > 0)? (i - 1) : 0]]);
+  }
   return gsl_rng_alloc(T);
 }
 
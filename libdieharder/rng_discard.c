@@ -0,0 +1,144 @@
+/*
+ * See copyright in copyright.h and the accompanying file COPYING
+ */
+
+/*
+ *========================================================================
+ * rng_discard(rng,n) advances rng by n returns, exactly as if we had
+ * called gsl_rng_get() n times and thrown the results away.  Tests that
+ * sample a lagged stream (rgb_lagged_sums, marsaglia_tsang_gorilla)
+ * spend most of their time generating numbers they never look at, so
+ * we skip them as cheaply as the generator allows:
+ *
+ *  a) Linear congruential generators x -> (a*x + c) mod m jump
+ *     directly to x_n = A*x + C mod m, with (A,C) built by repeated
+ *     squaring of the map in O(log n).  This only needs the state
+ *     layout, which for the GSL LCGs listed below is a single
+ *     unsigned long x (three 16 bit shorts for rand48) and has been
+ *     stable forever.
+ *
+ *  b) file_input_raw on a regular file just moves the file pointer,
+ *     rewinding (and counting rewinds) exactly as reading would have.
+ *
+ *  c) Anything else falls back to generating and dropping the numbers
+ *     in a tight loop.
+ *========================================================================
+ */
+
+#include <dieharder/libdieharder.h>
+
+/*
+ * x -> (a*x + c) mod m, returned by gsl_rng_get() as x itself.
+ */
+typedef struct {
+  const gsl_rng_type **type;
+  unsigned long long a;
+  unsigned long long c;
+  unsigned long long m;
+} lcg_jump_t;
+
+static lcg_jump_t lcg_jumps[] = {
+  {&gsl_rng_minstd,     16807ull,      0ull, 2147483647ull},
+  {&gsl_rng_ran0,       16807ull,      0ull, 2147483647ull},
+  {&gsl_rng_fishman18,  62089911ull,   0ull, 2147483647ull},
+  {&gsl_rng_fishman20,  48271ull,      0ull, 2147483647ull},
+  {&gsl_rng_lecuyer21,  40692ull,      0ull, 2147483399ull},
+  {&gsl_rng_rand,       1103515245ull, 12345ull, 2147483648ull},
+  {&gsl_rng_randu,      65539ull,      0ull, 2147483648ull},
+  {&gsl_rng_borosh13,   1812433253ull, 0ull, 4294967296ull},
+  {&gsl_rng_waterman14, 1566083941ull, 0ull, 4294967296ull},
+  {&gsl_rng_transputer, 1664525ull,    0ull, 4294967296ull},
+  {&gsl_rng_vax,        69069ull,      1ull, 4294967296ull},
+  {&gsl_rng_rand48,     0x5DEECE66Dull, 0xBull, 281474976710656ull},
+  {0,0,0,0}
+};
+
+/*
+ * rand48 keeps its 48 bit state as three shorts.
+ */
+typedef struct {
+  unsigned short int x0, x1, x2;
+} rand48_state_t;
+
+/*
+ * (a*b) mod m for a,b < m <= 2^48 without overflowing 64 bits:  for
+ * m <= 2^32 the product fits as is, otherwise we feed b in 16 bits at
+ * a time.
+ */
+static unsigned long long mulmod(unsigned long long a,unsigned long long b,unsigned long long m)
+{
+
+ unsigned long long r;
+ int shift;
+
+ if(m <= 4294967296ull) return (a*b) % m;
+
+ r = 0;
+ for(shift=32;shift>=0;shift-=16){
+   r = (r << 16) % m;
+   r = (r + (a*((b >> shift) & 0xffffull)) % m) % m;
+ }
+ return r;
+
+}
+
+static unsigned long long lcg_jump(lcg_jump_t *lcg,unsigned long long x,unsigned long long n)
+{
+
+ unsigned long long A = 1,C = 0;
+ unsigned long long a = lcg->a % lcg->m,c = lcg->c % lcg->m,m = lcg->m;
+
+ /*
+  * (A,C) accumulates f^n one binary digit of n at a time, where (a,c)
+  * is f^(2^k) at step k.  All the maps are powers of f, so they
+  * commute and the order of composition doesn't matter.
+  */
+ while(n){
+   if(n & 1){
+     A = mulmod(a,A,m);
+     C = (mulmod(a,C,m) + c) % m;
+   }
+   c = mulmod((a + 1) % m,c,m);
+   a = mulmod(a,a,m);
+   n >>= 1;
+ }
+ return (mulmod(A,x % m,m) + C) % m;
+
+}
+
+void rng_discard(gsl_rng *rng,unsigned long long n)
+{
+
+ int i;
+ unsigned long long x;
+ rand48_state_t *r48;
+
+ if(n == 0) return;
+
+ for(i=0;lcg_jumps[i].type != 0;i++){
+   if(rng->type != *lcg_jumps[i].type) continue;
+   MYDEBUG(D_BITS){
+     printf("# rng_discard(): jumping %s ahead %llu\n",rng->type->name,n);
+   }
+   if(rng->type == gsl_rng_rand48){
+     r48 = (rand48_state_t *) rng->state;
+     x = ((unsigned long long) r48->x2 << 32) |
+         ((unsigned long long) r48->x1 << 16) | r48->x0;
+     x = lcg_jump(&lcg_jumps[i],x,n);
+     r48->x0 = x & 0xffff;
+     r48->x1 = (x >> 16) & 0xffff;
+     r48->x2 = (x >> 32) & 0xffff;
+   } else {
+     *(unsigned long int *) rng->state =
+       lcg_jump(&lcg_jumps[i],*(unsigned long int *) rng->state,n);
+   }
+   return;
+ }
+
+ if(rng->type == gsl_rng_file_input_raw && file_input_raw_discard(rng->state,n) == 0){
+   return;
+ }
+
+ while(n--) gsl_rng_get(rng);
+
+}
@@ -84,6 +84,36 @@ static unsigned long int file_input_raw_get(void *vstate)
 
 }
 
+/*
+ * Skip the next n rands without reading them, for rng_discard().  On a
+ * regular file this is just a seek, with rptr, rtot and rewind_cnt
+ * left exactly where n calls to file_input_raw_get() would have left
+ * them.  Returns -1 (and does nothing) if we can't seek, e.g. on a
+ * pipe, so the caller can read and drop instead.
+ */
+int file_input_raw_discard(void *vstate, unsigned long long n)
+{
+
+ file_input_state_t *state = (file_input_state_t *) vstate;
+ unsigned long long end,offset;
+
+ if(state->fp == NULL || state->flen == 0) return(-1);
+
+ end = (unsigned long long) state->rptr + n;
+ offset = (end % state->flen)*sizeof(uint);
+ if(offset > LONG_MAX || fseek(state->fp,(long) offset,SEEK_SET) != 0){
+   return(-1);
+ }
+ state->rewind_cnt += end/state->flen;
+ state->rptr = end % state->flen;
+ state->rtot += n;
+ if(verbose == D_FILE_INPUT_RAW || verbose == D_ALL){
+   fprintf(stdout,"# file_input_raw(): skipped %llu rands, rptr = %u, rewind count = %u\n",n,(uint) state->rptr,state->rewind_cnt);
+ }
+ return(0);
+
+}
+
 static double file_input_raw_get_double (void *vstate)
 {
   return file_input_raw_get (vstate) / (double) UINT_MAX;
@@ -0,0 +1,220 @@
+/*
+ * shm_input_raw
+ *
+ * See copyright in copyright.h and the accompanying file COPYING
+ *
+ */
+
+/*
+ * Raw 32 bit rands from a POSIX shared memory ring that some other
+ * process (an entropy daemon, or dieharder/shm_producer.c) fills, see
+ * shm_ring.h for the layout and the protocol.  The ring's name is given
+ * like a file name:
+ *
+ *   dieharder -g shm_input_raw -f /entropy -a
+ *
+ * Compared with piping the same rands into stdin_input_raw there is no
+ * copy through the kernel and no fread() per rand:  the tests read each
+ * word straight out of the mapped pages, and the only traffic between
+ * the two processes is the consumer handing back a stretch of the ring
+ * every SHM_PUBLISH words (or whenever it runs dry) and the wakeups.
+ * When the ring runs dry and the producer has said it is finished (or
+ * has died) we end the run just as stdin_input_raw does at EOF.
+ */
+
+/* shm_open(), mmap() and kill() are POSIX, not c99 */
+#define _DEFAULT_SOURCE
+#include <dieharder/libdieharder.h>
+#include <dieharder/shm_ring.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+
+/* Hand back at most this much of the ring at a time (or 1/8 of it) */
+#define SHM_PUBLISH 65536
+
+typedef struct {
+  char *name;
+  shm_ring_t *ring;
+  const uint32_t *word;
+  uint64_t mask;
+  uint64_t tail;        /* Next word to read */
+  uint64_t head;        /* The producer's head when we last looked */
+  uint64_t published;   /* The tail the producer has seen */
+  uint64_t publish;     /* Hand back every this many words */
+} shm_input_state_t;
+
+static void shm_input_publish(shm_input_state_t *s)
+{
+
+ shm_ring_t *r = s->ring;
+
+ __atomic_store_n(&r->tail,s->tail,__ATOMIC_SEQ_CST);
+ s->published = s->tail;
+ if(__atomic_load_n(&r->producer_waiting,__ATOMIC_SEQ_CST)) shm_ring_wake(&r->tail_seq);
+
+}
+
+/*
+ * The ring is empty as far as we know:  hand back what we've read and
+ * wait for more.
+ */
+static void shm_input_refill(shm_input_state_t *s)
+{
+
+ shm_ring_t *r = s->ring;
+ uint32_t seq;
+
+ shm_input_publish(s);
+ s->head = __atomic_load_n(&r->head,__ATOMIC_ACQUIRE);
+ if(s->head != s->tail) return;
+
+ r->consumer_stalls++;
+ for(;;){
+   seq = __atomic_load_n(&r->head_seq,__ATOMIC_SEQ_CST);
+   __atomic_store_n(&r->consumer_waiting,1,__ATOMIC_SEQ_CST);
+   s->head = __atomic_load_n(&r->head,__ATOMIC_SEQ_CST);
+   if(s->head != s->tail) break;
+   if(__atomic_load_n(&r->eof,__ATOMIC_ACQUIRE) ||
+      (kill((pid_t) r->producer_pid,0) != 0 && errno == ESRCH)){
+     /* One last look, in case it wrote its last words and left */
+     s->head = __atomic_load_n(&r->head,__ATOMIC_ACQUIRE);
+     if(s->head != s->tail) break;
+     fprintf(stderr,"# shm_input_raw(): Error: EOF\n");
+     exit(0);
+   }
+   shm_ring_wait(&r->head_seq,seq);
+ }
+ __atomic_store_n(&r->consumer_waiting,0,__ATOMIC_SEQ_CST);
+
+}
+
+static unsigned long int shm_input_raw_get(void *vstate)
+{
+
+ shm_input_state_t *s = (shm_input_state_t *) vstate;
+ unsigned long int iret;
+
+ if(s->tail == s->head) shm_input_refill(s);
+ iret = s->word[s->tail & s->mask];
+ s->tail++;
+ if(s->tail - s->published >= s->publish) shm_input_publish(s);
+ return iret;
+
+}
+
+static double shm_input_raw_get_double(void *vstate)
+{
+
+ return shm_input_raw_get(vstate) / (double) UINT_MAX;
+
+}
+
+/*
+ * Attach to the ring the first time.  After that, like stdin, the
+ * stream can't be reseeded or rewound and this does nothing.
+ */
+static void shm_input_raw_set(void *vstate,unsigned long int seed)
+{
+
+ shm_input_state_t *s = (shm_input_state_t *) vstate;
+ struct stat sbuf;
+ void *map;
+ int fd;
+ shm_ring_t *r;
+
+ if(s->ring != NULL) return;
+
+ fd = shm_open(s->name,O_RDWR,0);
+ if(fd < 0){
+   fprintf(stderr,"# shm_input_raw(): Error: cannot open shared memory %s (is the producer running?)\n",s->name);
+   exit(0);
+ }
+ if(fstat(fd,&sbuf) != 0 || sbuf.st_size < SHM_RING_HEADER){
+   fprintf(stderr,"# shm_input_raw(): Error: %s is not a ring.\n",s->name);
+   exit(0);
+ }
+ map = mmap(NULL,(size_t)sbuf.st_size,PROT_READ | PROT_WRITE,MAP_SHARED,fd,0);
+ close(fd);
+ if(map == MAP_FAILED){
+   fprintf(stderr,"# shm_input_raw(): Error: cannot map %s.\n",s->name);
+   exit(0);
+ }
+ r = (shm_ring_t *) map;
+ if(__atomic_load_n(&r->magic,__ATOMIC_ACQUIRE) != SHM_RING_MAGIC || r->size == 0 ||
+    (r->size & (r->size - 1)) != 0 || SHM_RING_HEADER + r->size*sizeof(uint32_t) > (uint64_t) sbuf.st_size){
+   fprintf(stderr,"# shm_input_raw(): Error: %s is not a ring.\n",s->name);
+   exit(0);
+ }
+ if(r->consumer_pid != 0 && kill((pid_t) r->consumer_pid,0) == 0){
+   fprintf(stderr,"# shm_input_raw(): Error: %s already has a reader.\n",s->name);
+   exit(0);
+ }
+
+ s->ring = r;
+ s->word = (const uint32_t *)((const char *) map + SHM_RING_HEADER);
+ s->mask = r->size - 1;
+ s->tail = s->published = __atomic_load_n(&r->tail,__ATOMIC_ACQUIRE);
+ s->head = s->tail;
+ s->publish = r->size/8 < SHM_PUBLISH ? r->size/8 : SHM_PUBLISH;
+ if(s->publish == 0) s->publish = 1;
+ r->consumer_pid = (int32_t) getpid();
+
+ if(verbose == D_FILE_INPUT_RAW || verbose == D_ALL){
+   fprintf(stdout,"# shm_input_raw(): attached to %s, a ring of %llu rands, producer pid %d\n",
+           s->name,(unsigned long long) r->size,(int) r->producer_pid);
+ }
+
+}
+
+/*
+ * The counterpart of file_input_alloc(), as the ring is named by -f.
+ */
+gsl_rng *shm_input_alloc(const gsl_rng_type *T,char *name)
+{
+
+ gsl_rng *r;
+ shm_input_state_t *s;
+
+ r = (gsl_rng *) malloc(sizeof(gsl_rng));
+ r->state = calloc(1,T->size);
+ r->type = T;
+ s = (shm_input_state_t *) r->state;
+ s->name = name;
+ s->ring = NULL;
+ gsl_rng_set(r,gsl_rng_default_seed);
+ return r;
+
+}
+
+/*
+ * The backpressure counts so far:  rands read, times the tests had to
+ * wait for the producer, and times the producer had to wait for them.
+ * Returns -1 if rng isn't shm_input_raw.
+ */
+int shm_input_stats(gsl_rng *rng,unsigned long long *nread,unsigned long long *cstalls,
+                    unsigned long long *pstalls)
+{
+
+ shm_input_state_t *s;
+
+ if(rng == NULL || strcmp(gsl_rng_name(rng),"shm_input_raw") != 0) return -1;
+ s = (shm_input_state_t *) rng->state;
+ if(s->ring == NULL) return -1;
+ *nread = s->tail;
+ *cstalls = s->ring->consumer_stalls;
+ *pstalls = __atomic_load_n(&s->ring->producer_stalls,__ATOMIC_RELAXED);
+ return 0;
+
+}
+
+static const gsl_rng_type shm_input_raw_type =
+{"shm_input_raw",               /* name */
+ UINT_MAX,                      /* RAND_MAX */
+ 0,                             /* RAND_MIN */
+ sizeof (shm_input_state_t),
+ shm_input_raw_set,
+ shm_input_raw_get,
+ shm_input_raw_get_double};
+
+const gsl_rng_type *gsl_rng_shm_input_raw = &shm_input_raw_type;
@@ -75,7 +75,7 @@ double sample(void *testfunc(), random_generator_t *cur_rng)
   * We perform a KS test, or (with an appropriate case switch
   * or other control mechanism) perform other tests as well.
   */
- pks = kstest_kuiper(ks_pvalue,kspi);
+ pks = kstest_kuiper(ks_pvalue,kspi,NULL);
  if(verbose == D_SAMPLE || verbose == D_ALL){
    printf("# sample(): p = %6.3f from Kuiper Kolmogorov-Smirnov test on %u pvalue.\n",pks,kspi);
  }
@@ -22,17 +22,25 @@
  * caller (and guaranteed to be big enough to hold the result).
  */
 
+/*
+ * The bits fetched from the generator but not yet returned, right
+ * justified in bit_buffer, are kept with the generator in its
+ * read_buffer (bit_buffer and bits_left), so that they never carry over
+ * from one source to the next and reset_bit_buffers() clears them.
+ * They are shared by get_rand_bits_uint() and get_rand_bits_uint_block()
+ * below, so the two can be mixed freely.
+ */
+
 /* We need to reset the internal state of this function from outside
  * when we go from one rng two another in two sample mode.*/
 inline static uint get_rand_bits_uint (uint nbits, uint mask, random_generator_t *cur_rng, int reset)
 {
 
- static uint bit_buffer;
- static uint bits_left_in_bit_buffer = 0;
  uint bits,breturn;
+ read_buffer_params_t *rb = &cur_rng->read_buffer;
 
  if (reset) {
-	 bits_left_in_bit_buffer = 0;
+	 rb->bits_left = 0;
 	 return 0;
  }
 
@@ -119,15 +127,15 @@ and so on.  Very nice.
    printf(" Mask = ");
    dumpuintbits(&mask,1);
    printf("\n");
-   printf("%u bits left\n",bits_left_in_bit_buffer);
+   printf("%u bits left\n",rb->bits_left);
    printf(" Buff = ");
-   dumpuintbits(&bit_buffer,1);
+   dumpuintbits(&rb->bit_buffer,1);
    printf("\n");
  }
 
- if (bits_left_in_bit_buffer >= nbits) {
-   bits_left_in_bit_buffer -= nbits;
-   bits = (bit_buffer >> bits_left_in_bit_buffer);
+ if (rb->bits_left >= nbits) {
+   rb->bits_left -= nbits;
+   bits = (rb->bit_buffer >> rb->bits_left);
    MYDEBUG(D_BITS) {
      printf("Enough:\n");
      printf(" Bits = ");
@@ -138,7 +146,7 @@ and so on.  Very nice.
    return bits & mask;
  }
 
- nbits = nbits - bits_left_in_bit_buffer;
+ nbits = nbits - rb->bits_left;
  /*
   * This fixes an annoying quirk of the x86.  It only uses the bottom five
   * bits of the shift value.  That means that if you shift right by 32 --
@@ -154,7 +162,7 @@ and so on.  Very nice.
  if(nbits == 32){
    bits = 0;
  } else {
-   bits = (bit_buffer << nbits);
+   bits = (rb->bit_buffer << nbits);
  }
  MYDEBUG(D_BITS) {
    printf("Not enough, need %u:\n",nbits);
@@ -163,20 +171,20 @@ and so on.  Very nice.
    printf("\n");
  }
  while (1) {
-   bit_buffer = gsl_rng_get (cur_rng->rng);
-   bits_left_in_bit_buffer = cur_rng->rmax_bits;
+   rb->bit_buffer = gsl_rng_get (cur_rng->rng);
+   rb->bits_left = cur_rng->rmax_bits;
 
    MYDEBUG(D_BITS) {
      printf("Refilled bit_buffer\n");
-     printf("%u bits left\n",bits_left_in_bit_buffer);
+     printf("%u bits left\n",rb->bits_left);
      printf(" Buff = ");
-     dumpuintbits(&bit_buffer,1);
+     dumpuintbits(&rb->bit_buffer,1);
      printf("\n");
    }
 
-   if (bits_left_in_bit_buffer >= nbits) {
-     bits_left_in_bit_buffer -= nbits;
-     bits |= (bit_buffer >> bits_left_in_bit_buffer);
+   if (rb->bits_left >= nbits) {
+     rb->bits_left -= nbits;
+     bits |= (rb->bit_buffer >> rb->bits_left);
 
      MYDEBUG(D_BITS) {
        printf("Returning:\n");
@@ -188,8 +196,8 @@ and so on.  Very nice.
 
      return bits & mask;
    }
-   nbits -= bits_left_in_bit_buffer;
-   bits |= (bit_buffer << nbits);
+   nbits -= rb->bits_left;
+   bits |= (rb->bit_buffer << nbits);
 
    MYDEBUG(D_BITS) {
      printf("This should never execute:\n");
@@ -202,6 +210,70 @@ and so on.  Very nice.
 
 }
 
+/*
+ * get_rand_bits_uint_block() fills values[] with the next n nbits-wide
+ * returns of get_rand_bits_uint(nbits,mask,cur_rng,0), exactly as n calls
+ * would have made them and leaving bit_buffer as they would have left
+ * it.  The leftover bits and exactly as many rmax_bits-wide rands as
+ * those calls would have fetched are packed back to back into whole
+ * words, most significant bit first and with nothing dropped, and the
+ * lot is unpacked in one go (see unpack_bits.c).
+ */
+#define GET_BITS_BLOCK_WORDS 64
+inline static void get_rand_bits_uint_block (uint *values, uint n, uint nbits, random_generator_t *cur_rng)
+{
+
+ uint i,c,nw,need,avail,last;
+ uint rmax_bits = cur_rng->rmax_bits;
+ uint rmask = (rmax_bits == 32) ? 0xffffffff : ((1u << rmax_bits) - 1);
+ uint words[GET_BITS_BLOCK_WORDS + 4];
+ unsigned long long acc;
+ uint nacc;
+ read_buffer_params_t *rb = &cur_rng->read_buffer;
+
+ if(nbits == rmax_bits){
+   for(i=0;i<n;i++) values[i] = gsl_rng_get(cur_rng->rng);
+   return;
+ }
+
+ while(n > 0){
+   c = n;
+   if(c > GET_BITS_BLOCK_WORDS*32/nbits) c = GET_BITS_BLOCK_WORDS*32/nbits;
+   need = c*nbits;
+
+   /*
+    * acc holds the nacc bits not yet written to words[], right
+    * justified.  We start with what is left in bit_buffer and fetch
+    * a new rand only when we run out, as get_rand_bits_uint() does.
+    */
+   nw = 0;
+   avail = rb->bits_left;
+   nacc = avail;
+   acc = (nacc == 0) ? 0 : (rb->bit_buffer & (0xffffffff >> (32 - nacc)));
+   last = rb->bit_buffer;
+   while(1){
+     while(nacc >= 32){
+       nacc -= 32;
+       words[nw++] = (uint)(acc >> nacc);
+       acc &= (1ull << nacc) - 1;
+     }
+     if(avail >= need) break;
+     last = gsl_rng_get(cur_rng->rng);
+     acc = (acc << rmax_bits) | (last & rmask);
+     nacc += rmax_bits;
+     avail += rmax_bits;
+   }
+   if(nacc > 0) words[nw++] = (uint)(acc << (32 - nacc));
+
+   unpack_bits_u32(words,0,nbits,c,values);
+   rb->bit_buffer = last;
+   rb->bits_left = avail - need;
+   values += c;
+   n -= c;
+ }
+
+}
+
 /*
  * This is a drop-in-replacement for get_bit_ntuple() contributed by
  * John E. Davis.  It speeds up this code substantially but may
@@ -53,6 +53,9 @@ Test **create_test(Dtest *dtest, uint tsamples,uint psamples)
  uint i,j;
  uint pcutoff;
  Test **newtest;
+ char *spillname;
+ size_t spilllen;
+ static uint create_count = 0;
 
  MYDEBUG(D_STD_TEST){
    fprintf(stdout,"# create_test(): About to create test %s\n",dtest->sname);
@@ -99,6 +102,16 @@ Test **create_test(Dtest *dtest, uint tsamples,uint psamples)
    /* Give ntuple an initial value of zero; most tests will set it. */
    newtest[i]->ntuple = 0;
 
+   /*
+    * The tests that take an ntuple read it from here rather than from
+    * the global, so tests created with different ntuples can run at the
+    * same time (see fanout.c).  They run on the global generator unless
+    * the caller points rng at another one.
+    */
+   newtest[i]->ntuple_cl = ntuple;
+   newtest[i]->rng = NULL;
+   newtest[i]->words = 0;
+
    /*
     * Now we can malloc space for the pvalues vector, and a
     * single (80-column) LINE for labels for the pvalues.  We default
@@ -109,10 +122,43 @@ Test **create_test(Dtest *dtest, uint tsamples,uint psamples)
    } else {
      pcutoff = newtest[i]->psamples;
    }
+
+   /*
+    * In streaming mode the pvalues go into a fixed size sketch (see
+    * pstream.c) and the test only ever sees PSTREAM_CHUNK slots,
+    * however many psamples there are.  The two sample test needs every
+    * st_value, so it turns streaming off.
+    */
+   newtest[i]->ps = NULL;
+   if(pstream != 0 && !etalon_enabled){
+     if(pcutoff > PSTREAM_CHUNK) pcutoff = PSTREAM_CHUNK;
+     spillname = NULL;
+     if(pstream_spill[0] != 0){
+       /* Room for the two dots and uints of the suffix, and the 0 */
+       spilllen = strlen(pstream_spill) + strlen(dtest->sname) + 2*(3*sizeof(uint) + 2) + 1;
+       spillname = (char *)malloc(spilllen);
+       snprintf(spillname,spilllen,"%s.%u.%s.%u",pstream_spill,create_count,dtest->sname,i);
+     }
+     newtest[i]->ps = pstream_alloc(1u << (pstream > 28 ? 28 : pstream),spillname);
+     nullfree(spillname);
+   }
    newtest[i]->pvalues = (double *)malloc((size_t)pcutoff*sizeof(double));
    /* Allocate memory for the array of underlying statistical values. */
    newtest[i]->st_values = (double *)malloc((size_t)pcutoff*sizeof(double));
    newtest[i]->pvlabel = (char *)malloc((size_t)LINE*sizeof(char));
+   /*
+    * The two sample (etalon) KS test keeps its own sorted copy of
+    * st_values and a workspace, so it neither scrambles st_values nor
+    * allocates on every call.
+    */
+   if(etalon_enabled){
+     newtest[i]->st_sorted = (double *)malloc((size_t)pcutoff*sizeof(double));
+     newtest[i]->ks_work = (double *)malloc((size_t)(pcutoff+1)*sizeof(double));
+   } else {
+     newtest[i]->st_sorted = NULL;
+     newtest[i]->ks_work = NULL;
+   }
+   newtest[i]->st_nsorted = 0;
    snprintf(newtest[i]->pvlabel,LINE,"##################################################################\n");
    for(j=0;j<pcutoff;j++){
      newtest[i]->pvalues[j] = 0.0;
@@ -125,8 +171,11 @@ Test **create_test(Dtest *dtest, uint tsamples,uint psamples)
     * call is the first call.  It will be nonzero after the first call.
     */
    newtest[i]->ks_pvalue = 0.0;
+   newtest[i]->nsorted = 0;
+   for(j=0;j<GOF_N;j++) newtest[i]->gof_pvalues[j] = 0.0;
 
    MYDEBUG(D_STD_TEST){
+     if(newtest[i]->ps != NULL) printf("Streaming pvalues into %u bins\n",newtest[i]->ps->nbins);
      printf("Allocated and set newtest->tsamples = %d\n",newtest[i]->tsamples);
      printf("Xtrategy = %u -> pcutoff = %u\n",Xtrategy,pcutoff);
      printf("Allocated and set newtest->psamples = %d\n",newtest[i]->psamples);
@@ -134,6 +183,7 @@ Test **create_test(Dtest *dtest, uint tsamples,uint psamples)
 
  }
 
+ create_count++;
  /* printf("Allocated complete test struct at %0x\n",newtest); */
  return(newtest);
 
@@ -160,6 +210,9 @@ void destroy_test(Dtest *dtest, Test **test)
    free(test[i]->pvalues);
    free(test[i]->st_values);
    free(test[i]->pvlabel);
+   free(test[i]->st_sorted);
+   free(test[i]->ks_work);
+   pstream_free(test[i]->ps);
  }
  /* printf("Freeing all the test structs\n"); */
  for(i=0;i<dtest->nkps;i++){
@@ -195,6 +248,9 @@ void clear_test(Dtest *dtest, Test **test)
      test[i]->psamples = psamples;
    }
    test[i]->ks_pvalue = 0.0;
+   test[i]->nsorted = 0;
+   test[i]->st_nsorted = 0;
+   if(test[i]->ps != NULL) pstream_clear(test[i]->ps);
  }
 
  /*
@@ -221,10 +277,25 @@ void clear_test(Dtest *dtest, Test **test)
  * Note that Xoff MUST remain global, if nothing else.  Otherwise we
  * can run out of allocated headroom in the pvalues vector.
  */
+/*
+ * Bring test->st_sorted up to date with the first count st_values.
+ */
+static void st_sort_update(Test *test, unsigned int count)
+{
+
+ if(count <= test->st_nsorted) return;
+ memcpy(test->st_sorted + test->st_nsorted,test->st_values + test->st_nsorted,
+        (size_t)(count - test->st_nsorted)*sizeof(double));
+ pvalue_merge(test->st_sorted,test->st_nsorted,count,test->ks_work);
+ test->st_nsorted = count;
+
+}
+
 void add_2_test(Dtest *dtest, Test **test, Test **ref_test, int count)
 {
 
- uint i,j,imax;
+ uint i,j,k,imax;
+ random_generator_t *rng;
 
 
  /*
@@ -235,11 +306,30 @@ void add_2_test(Dtest *dtest, Test **test, Test **ref_test, int count)
  imax = test[0]->psamples + count;
  if(imax > Xoff) imax = Xoff;
  count = imax - test[0]->psamples;
- for(i = test[0]->psamples; i < imax; i++){
-   /* Now we should tell the test which rng to use.
-    * So we don't use global one and pass it via arguments.
-   */
-   dtest->test(test,i, &generator);
+ rng = (test[0]->rng != NULL) ? test[0]->rng : &generator;
+ if(test[0]->ps != NULL){
+   /*
+    * Streaming:  the test fills pvalues[0..PSTREAM_CHUNK) over and
+    * over, and every time it fills up (and at the end) the pvalues go
+    * into the sketches.
+    */
+   k = 0;
+   for(i = test[0]->psamples; i < imax; i++){
+     dtest->test(test,k++,rng);
+     if(k == PSTREAM_CHUNK || i + 1 == imax){
+       for(j = 0;j < dtest->nkps;j++){
+         pstream_add(test[j]->ps,test[j]->pvalues,k);
+       }
+       k = 0;
+     }
+   }
+ } else {
+   for(i = test[0]->psamples; i < imax; i++){
+     /* Now we should tell the test which rng to use.
+      * So we don't use global one and pass it via arguments.
+     */
+     dtest->test(test,i,rng);
+   }
  }
 
  /* If two sample test is enabled, fill ref_test using ref_rng. */
@@ -256,13 +346,35 @@ void add_2_test(Dtest *dtest, Test **test, Test **ref_test, int count)
     */
    test[j]->psamples += count;
 
+   /*
+    * The pvalues we already had are still sorted from the last call,
+    * so we only sort the count new ones and merge them in (see
+    * kstest.c).  In TTD/RA modes this is called over and over with
+    * Xstep new pvalues each time.  From the sorted pvalues we get all
+    * of the goodness of fit p-values in one pass (see gof.c).  In
+    * streaming mode they come from the sketch instead.
+    */
+   if(test[j]->ps != NULL){
+     pstream_gof(test[j]->ps,test[j]->gof_pvalues);
+   } else {
+     pvalue_merge(test[j]->pvalues,test[j]->nsorted,test[j]->psamples,NULL);
+     test[j]->nsorted = test[j]->psamples;
+     gof_sorted(test[j]->pvalues,test[j]->psamples,test[j]->gof_pvalues);
+   }
+
    if (etalon_enabled) {
        /* Now we have two arrays of the same size with st_values from rng and etalon_rng.
         * We compare them using two_sample_ks_test and get the final ks_pvalue.
-        * One value is omitted because then ks_pvalue is less discrete.*/
-	   test[j]->ks_pvalue = (test[j]->psamples > 1)?
-			   two_sample_kstest(test[j]->st_values, ref_test[j]->st_values, test[j]->psamples - 1, test[j]->psamples)
-	           : test[j]->pvalues[0];
+        * One value is omitted because then ks_pvalue is less discrete.
+        * Both are merged into their sorted copies a batch at a time. */
+	   if (test[j]->psamples > 1) {
+	       st_sort_update(test[j], test[j]->psamples - 1);
+	       st_sort_update(ref_test[j], test[j]->psamples);
+	       test[j]->ks_pvalue = two_sample_kstest_sorted(test[j]->st_sorted, ref_test[j]->st_sorted,
+			   test[j]->psamples - 1, test[j]->psamples, ref_test[j]->ks_work);
+	   } else {
+	       test[j]->ks_pvalue = test[j]->pvalues[0];
+	   }
    }
    else if(ks_test == 3){
      /*
@@ -270,10 +382,10 @@ void add_2_test(Dtest *dtest, Test **test, Test **ref_test, int count)
       * Generally it is ignored.  All smaller values of ks_test are passed
       * through to kstest() and control its precision (and speed!).
       */
-     test[j]->ks_pvalue = kstest_kuiper(test[j]->pvalues,test[j]->psamples);
+     test[j]->ks_pvalue = test[j]->gof_pvalues[GOF_KUIPER];
    } else {
      /* This is (symmetrized Kolmogorov-Smirnov) is the default */
-     test[j]->ks_pvalue = kstest(test[j]->pvalues,test[j]->psamples);
+     test[j]->ks_pvalue = test[j]->gof_pvalues[GOF_KS];
    }
 
  }
@@ -309,6 +421,10 @@ void std_test(Dtest *dtest, Test **test, Test **ref_test)
    count = test[0]->psamples;
    for(j = 0;j < dtest->nkps;j++){
      test[j]->psamples = 0;
+     test[j]->nsorted = 0;
+     test[j]->st_nsorted = 0;
+     if(test[j]->ps != NULL) pstream_clear(test[j]->ps);
+     if(ref_test != NULL) ref_test[j]->st_nsorted = 0;
    }
  } else {
    /* Add Xstep more samples */
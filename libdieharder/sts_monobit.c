@@ -15,27 +15,27 @@
  * Rewriting means that I can standardize the interface to gsl-encapsulated
  * routines more easily.  It also makes this my own code.
  *
- * The #if'd code below is from David Bauer, and is a bit difficult to
- * read (which ordinarily would be sufficient grounds for not using it,
- * according to my usual standards for non-obfuscating code).  It is,
- * however, 12% faster as it does the summing up of 1's vs 0's using
- * bitshifts and masks (faster operations than looped C sums).  You can
- * turn on the old code if you like, but we'll leave the default "fast".
- *
- * NOBITS = 0 means "use the fast bitmask code", where
- * NOBITS = 1 should turn the linear/obvious C code back on.
+ * The 1's used to be counted a rand at a time, first with a bit loop and
+ * then with David Bauer's bitshift and mask sum.  Now a block of rands
+ * is generated at a time and handed to popcount_buf(), which uses
+ * whatever SIMD popcount the CPU has.
  * ========================================================================
  */
 
 #include <dieharder/libdieharder.h>
 
-#define NOBITS 0
+/*
+ * Number of rands pulled per block.
+ */
+#define MONOBIT_RANDS 4096
 
 int sts_monobit(Test **test, int irun, random_generator_t *cur_rng)
 {
 
- int i;
+ uint t,i,nb;
  uint blens,nbits;
+ uint *rand_int;
+ unsigned long long ones;
  Xtest ptest;
 
  /*
@@ -73,48 +73,23 @@ int sts_monobit(Test **test, int irun, random_generator_t *cur_rng)
  MYDEBUG(D_STS_MONOBIT) {
    printf("# rgb_bitdist(): Generating %lu bits in bitstring",test[0]->tsamples*sizeof(uint)*8);
  }
- ptest.x = 0;
-
- for(i=0;i<test[0]->tsamples;i++) {
-#if NOBITS
-   bitstring = gsl_rng_get(cur_rng);
-#else
-   uint n = gsl_rng_get(cur_rng->rng);
-#endif
-   MYDEBUG(D_STS_MONOBIT) {
-#if NOBITS
-     printf("# rgb_bitdist() (nobits): rand_int[%d] = %u = ",i,bitstring);
-     dumpbits(&bitstring,8*sizeof(uint));
-#else
-     printf("# rgb_bitdist() (bits): rand_int[%d] = %u = ",i,n);
-     dumpbits(&n,8*sizeof(uint));
-#endif
+ rand_int = (uint *)malloc(MONOBIT_RANDS*sizeof(uint));
+ ones = 0;
+ for(t=0;t<test[0]->tsamples;t+=nb){
+   nb = test[0]->tsamples - t;
+   if(nb > MONOBIT_RANDS) nb = MONOBIT_RANDS;
+   for(i=0;i<nb;i++){
+     rand_int[i] = gsl_rng_get(cur_rng->rng);
    }
-#if NOBITS
-   for(b=0;b<blens;b++){
-     /*
-      * This gets the integer value of the ntuple at index position
-      * n in the current bitstring, from a window with cyclic wraparound.
-      */
-     bit = bitstring & 0x01;
-     bitstring >>= 1;
-     ptest.x += bit;
-   }
-#else
-   n -= (n >> 1) & 0x55555555;
-   n = (n & 0x33333333) + ((n >> 2) & 0x33333333);
-   n = (n + (n >> 4)) & 0x0f0f0f0f;
-   if(0) {
-     n = (n * 0x01010101) >> 24;
-   } else {
-     n = n + (n >> 8);
-     n = (n + (n >> 16)) & 0x3f;
+   MYDEBUG(D_STS_MONOBIT) {
+     printf("# sts_monobit(): rand_int[%u] = %u = ",t,rand_int[0]);
+     dumpbits(&rand_int[0],8*sizeof(uint));
    }
-   ptest.x += n;
-#endif
-
+   ones += popcount_buf(rand_int,nb);
  }
- 
+ nullfree(rand_int);
+ ptest.x = (double) ones;
+
  ptest.x = 2*ptest.x - nbits;
  MYDEBUG(D_STS_MONOBIT) {
    printf("mtext.x = %10.5f  ptest.sigma = %10.5f\n",ptest.x,ptest.sigma);
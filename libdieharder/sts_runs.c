@@ -18,14 +18,52 @@
 
 #include <dieharder/libdieharder.h>
 
+/*
+ * Number of rands pulled per block.
+ */
+#define STS_RUNS_RANDS 4096
+
+/*
+ * The bitstring is the rands laid end to end, rmax_bits apiece, with
+ * rand t-1 following rand t (bit 0 of rand t-1 comes right after bit
+ * rmax_bits-1 of rand t, see get_bit_ntuple()), closed into a loop.  All
+ * sts_runs needs from the 2-bit windows is the number of ones and the
+ * number of 01/10 windows (bit flips), and both can be had a whole rand
+ * at a time:
+ *
+ *   ones  += popcount(x)
+ *   flips += popcount((x ^ (x >> 1)) & mask)    inside x
+ *          + ((x >> (rmax_bits-1)) ^ xprev) & 1   across into rand t-1
+ *
+ * with mask the low rmax_bits-1 bits.  sts_runs_count() packs the flips
+ * of w[0]..w[n-1] into one word apiece (the cross term in bit 0, which
+ * the mask leaves free) and hands both blocks to popcount_buf().  w[-1]
+ * must be the rand preceding w[0].
+ */
+static void sts_runs_count(const uint *w,uint n,uint rbits,uint *f,
+                           unsigned long long *ones,unsigned long long *flips)
+{
+
+ uint i;
+ uint mask = (rbits >= 32) ? 0x7fffffff : ((1u << (rbits - 1)) - 1);
+ const uint *wprev = w - 1;
+
+ for(i=0;i<n;i++){
+   f[i] = (((w[i] ^ (w[i] >> 1)) & mask) << 1) | (((w[i] >> (rbits - 1)) ^ wprev[i]) & 1);
+ }
+ *ones += popcount_buf(w,n);
+ *flips += popcount_buf(f,n);
+
+}
+
 int sts_runs(Test **test, int irun, random_generator_t *cur_rng)
 {
 
- int b,t;
- uint value;
- uint *rand_int;
+ uint t,i,nb,first;
+ uint *rand_int,*flip_int;
+ unsigned long long ones,flips;
  Xtest ptest;
- double pones,c00,c01,c10,c11;;
+ double pones;
 
  /*
   * for display only.  2 means sts_runs tests 2-tuples.
@@ -33,9 +71,12 @@ int sts_runs(Test **test, int irun, random_generator_t *cur_rng)
  test[0]->ntuple = 2;
 
  /*
-  * Allocate the space needed by the test.
+  * Allocate the space needed by the test:  a block of rands with
+  * room in front for the last rand of the previous block, and its
+  * flips.
   */
- rand_int = (uint *)malloc(test[0]->tsamples*sizeof(uint));
+ rand_int = (uint *)malloc((STS_RUNS_RANDS + 1)*sizeof(uint));
+ flip_int = (uint *)malloc(STS_RUNS_RANDS*sizeof(uint));
 
  /*
   * Number of total bits from -t test[0]->tsamples = size of rand_int[]
@@ -43,62 +84,41 @@ int sts_runs(Test **test, int irun, random_generator_t *cur_rng)
  bits = cur_rng->rmax_bits*test[0]->tsamples;
 
  /*
-  * We have to initialize these a bit differently this time
-  */
- ptest.x = 0.0;
-
- /*
-  * Create entire bitstring to be tested
+  * Fill blocks of "random" integers with selected generator and count
+  * the ones and the 01/10 windows (the runs boundaries) in each.  The
+  * very first rand has no predecessor yet, so we give it a dummy one
+  * that contributes no flip; its real cross term wraps around to the
+  * last rand and is added at the end (with -t 0 there is nothing to
+  * wrap).
   */
- for(t=0;t<test[0]->tsamples;t++){
-   rand_int[t] = gsl_rng_get(cur_rng->rng);
- }
-
- /*
-  * Fill vector of "random" integers with selected generator.
-  * NOTE WELL:  This can also be done by reading in a file!
-  */
- pones = 0.0;
- c00 = 0.0;
- c01 = 0.0;
- c10 = 0.0;  /* Equal to c01 by obvious periodic symmetry */
- c11 = 0.0;
- for(b=0;b<bits;b++){
-   /*
-    * This gets the integer value of the ntuple at index position
-    * n in the current bitstring, from a window with cyclic wraparound.
-    */
-   value = get_bit_ntuple(rand_int,test[0]->tsamples,2,b, cur_rng);
-   switch(value){
-     case 0:   /* 00 no new ones */
-       c00++;
-       break;
-     case 1:   /* 01 no new ones */
-       c01++;
-       ptest.x++;
-       break;
-     case 2:   /* 10 one new one (from the left) */
-       c10++;
-       ptest.x++;
-       pones++;
-       break;
-     case 3:   /* 11 one new one (from the left) */
-       c11++;
-       pones++;
-       break;
+ ones = 0;
+ flips = 0;
+ first = 0;
+ rand_int[0] = 0;
+ for(t=0;t<test[0]->tsamples;t+=nb){
+   nb = test[0]->tsamples - t;
+   if(nb > STS_RUNS_RANDS) nb = STS_RUNS_RANDS;
+   for(i=1;i<=nb;i++){
+     rand_int[i] = gsl_rng_get(cur_rng->rng);
    }
-   MYDEBUG(D_STS_RUNS) {
-     printf("# sts_runs(): ptest.x = %f, pone = %f\n",ptest.x,pones);
+   if(t == 0){
+     first = rand_int[1];
+     rand_int[0] = first >> (cur_rng->rmax_bits - 1);
    }
+   sts_runs_count(&rand_int[1],nb,cur_rng->rmax_bits,flip_int,&ones,&flips);
+   rand_int[0] = rand_int[nb];
+ }
+ flips += ((first >> (cur_rng->rmax_bits - 1)) ^ rand_int[0]) & 1;
+
+ MYDEBUG(D_STS_RUNS) {
+   printf("# sts_runs(): ones = %llu, flips = %llu\n",ones,flips);
  }
+
  /*
   * form the probability of getting a one in the entire sample
   */
- pones /= (double) test[0]->tsamples*cur_rng->rmax_bits;
- c00 /= (double) test[0]->tsamples*cur_rng->rmax_bits;
- c01 /= (double) test[0]->tsamples*cur_rng->rmax_bits;
- c10 /= (double) test[0]->tsamples*cur_rng->rmax_bits;
- c11 /= (double) test[0]->tsamples*cur_rng->rmax_bits;
+ ptest.x = (double) flips;
+ pones = (double) ones/((double) test[0]->tsamples*cur_rng->rmax_bits);
 
  /*
   * Now we can finally compute the targets for the problem.
@@ -107,7 +127,7 @@ int sts_runs(Test **test, int irun, random_generator_t *cur_rng)
  ptest.sigma = 2.0*sqrt(bits)*pones*(1.0-pones);
 
  MYDEBUG(D_STS_RUNS) {
-   printf(" p = %f c00 = %f c01 = %f c10 = %f c11 = %f\n",pones,c00,c01,c10,c11);
+   printf(" p = %f\n",pones);
  }
 
  test[0]->st_values[irun] = ptest.x;
@@ -119,8 +139,8 @@ int sts_runs(Test **test, int irun, random_generator_t *cur_rng)
  }
 
  free(rand_int);
+ free(flip_int);
 
  return(0);
 
 }
-
@@ -76,6 +76,11 @@
 
 #include "static_get_bits.c"
 
+/*
+ * Number of uintbuf entries whose 32 windows each are counted per batch.
+ */
+#define SERIAL_WORDS 1024
+
 /*
  * This is a buffer of uint length (2^nb)+1 that we will fill with rands
  * to be tested, once per test.
@@ -86,7 +91,6 @@ int sts_serial(Test **test,int irun, random_generator_t *cur_rng)
 
  uint bsize;       /* number of bits/samples in uintbuf */
  uint nb,nb1;          /* number of bits in a tested ntuple */
- uint value;       /* value of sampled ntuple (as a uint) */
  uint mask;        /* mask in only nb bits */
  uint bi;          /* bit offset relative to window */
 
@@ -96,8 +100,11 @@ int sts_serial(Test **test,int irun, random_generator_t *cur_rng)
  uint ctotal;  /* count of any ntuple per bitstring */
  double **freq,*psi2,*delpsi2,*del2psi2;
  double pvalue;
- uint *uintbuf;
- uint window;  /* uint window into uintbuf, slide along a byte at at time. */
+ uint *uintbuf,*counts;
+ uint nw;
+ unsigned long long pair;  /* uintbuf[j]:uintbuf[j+1], windows are cut from this */
+ unsigned short *windows;
+ multihist_t *hist;
 
  double mono_mean,mono_sigma;  /* For single bit test */
 
@@ -203,59 +210,41 @@ int sts_serial(Test **test,int irun, random_generator_t *cur_rng)
  }
 
  /*
-  * We now in ONE PASS loop over all of the possible values of m from
-  * 1 to 16.
+  * We now in ONE PASS count the overlapping nb bit windows at every bit
+  * offset, in a multihist.  Every shorter window at the same offset is
+  * just the leading m bits of the nb bit one, so the counts for m < nb
+  * follow by adding up pairs of counts for m+1:
+  *   freq[m][v] = freq[m+1][2v] + freq[m+1][2v+1]
+  * The window at bit b of uintbuf[j] is bits b..b+nb-1 (counted from the
+  * most significant end) of uintbuf[j]:uintbuf[j+1].
   */
- for(m=1;m<nb1;m++){
- 
-   /*
-    * Set the mask for bits to be returned.  This will work fine for
-    * m in the allowed range, and will fail if m = 32 if that ever
-    * happens in the future.
-    */
-   mask = 0;
-   for(i = 0; i < m; i++){
-      mask |= (1u << m);
-   }
-   mask = ((1u << m) - 1);
-
-   /* Initialize index and count total */
-   j = 0;
-   ctotal = 0;
-   MYDEBUG(D_STS_SERIAL){
-     printf("looping bsize = %u times\n",bsize);
-   }
-   for(t=0;t<bsize;t++){
-     /*
-      * Offset of current sample, relative to left boundary of window.
-      */
-     if((t%32) == 0){
-       window = uintbuf[j];  /* start with window = testbuf = charbuf */
-       MYDEBUG(D_STS_SERIAL){
-         printf("uint window[%u] = %08x = ",j,window);
-         dumpuintbits(&window,1);
-         printf("\n");
-       }
-       j++;
-     }
-     bi = t%16;
-     value = (window >> (32 - m - bi)) & mask;
-     MYDEBUG(D_STS_SERIAL){
-       dumpbitwin(value,m);
-       printf("\n");
-     }
-     freq[m][value]++;
-     ctotal++;
-     if(bi == 15){
-       window = (window << 16);
-       window += (uintbuf[j] >> 16);
-       MYDEBUG(D_STS_SERIAL){
-         printf("half window[%u] = %08x = ",j,window);
-         dumpuintbits(&window,1);
-         printf("\n");
-       }
+ mask = ((1u << nb) - 1);
+ hist = multihist_alloc(1u << nb);
+ windows = (unsigned short *)malloc(32*SERIAL_WORDS*sizeof(unsigned short));
+ for(j=0;j<tsamples;j+=nw){
+   nw = tsamples - j;
+   if(nw > SERIAL_WORDS) nw = SERIAL_WORDS;
+   for(i=0;i<nw;i++){
+     pair = ((unsigned long long) uintbuf[j+i] << 32) | uintbuf[j+i+1];
+     for(bi=0;bi<32;bi++){
+       windows[32*i+bi] = (pair >> (64 - nb - bi)) & mask;
      }
    }
+   multihist_add_u16(hist,windows,32*nw);
+ }
+ nullfree(windows);
+
+ counts = (uint *)malloc((1u << nb)*sizeof(uint));
+ multihist_merge(hist,counts);
+ multihist_free(hist);
+ for(i=0;i<(1u << nb);i++) freq[nb][i] = counts[i];
+ nullfree(counts);
+ for(m=nb-1;m>0;m--){
+   for(i=0;i<(1u << m);i++) freq[m][i] = freq[m+1][2*i] + freq[m+1][2*i+1];
+ }
+
+ ctotal = bsize;
+ for(m=1;m<nb1;m++){
 
    MYDEBUG(D_STS_SERIAL){
      printf("# sts_serial():=====================================================\n");
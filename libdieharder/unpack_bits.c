@@ -0,0 +1,227 @@
+/*
+ * See copyright in copyright.h and the accompanying file COPYING
+ */
+
+/*
+ *========================================================================
+ * Unpacking a buffer of words into an array of k-bit values, for the
+ * tests that want "the next k bits" over and over (rgb_bitdist,
+ * diehard_bitstream, diehard_birthdays) and used to get them one call
+ * at a time.
+ *
+ * The words are treated as one long bitstream, and value i is the k
+ * bits starting at bit first + i*stride of it:
+ *
+ *   unpack_bits_u32/u16()          stride k, non-overlapping values.
+ *   unpack_bits_overlap_u32/u16()  stride 1, a window slid along the
+ *                                  stream one bit at a time.
+ *
+ * Both read the stream most significant bit first, word after word,
+ * which is the order get_rand_bits_uint() delivers bits in, so bit 0
+ * is the top bit of w[0] and a value's first bit is its most
+ * significant one.  unpack_bits_lsb_u32() reads it the other way, the
+ * least significant bit of w[0] first, which is the order
+ * get_rand_bits() delivers bits in.
+ *
+ * k is at most 32 (16 for the u16 versions), and all the bit positions
+ * involved must fit in an unsigned int.  Only the words that actually
+ * hold requested bits are read.
+ *
+ * With AVX2 eight values are made at once:  each lane finds the word
+ * its value starts in and the next one, shifts the two together with
+ * per-lane variable shifts and masks.  When eight values span at most
+ * a handful of words (k and stride <= 16) the words are loaded once
+ * and shuffled into the lanes, otherwise they are gathered.
+ *========================================================================
+ */
+
+#include <dieharder/libdieharder.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define UNPACK_AVX2 1
+#endif
+
+static int unpack_avx2 = -1;
+
+static void unpack_init(void)
+{
+
+ unpack_avx2 = 0;
+#ifdef UNPACK_AVX2
+ __builtin_cpu_init();
+ if(__builtin_cpu_supports("avx2")) unpack_avx2 = 1;
+#endif
+ MYDEBUG(D_BITS){
+   printf("# unpack_init(): avx2 = %d\n",unpack_avx2);
+ }
+
+}
+
+/*
+ * Values i0..n-1 one at a time, into out32 or out16 (whichever isn't
+ * NULL).
+ */
+static void unpack_scalar(const unsigned int *w,unsigned int first,unsigned int stride,
+                          unsigned int k,unsigned int i0,unsigned int n,int lsb,
+                          unsigned int *out32,unsigned short *out16)
+{
+
+ unsigned int i,p,idx,sh,v;
+ unsigned int mask = (k == 32) ? 0xffffffff : (1u << k) - 1;
+ unsigned long long x;
+
+ for(i=i0;i<n;i++){
+   p = first + i*stride;
+   idx = p >> 5;
+   sh = p & 31;
+   if(lsb){
+     x = w[idx];
+     if(sh + k > 32) x |= (unsigned long long) w[idx+1] << 32;
+     v = (unsigned int)(x >> sh) & mask;
+   } else {
+     x = (unsigned long long) w[idx] << 32;
+     if(sh + k > 32) x |= w[idx+1];
+     v = (unsigned int)(x >> (64 - sh - k)) & mask;
+   }
+   if(out32 != NULL){
+     out32[i] = v;
+   } else {
+     out16[i] = (unsigned short) v;
+   }
+ }
+
+}
+
+#ifdef UNPACK_AVX2
+
+/*
+ * Returns the number of values done; the caller finishes the rest with
+ * unpack_scalar(), which only reads the words it has to.
+ */
+__attribute__((target("avx2")))
+static unsigned int unpack_avx2_block(const unsigned int *w,unsigned int first,unsigned int stride,
+                                      unsigned int k,unsigned int n,int lsb,
+                                      unsigned int *out32,unsigned short *out16)
+{
+
+ unsigned int i,p0,nwords;
+ int shuffle = (k <= 16 && stride <= 16);
+ __m256i lane,pos,idx,sh,rsh,hi,lo,v,vw,val;
+ const __m256i thirtytwo = _mm256_set1_epi32(32);
+ const __m256i one = _mm256_set1_epi32(1);
+ const __m256i mask = _mm256_set1_epi32((k == 32) ? -1 : (int)((1u << k) - 1));
+ const __m128i kshift = _mm_cvtsi32_si128(32 - k);
+
+ if(n < 8) return 0;
+
+ /*
+  * The words holding requested bits are w[0]..w[nwords-1].  A block
+  * of eight may touch w[idx+1] (and the shuffle loads eight whole
+  * words), so we stop while that is still inside the buffer.
+  */
+ nwords = ((first + (n - 1)*stride + k - 1) >> 5) + 1;
+ lane = _mm256_mullo_epi32(_mm256_setr_epi32(0,1,2,3,4,5,6,7),_mm256_set1_epi32(stride));
+
+ for(i=0;i+8<=n;i+=8){
+   p0 = first + i*stride;
+   if(shuffle){
+     if((p0 >> 5) + 8 > nwords) break;
+   } else {
+     if(((p0 + 7*stride) >> 5) + 1 >= nwords) break;
+   }
+   pos = _mm256_add_epi32(_mm256_set1_epi32(p0),lane);
+   idx = _mm256_srli_epi32(pos,5);
+   sh = _mm256_and_si256(pos,_mm256_set1_epi32(31));
+   rsh = _mm256_sub_epi32(thirtytwo,sh);
+   if(shuffle){
+     /*
+      * Eight values of at most 16 bits, at most 16 bits apart, lie in
+      * at most six consecutive words starting at p0 >> 5.
+      */
+     vw = _mm256_loadu_si256((const __m256i *)(w + (p0 >> 5)));
+     idx = _mm256_sub_epi32(idx,_mm256_set1_epi32(p0 >> 5));
+     hi = _mm256_permutevar8x32_epi32(vw,idx);
+     lo = _mm256_permutevar8x32_epi32(vw,_mm256_add_epi32(idx,one));
+   } else {
+     hi = _mm256_i32gather_epi32((const int *)w,idx,4);
+     lo = _mm256_i32gather_epi32((const int *)w,_mm256_add_epi32(idx,one),4);
+   }
+   /*
+    * Variable shifts by 32 give 0, which takes care of sh == 0.
+    */
+   if(lsb){
+     v = _mm256_or_si256(_mm256_srlv_epi32(hi,sh),_mm256_sllv_epi32(lo,rsh));
+     val = _mm256_and_si256(v,mask);
+   } else {
+     v = _mm256_or_si256(_mm256_sllv_epi32(hi,sh),_mm256_srlv_epi32(lo,rsh));
+     val = _mm256_srl_epi32(v,kshift);
+   }
+   if(out32 != NULL){
+     _mm256_storeu_si256((__m256i *)(out32 + i),val);
+   } else {
+     val = _mm256_permute4x64_epi64(_mm256_packus_epi32(val,val),0x08);
+     _mm_storeu_si128((__m128i *)(out16 + i),_mm256_castsi256_si128(val));
+   }
+ }
+ return i;
+
+}
+
+#endif
+
+static void unpack(const unsigned int *w,unsigned int first,unsigned int stride,
+                   unsigned int k,unsigned int n,int lsb,
+                   unsigned int *out32,unsigned short *out16)
+{
+
+ unsigned int i = 0;
+
+ if(n == 0) return;
+ if(unpack_avx2 < 0) unpack_init();
+#ifdef UNPACK_AVX2
+ if(unpack_avx2) i = unpack_avx2_block(w,first,stride,k,n,lsb,out32,out16);
+#endif
+ unpack_scalar(w,first,stride,k,i,n,lsb,out32,out16);
+
+}
+
+void unpack_bits_u32(const unsigned int *w,unsigned int first,unsigned int k,
+                     unsigned int n,unsigned int *out)
+{
+
+ unpack(w,first,k,k,n,0,out,NULL);
+
+}
+
+void unpack_bits_u16(const unsigned int *w,unsigned int first,unsigned int k,
+                     unsigned int n,unsigned short *out)
+{
+
+ unpack(w,first,k,k,n,0,NULL,out);
+
+}
+
+void unpack_bits_overlap_u32(const unsigned int *w,unsigned int first,unsigned int k,
+                             unsigned int n,unsigned int *out)
+{
+
+ unpack(w,first,1,k,n,0,out,NULL);
+
+}
+
+void unpack_bits_overlap_u16(const unsigned int *w,unsigned int first,unsigned int k,
+                             unsigned int n,unsigned short *out)
+{
+
+ unpack(w,first,1,k,n,0,NULL,out);
+
+}
+
+void unpack_bits_lsb_u32(const unsigned int *w,unsigned int first,unsigned int k,
+                         unsigned int n,unsigned int *out)
+{
+
+ unpack(w,first,k,k,n,1,out,NULL);
+
+}